@@ -0,0 +1,471 @@
+/*
+Copyright © 2018 Felipe Ferreira da Silva
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use of
+this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject to
+the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "gfw.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "gfw_headless.h"
+#include "gfw_null_gl.h"
+
+#ifndef GFW_BENCH_REPETITIONS_MAX
+#define GFW_BENCH_REPETITIONS_MAX 1024
+#endif
+
+#define GFW_BENCH_TARGET_SIZE 64
+#define GFW_BENCH_STREAM_SIZE (4 * 1024 * 1024)
+
+struct gfw_bench_case {
+	char *name;
+	char parameters[64];
+	uint32_t size;
+	enum gfw_texture_pixel_format pixel_format;
+	uint32_t iterations;
+	uint64_t bytes;
+	void (*run)(struct gfw_bench_case *bench_case);
+};
+
+static char *gfw_bench_vertex_source = "#version 330 core\n"
+	"layout(location = 0) in vec2 position;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_Position = vec4(position, 0.0, 1.0);\n"
+	"}\n";
+static char *gfw_bench_fragment_source = "#version 330 core\n"
+	"out vec4 color;\n"
+	"uniform float value;\n"
+	"void main()\n"
+	"{\n"
+	"	color = vec4(value, 0.0, 0.0, 1.0);\n"
+	"}\n";
+
+static uint32_t gfw_bench_warmup = 3;
+static uint32_t gfw_bench_repetitions = 10;
+static char *gfw_bench_filter = NULL;
+static bool gfw_bench_null = false;
+static bool gfw_bench_check = false;
+static bool gfw_bench_first_result = true;
+static uint8_t *gfw_bench_data = NULL;
+static struct gfw_texture gfw_bench_target_texture = {0};
+static struct gfw_framebuffer gfw_bench_target = {0};
+static struct gfw_shader gfw_bench_shader = {0};
+static struct gfw_vertex_data gfw_bench_vertex_data = {0};
+static struct gfw_vertex_data gfw_bench_stream_vertex_data = {0};
+static struct gfw_vertex_state gfw_bench_vertex_state = {0};
+static struct gfw_attribute gfw_bench_attribute = {0, GFW_ATTRIBUTE_FLOAT, 2, false, 2 * sizeof(float), 0, 0};
+static uint32_t gfw_bench_shader_counter = 0;
+
+static uint64_t gfw_bench_get_time(void)
+{
+	struct timespec time = {0};
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (uint64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+static int gfw_bench_compare(const void *a, const void *b)
+{
+	uint64_t value_a = *(const uint64_t *)a;
+	uint64_t value_b = *(const uint64_t *)b;
+	return (value_a > value_b) - (value_a < value_b);
+}
+
+static void gfw_bench_run_texture_upload(struct gfw_bench_case *bench_case)
+{
+	struct gfw_texture texture = {0};
+	struct gfw_texture_descriptor descriptor = {0};
+	uint32_t i = 0;
+	descriptor.pixel_format = bench_case->pixel_format;
+	descriptor.horizontal_wrap = GFW_TEXTURE_WRAP_CLAMP_TO_EDGE;
+	descriptor.vertical_wrap = GFW_TEXTURE_WRAP_CLAMP_TO_EDGE;
+	descriptor.mag_filter = GFW_TEXTURE_FILTER_NEAREST;
+	descriptor.min_filter = GFW_TEXTURE_FILTER_NEAREST;
+	descriptor.width = bench_case->size;
+	descriptor.height = bench_case->size;
+	gfw_init_texture(&texture, descriptor);
+	while (i < bench_case->iterations) {
+		gfw_texture_put_subimage(&texture, 0, 0, gfw_bench_data, bench_case->size, bench_case->size);
+		i++;
+	}
+	glFinish();
+	gfw_free_texture(&texture);
+}
+
+static void gfw_bench_run_vertex_push(struct gfw_bench_case *bench_case)
+{
+	uint32_t i = 0;
+	gfw_vertex_data_bind(&gfw_bench_stream_vertex_data);
+	while (i < bench_case->iterations) {
+		gfw_vertex_data_map_range(&gfw_bench_stream_vertex_data, false, true, 0, bench_case->size);
+		gfw_vertex_data_push(&gfw_bench_stream_vertex_data, gfw_bench_data, bench_case->size);
+		gfw_vertex_data_unmap();
+		i++;
+	}
+	gfw_vertex_data_unbind();
+	glFinish();
+}
+
+static void gfw_bench_run_vertex_map(struct gfw_bench_case *bench_case)
+{
+	uint32_t i = 0;
+	gfw_vertex_data_bind(&gfw_bench_stream_vertex_data);
+	while (i < bench_case->iterations) {
+		gfw_vertex_data_map(&gfw_bench_stream_vertex_data, false, true);
+		memcpy(gfw_bench_stream_vertex_data.buffer, gfw_bench_data, bench_case->size);
+		gfw_vertex_data_unmap();
+		i++;
+	}
+	gfw_vertex_data_unbind();
+	glFinish();
+}
+
+static void gfw_bench_run_draw_submission(struct gfw_bench_case *bench_case)
+{
+	uint32_t i = 0;
+	gfw_framebuffer_bind(&gfw_bench_target);
+	gfw_shader_use(&gfw_bench_shader);
+	gfw_vertex_state_bind(&gfw_bench_vertex_state);
+	gfw_vertex_data_bind(&gfw_bench_vertex_data);
+	while (i < bench_case->iterations) {
+		gfw_shader_draw_range(&gfw_bench_attribute, 1, GFW_PRIMITIVE_TRIANGLES, 0, 3);
+		i++;
+	}
+	gfw_vertex_data_unbind();
+	gfw_vertex_state_unbind();
+	glFinish();
+}
+
+static void gfw_bench_run_state_change(struct gfw_bench_case *bench_case)
+{
+	uint32_t i = 0;
+	gfw_framebuffer_bind(&gfw_bench_target);
+	gfw_shader_use(&gfw_bench_shader);
+	gfw_vertex_state_bind(&gfw_bench_vertex_state);
+	gfw_vertex_data_bind(&gfw_bench_vertex_data);
+	while (i < bench_case->iterations) {
+		if (i % 2 == 0) {
+			gfw_enable_blend();
+			gfw_set_blend_function(GFW_BLEND_FACTOR_SOURCE_ALPHA, GFW_BLEND_FACTOR_ONE_MINUS_SOURCE_ALPHA);
+			gfw_enable_depth_test();
+			gfw_set_cull_face_mode(GFW_CULL_FACE_FRONT);
+		} else {
+			gfw_disable_blend();
+			gfw_set_blend_function(GFW_BLEND_FACTOR_ONE, GFW_BLEND_FACTOR_ZERO);
+			gfw_disable_depth_test();
+			gfw_set_cull_face_mode(GFW_CULL_FACE_BACK);
+		}
+		gfw_shader_draw_range(&gfw_bench_attribute, 1, GFW_PRIMITIVE_TRIANGLES, 0, 3);
+		i++;
+	}
+	gfw_disable_blend();
+	gfw_disable_depth_test();
+	gfw_vertex_data_unbind();
+	gfw_vertex_state_unbind();
+	glFinish();
+}
+
+/* Every source is unique so the program cache never hits */
+static void gfw_bench_run_shader_compile(struct gfw_bench_case *bench_case)
+{
+	struct gfw_shader shader = {0};
+	char source[1024];
+	uint32_t i = 0;
+	while (i < bench_case->iterations) {
+		snprintf(source, sizeof(source), "%s// %u\n", gfw_bench_fragment_source, gfw_bench_shader_counter);
+		gfw_bench_shader_counter++;
+		if (gfw_init_shader(&shader, gfw_bench_vertex_source, NULL, source)) {
+			gfw_free_shader(&shader);
+		}
+		i++;
+	}
+	glFinish();
+}
+
+static void gfw_bench_measure(struct gfw_bench_case *bench_case)
+{
+	uint64_t samples[GFW_BENCH_REPETITIONS_MAX];
+	uint64_t total = 0;
+	uint64_t begin = 0;
+	double seconds = 0.0;
+	size_t calls_count = 0;
+	uint32_t i = 0;
+	if (gfw_bench_filter && !strstr(bench_case->name, gfw_bench_filter)) {
+		return;
+	}
+	while (i < gfw_bench_warmup) {
+		bench_case->run(bench_case);
+		i++;
+	}
+	i = 0;
+	while (i < gfw_bench_repetitions) {
+		begin = gfw_bench_get_time();
+		bench_case->run(bench_case);
+		samples[i] = gfw_bench_get_time() - begin;
+		total = total + samples[i];
+		i++;
+	}
+	qsort(samples, gfw_bench_repetitions, sizeof(uint64_t), gfw_bench_compare);
+	seconds = (double)samples[gfw_bench_repetitions / 2] / 1000000000.0;
+	printf("%s\n\t\t{\"name\": \"%s\", \"parameters\": \"%s\", \"iterations\": %u, ",
+		gfw_bench_first_result ? "" : ",",
+		bench_case->name,
+		bench_case->parameters,
+		bench_case->iterations);
+	printf("\"min_ns\": %llu, \"median_ns\": %llu, \"mean_ns\": %llu, \"max_ns\": %llu, ",
+		(unsigned long long)samples[0],
+		(unsigned long long)samples[gfw_bench_repetitions / 2],
+		(unsigned long long)(total / gfw_bench_repetitions),
+		(unsigned long long)samples[gfw_bench_repetitions - 1]);
+	printf("\"operations_per_second\": %.1f, \"bytes_per_second\": %.1f",
+		bench_case->iterations / seconds,
+		bench_case->bytes * bench_case->iterations / seconds);
+	/* One more recorded run gives the GL calls GFW emits per operation */
+	if (gfw_bench_null) {
+		gfw_null_gl_clear_calls();
+		gfw_null_gl_set_mode(GFW_NULL_GL_MODE_RECORD);
+		bench_case->run(bench_case);
+		gfw_null_gl_set_mode(GFW_NULL_GL_MODE_DISCARD);
+		gfw_null_gl_get_calls(&calls_count);
+		printf(", \"gl_calls_per_operation\": %.2f", (double)calls_count / bench_case->iterations);
+	}
+	printf("}");
+	gfw_bench_first_result = false;
+}
+
+static bool gfw_bench_check_calls(const char *function, size_t expected)
+{
+	size_t count = gfw_null_gl_count_calls(function);
+	if (count != expected) {
+		fprintf(stderr, "Error: %s was called %zu times, expected %zu.\n", function, count, expected);
+	}
+	return count == expected;
+}
+
+/* Repeated setters must reach GL once, and not again while nothing changes */
+static bool gfw_bench_check_state_elision(void)
+{
+	bool success = true;
+	uint32_t i = 0;
+	gfw_framebuffer_bind(&gfw_bench_target);
+	gfw_shader_use(&gfw_bench_shader);
+	gfw_vertex_state_bind(&gfw_bench_vertex_state);
+	gfw_vertex_data_bind(&gfw_bench_vertex_data);
+	gfw_shader_draw_range(&gfw_bench_attribute, 1, GFW_PRIMITIVE_TRIANGLES, 0, 3);
+	gfw_null_gl_clear_calls();
+	gfw_null_gl_set_mode(GFW_NULL_GL_MODE_RECORD);
+	while (i < 4) {
+		gfw_set_viewport(0, 0, GFW_BENCH_TARGET_SIZE / 2, GFW_BENCH_TARGET_SIZE / 2);
+		gfw_disable_blend();
+		gfw_enable_blend();
+		gfw_set_blend_function(GFW_BLEND_FACTOR_SOURCE_ALPHA, GFW_BLEND_FACTOR_ONE_MINUS_SOURCE_ALPHA);
+		i++;
+	}
+	gfw_shader_draw_range(&gfw_bench_attribute, 1, GFW_PRIMITIVE_TRIANGLES, 0, 3);
+	gfw_set_viewport(0, 0, GFW_BENCH_TARGET_SIZE / 2, GFW_BENCH_TARGET_SIZE / 2);
+	gfw_enable_blend();
+	gfw_shader_draw_range(&gfw_bench_attribute, 1, GFW_PRIMITIVE_TRIANGLES, 0, 3);
+	gfw_null_gl_set_mode(GFW_NULL_GL_MODE_DISCARD);
+	success = gfw_bench_check_calls("glViewport", 1) && success;
+	success = gfw_bench_check_calls("glEnable", 1) && success;
+	success = gfw_bench_check_calls("glDisable", 0) && success;
+	success = gfw_bench_check_calls("glBlendFuncSeparate", 1) && success;
+	success = gfw_bench_check_calls("glDrawArrays", 2) && success;
+	gfw_disable_blend();
+	gfw_set_viewport(0, 0, GFW_BENCH_TARGET_SIZE, GFW_BENCH_TARGET_SIZE);
+	gfw_vertex_data_unbind();
+	gfw_vertex_state_unbind();
+	return success;
+}
+
+static bool gfw_bench_init_resources(void)
+{
+	bool success = true;
+	struct gfw_texture_descriptor descriptor = {0};
+	float triangle[6] = {-1.0f, -1.0f, 1.0f, -1.0f, 0.0f, 1.0f};
+	uint32_t i = 0;
+	gfw_bench_data = malloc(GFW_BENCH_STREAM_SIZE);
+	if (!gfw_bench_data) {
+		success = false;
+		goto done;
+	}
+	while (i < GFW_BENCH_STREAM_SIZE) {
+		gfw_bench_data[i] = (uint8_t)(i * 31);
+		i++;
+	}
+	descriptor.pixel_format = GFW_TEXTURE_PIXEL_FORMAT_RGBA;
+	descriptor.horizontal_wrap = GFW_TEXTURE_WRAP_CLAMP_TO_EDGE;
+	descriptor.vertical_wrap = GFW_TEXTURE_WRAP_CLAMP_TO_EDGE;
+	descriptor.mag_filter = GFW_TEXTURE_FILTER_NEAREST;
+	descriptor.min_filter = GFW_TEXTURE_FILTER_NEAREST;
+	descriptor.width = GFW_BENCH_TARGET_SIZE;
+	descriptor.height = GFW_BENCH_TARGET_SIZE;
+	if (!gfw_init_texture(&gfw_bench_target_texture, descriptor)
+		|| !gfw_init_framebuffer(&gfw_bench_target, &gfw_bench_target_texture)
+		|| !gfw_init_shader(&gfw_bench_shader, gfw_bench_vertex_source, NULL, gfw_bench_fragment_source)
+		|| !gfw_init_vertex_data(&gfw_bench_vertex_data, sizeof(triangle), GFW_VERTEX_DATA_USAGE_STATIC)
+		|| !gfw_init_vertex_data(&gfw_bench_stream_vertex_data, GFW_BENCH_STREAM_SIZE + 1, GFW_VERTEX_DATA_USAGE_DYNAMIC)
+		|| !gfw_init_vertex_state(&gfw_bench_vertex_state)) {
+		success = false;
+		goto done;
+	}
+	gfw_vertex_data_bind(&gfw_bench_vertex_data);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(triangle), triangle);
+	gfw_vertex_data_unbind();
+	gfw_framebuffer_bind(&gfw_bench_target);
+	gfw_set_viewport(0, 0, GFW_BENCH_TARGET_SIZE, GFW_BENCH_TARGET_SIZE);
+	gfw_shader_use(&gfw_bench_shader);
+	gfw_shader_set_uniform_float(gfw_shader_get_uniform_location(&gfw_bench_shader, "value"), 1.0f);
+done:
+	return success;
+}
+
+static void gfw_bench_free_resources(void)
+{
+	gfw_free_vertex_state(&gfw_bench_vertex_state);
+	gfw_free_vertex_data(&gfw_bench_stream_vertex_data);
+	gfw_free_vertex_data(&gfw_bench_vertex_data);
+	gfw_free_shader(&gfw_bench_shader);
+	gfw_free_framebuffer(&gfw_bench_target);
+	gfw_free_texture(&gfw_bench_target_texture);
+	free(gfw_bench_data);
+	if (gfw_bench_null) {
+		gfw_free_null_gl();
+	}
+}
+
+static void gfw_bench_run_all(void)
+{
+	struct gfw_bench_case bench_case = {0};
+	uint32_t sizes[3] = {64, 256, 1024};
+	uint32_t pixel_sizes[3] = {4, 3, 1};
+	enum gfw_texture_pixel_format pixel_formats[3] = {GFW_TEXTURE_PIXEL_FORMAT_RGBA, GFW_TEXTURE_PIXEL_FORMAT_RGB, GFW_TEXTURE_PIXEL_FORMAT_PALETTE};
+	char *pixel_format_names[3] = {"rgba", "rgb", "palette"};
+	uint32_t stream_sizes[3] = {4 * 1024, 256 * 1024, GFW_BENCH_STREAM_SIZE};
+	uint32_t i = 0;
+	uint32_t j = 0;
+	while (i < 3) {
+		j = 0;
+		while (j < 3) {
+			bench_case.name = "texture_upload";
+			snprintf(bench_case.parameters, sizeof(bench_case.parameters), "%s_%ux%u", pixel_format_names[j], sizes[i], sizes[i]);
+			bench_case.size = sizes[i];
+			bench_case.pixel_format = pixel_formats[j];
+			bench_case.iterations = sizes[i] >= 1024 ? 4 : 32;
+			bench_case.bytes = (uint64_t)sizes[i] * sizes[i] * pixel_sizes[j];
+			bench_case.run = gfw_bench_run_texture_upload;
+			gfw_bench_measure(&bench_case);
+			j++;
+		}
+		i++;
+	}
+	i = 0;
+	while (i < 3) {
+		snprintf(bench_case.parameters, sizeof(bench_case.parameters), "%u_bytes", stream_sizes[i]);
+		bench_case.size = stream_sizes[i];
+		bench_case.iterations = stream_sizes[i] >= GFW_BENCH_STREAM_SIZE ? 4 : 64;
+		bench_case.bytes = stream_sizes[i];
+		bench_case.name = "vertex_push";
+		bench_case.run = gfw_bench_run_vertex_push;
+		gfw_bench_measure(&bench_case);
+		bench_case.name = "vertex_map";
+		bench_case.run = gfw_bench_run_vertex_map;
+		gfw_bench_measure(&bench_case);
+		i++;
+	}
+	bench_case.name = "draw_submission";
+	snprintf(bench_case.parameters, sizeof(bench_case.parameters), "triangle");
+	bench_case.iterations = 10000;
+	bench_case.bytes = 0;
+	bench_case.run = gfw_bench_run_draw_submission;
+	gfw_bench_measure(&bench_case);
+	bench_case.name = "state_change";
+	snprintf(bench_case.parameters, sizeof(bench_case.parameters), "blend_depth_cull");
+	bench_case.run = gfw_bench_run_state_change;
+	gfw_bench_measure(&bench_case);
+	bench_case.name = "shader_compile";
+	snprintf(bench_case.parameters, sizeof(bench_case.parameters), "vertex_fragment");
+	bench_case.iterations = 8;
+	bench_case.run = gfw_bench_run_shader_compile;
+	gfw_bench_measure(&bench_case);
+}
+
+int main(int argc, char **argv)
+{
+	int status = EXIT_SUCCESS;
+	int i = 1;
+	while (i < argc) {
+		if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+			gfw_bench_warmup = (uint32_t)strtoul(argv[i + 1], NULL, 10);
+			i++;
+		} else if (strcmp(argv[i], "--repetitions") == 0 && i + 1 < argc) {
+			gfw_bench_repetitions = (uint32_t)strtoul(argv[i + 1], NULL, 10);
+			i++;
+		} else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+			gfw_bench_filter = argv[i + 1];
+			i++;
+		} else if (strcmp(argv[i], "--null") == 0) {
+			gfw_bench_null = true;
+		} else if (strcmp(argv[i], "--check") == 0) {
+			/* Checks read the calls recorded by the null backend */
+			gfw_bench_null = true;
+			gfw_bench_check = true;
+		} else {
+			fprintf(stderr, "Usage: %s [--warmup N] [--repetitions N] [--filter NAME] [--null] [--check]\n", argv[0]);
+			status = EXIT_FAILURE;
+			goto done;
+		}
+		i++;
+	}
+	if (gfw_bench_repetitions == 0 || gfw_bench_repetitions > GFW_BENCH_REPETITIONS_MAX) {
+		fprintf(stderr, "Error: repetitions must be between 1 and %u.\n", GFW_BENCH_REPETITIONS_MAX);
+		status = EXIT_FAILURE;
+		goto done;
+	}
+	if (gfw_bench_null) {
+		if (!gfw_load_null_gl(GFW_NULL_GL_MODE_DISCARD)) {
+			status = EXIT_FAILURE;
+			goto done;
+		}
+	} else if (!gfw_init_headless_context()) {
+		status = EXIT_FAILURE;
+		goto done;
+	}
+	if (!gfw_bench_init_resources()) {
+		fprintf(stderr, "Error: failed to initialize benchmark.\n");
+		status = EXIT_FAILURE;
+		goto done;
+	}
+	if (gfw_bench_check) {
+		if (!gfw_bench_check_state_elision()) {
+			status = EXIT_FAILURE;
+		}
+		gfw_bench_free_resources();
+		goto done;
+	}
+	printf("{\n\t\"renderer\": \"%s\",\n\t\"warmup\": %u,\n\t\"repetitions\": %u,\n\t\"benchmarks\": [",
+		(char *)glGetString(GL_RENDERER),
+		gfw_bench_warmup,
+		gfw_bench_repetitions);
+	gfw_bench_run_all();
+	printf("\n\t]\n}\n");
+	gfw_bench_free_resources();
+done:
+	return status;
+}
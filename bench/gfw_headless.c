@@ -0,0 +1,69 @@
+/*
+Copyright © 2018 Felipe Ferreira da Silva
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use of
+this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject to
+the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "gfw_headless.h"
+#include <stdio.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+/* Surfaceless EGL, so no window system is needed, e.g. Mesa llvmpipe */
+bool gfw_init_headless_context(void)
+{
+	bool success = true;
+	EGLDisplay display = EGL_NO_DISPLAY;
+	EGLContext context = EGL_NO_CONTEXT;
+	PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display = NULL;
+	EGLint attributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 5,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (get_platform_display) {
+		display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	}
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL) || !eglBindAPI(EGL_OPENGL_API)) {
+		success = false;
+		fprintf(stderr, "Error: failed to initialize EGL display.\n");
+		goto done;
+	}
+	context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes);
+	if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+		success = false;
+		fprintf(stderr, "Error: failed to create headless OpenGL context.\n");
+		goto done;
+	}
+#if defined(__glad_h_)
+	if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+		success = false;
+		fprintf(stderr, "Error: failed to load OpenGL functions.\n");
+		goto done;
+	}
+#elif defined(GLAD_GL_H_)
+	if (!gladLoadGL((GLADloadfunc)eglGetProcAddress)) {
+		success = false;
+		fprintf(stderr, "Error: failed to load OpenGL functions.\n");
+		goto done;
+	}
+#endif
+done:
+	return success;
+}
@@ -0,0 +1,1135 @@
+/*
+Copyright © 2018 Felipe Ferreira da Silva
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use of
+this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject to
+the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "gfw_null_gl.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Stubs replace the glad function pointers, so GFW runs without a driver */
+#if defined(__glad_h_) || defined(GLAD_GL_H_)
+#define GFW_NULL_GL_DISPATCH
+#endif
+
+static enum gfw_null_gl_mode gfw_null_gl_mode = GFW_NULL_GL_MODE_DISCARD;
+static struct gfw_null_gl_call *gfw_null_gl_calls = NULL;
+static size_t gfw_null_gl_calls_count = 0;
+static size_t gfw_null_gl_calls_capacity = 0;
+
+#ifdef GFW_NULL_GL_DISPATCH
+static GLuint gfw_null_gl_name = 0;
+static GLuint gfw_null_gl_array_buffer = 0;
+static GLsizeiptr *gfw_null_gl_buffer_sizes = NULL;
+static GLuint gfw_null_gl_buffer_sizes_capacity = 0;
+static uint8_t *gfw_null_gl_mapped = NULL;
+static GLsizeiptr gfw_null_gl_mapped_size = 0;
+
+static void gfw_null_gl_record(const char *function, uint32_t arguments_count, uint64_t *arguments)
+{
+	struct gfw_null_gl_call *calls = NULL;
+	struct gfw_null_gl_call *call = NULL;
+	size_t capacity = 0;
+	if (gfw_null_gl_mode != GFW_NULL_GL_MODE_RECORD) {
+		return;
+	}
+	if (gfw_null_gl_calls_count == gfw_null_gl_calls_capacity) {
+		capacity = gfw_null_gl_calls_capacity > 0 ? gfw_null_gl_calls_capacity * 2 : 1024;
+		calls = realloc(gfw_null_gl_calls, sizeof(*calls) * capacity);
+		if (!calls) {
+			return;
+		}
+		gfw_null_gl_calls = calls;
+		gfw_null_gl_calls_capacity = capacity;
+	}
+	call = &gfw_null_gl_calls[gfw_null_gl_calls_count];
+	call->function = function;
+	call->arguments_count = arguments_count < GFW_NULL_GL_ARGUMENTS_MAX ? arguments_count : GFW_NULL_GL_ARGUMENTS_MAX;
+	if (call->arguments_count > 0) {
+		memcpy(call->arguments, arguments, sizeof(*arguments) * call->arguments_count);
+	}
+	gfw_null_gl_calls_count++;
+}
+
+static uint64_t gfw_null_gl_float(double value)
+{
+	uint64_t bits = 0;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+static GLuint gfw_null_gl_generate_name(void)
+{
+	gfw_null_gl_name++;
+	return gfw_null_gl_name;
+}
+
+static void gfw_null_gl_generate_names(GLsizei n, GLuint *names)
+{
+	GLsizei i = 0;
+	while (i < n) {
+		names[i] = gfw_null_gl_generate_name();
+		i++;
+	}
+}
+
+/* Locations only have to be stable per name */
+static GLint gfw_null_gl_get_location(const GLchar *name)
+{
+	uint32_t hash = 2166136261u;
+	while (*name) {
+		hash = (hash ^ (uint8_t)*name) * 16777619u;
+		name++;
+	}
+	return (GLint)(hash & 0xffff);
+}
+
+static void gfw_null_gl_set_buffer_size(GLuint buffer, GLsizeiptr size)
+{
+	GLsizeiptr *sizes = NULL;
+	GLuint capacity = 0;
+	if (buffer >= gfw_null_gl_buffer_sizes_capacity) {
+		capacity = buffer * 2 + 64;
+		sizes = realloc(gfw_null_gl_buffer_sizes, sizeof(*sizes) * capacity);
+		if (!sizes) {
+			return;
+		}
+		memset(sizes + gfw_null_gl_buffer_sizes_capacity, 0, sizeof(*sizes) * (capacity - gfw_null_gl_buffer_sizes_capacity));
+		gfw_null_gl_buffer_sizes = sizes;
+		gfw_null_gl_buffer_sizes_capacity = capacity;
+	}
+	gfw_null_gl_buffer_sizes[buffer] = size;
+}
+
+static GLsizeiptr gfw_null_gl_get_buffer_size(GLuint buffer)
+{
+	GLsizeiptr size = 0;
+	if (buffer < gfw_null_gl_buffer_sizes_capacity) {
+		size = gfw_null_gl_buffer_sizes[buffer];
+	}
+	return size;
+}
+
+/* Every mapping shares one scratch allocation, its contents are never read */
+static void *gfw_null_gl_map(GLsizeiptr size)
+{
+	uint8_t *mapped = NULL;
+	if (size > gfw_null_gl_mapped_size) {
+		mapped = realloc(gfw_null_gl_mapped, size);
+		if (!mapped) {
+			return NULL;
+		}
+		gfw_null_gl_mapped = mapped;
+		gfw_null_gl_mapped_size = size;
+	}
+	return gfw_null_gl_mapped;
+}
+
+static void gfw_null_gl_get_integers(GLenum pname, GLint *data)
+{
+	data[0] = 0;
+	if (pname == GL_ARRAY_BUFFER_BINDING) {
+		data[0] = gfw_null_gl_array_buffer;
+	} else if (pname == GL_MAJOR_VERSION) {
+		data[0] = 4;
+	} else if (pname == GL_MINOR_VERSION) {
+		data[0] = 5;
+	} else if (pname == GL_VIEWPORT) {
+		memset(data, 0, 4 * sizeof(*data));
+	}
+}
+
+static void gfw_null_gl_get_text(GLsizei size, GLsizei *length, GLchar *text)
+{
+	if (length) {
+		*length = 0;
+	}
+	if (text && size > 0) {
+		text[0] = '\0';
+	}
+}
+
+static void APIENTRY gfw_null_glActiveTexture(GLenum texture)
+{
+	gfw_null_gl_record("glActiveTexture", 1, (uint64_t []){(uint64_t)texture});
+}
+
+static void APIENTRY gfw_null_glAttachShader(GLuint program, GLuint shader)
+{
+	gfw_null_gl_record("glAttachShader", 2, (uint64_t []){(uint64_t)program, (uint64_t)shader});
+}
+
+static void APIENTRY gfw_null_glBeginQuery(GLenum target, GLuint id)
+{
+	gfw_null_gl_record("glBeginQuery", 2, (uint64_t []){(uint64_t)target, (uint64_t)id});
+}
+
+static void APIENTRY gfw_null_glBeginTransformFeedback(GLenum primitiveMode)
+{
+	gfw_null_gl_record("glBeginTransformFeedback", 1, (uint64_t []){(uint64_t)primitiveMode});
+}
+
+static void APIENTRY gfw_null_glBindBuffer(GLenum target, GLuint buffer)
+{
+	gfw_null_gl_record("glBindBuffer", 2, (uint64_t []){(uint64_t)target, (uint64_t)buffer});
+	if (target == GL_ARRAY_BUFFER) {
+		gfw_null_gl_array_buffer = buffer;
+	}
+}
+
+static void APIENTRY gfw_null_glBindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+	gfw_null_gl_record("glBindBufferBase", 3, (uint64_t []){(uint64_t)target, (uint64_t)index, (uint64_t)buffer});
+}
+
+static void APIENTRY gfw_null_glBindFramebuffer(GLenum target, GLuint framebuffer)
+{
+	gfw_null_gl_record("glBindFramebuffer", 2, (uint64_t []){(uint64_t)target, (uint64_t)framebuffer});
+}
+
+static void APIENTRY gfw_null_glBindImageTexture(GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format)
+{
+	gfw_null_gl_record("glBindImageTexture", 7, (uint64_t []){(uint64_t)unit, (uint64_t)texture, (uint64_t)level, (uint64_t)layered, (uint64_t)layer, (uint64_t)access, (uint64_t)format});
+}
+
+static void APIENTRY gfw_null_glBindProgramPipeline(GLuint pipeline)
+{
+	gfw_null_gl_record("glBindProgramPipeline", 1, (uint64_t []){(uint64_t)pipeline});
+}
+
+static void APIENTRY gfw_null_glBindTexture(GLenum target, GLuint texture)
+{
+	gfw_null_gl_record("glBindTexture", 2, (uint64_t []){(uint64_t)target, (uint64_t)texture});
+}
+
+static void APIENTRY gfw_null_glBindTransformFeedback(GLenum target, GLuint id)
+{
+	gfw_null_gl_record("glBindTransformFeedback", 2, (uint64_t []){(uint64_t)target, (uint64_t)id});
+}
+
+static void APIENTRY gfw_null_glBindVertexArray(GLuint array)
+{
+	gfw_null_gl_record("glBindVertexArray", 1, (uint64_t []){(uint64_t)array});
+}
+
+static void APIENTRY gfw_null_glBindVertexBuffer(GLuint bindingindex, GLuint buffer, GLintptr offset, GLsizei stride)
+{
+	gfw_null_gl_record("glBindVertexBuffer", 4, (uint64_t []){(uint64_t)bindingindex, (uint64_t)buffer, (uint64_t)offset, (uint64_t)stride});
+}
+
+static void APIENTRY gfw_null_glBlendColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+{
+	gfw_null_gl_record("glBlendColor", 4, (uint64_t []){gfw_null_gl_float(red), gfw_null_gl_float(green), gfw_null_gl_float(blue), gfw_null_gl_float(alpha)});
+}
+
+static void APIENTRY gfw_null_glBlendEquationSeparate(GLenum modeRGB, GLenum modeAlpha)
+{
+	gfw_null_gl_record("glBlendEquationSeparate", 2, (uint64_t []){(uint64_t)modeRGB, (uint64_t)modeAlpha});
+}
+
+static void APIENTRY gfw_null_glBlendFuncSeparate(GLenum sfactorRGB, GLenum dfactorRGB, GLenum sfactorAlpha, GLenum dfactorAlpha)
+{
+	gfw_null_gl_record("glBlendFuncSeparate", 4, (uint64_t []){(uint64_t)sfactorRGB, (uint64_t)dfactorRGB, (uint64_t)sfactorAlpha, (uint64_t)dfactorAlpha});
+}
+
+static void APIENTRY gfw_null_glBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage)
+{
+	gfw_null_gl_record("glBufferData", 4, (uint64_t []){(uint64_t)target, (uint64_t)size, (uint64_t)(uintptr_t)data, (uint64_t)usage});
+	if (target == GL_ARRAY_BUFFER) {
+		gfw_null_gl_set_buffer_size(gfw_null_gl_array_buffer, size);
+	}
+}
+
+static void APIENTRY gfw_null_glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data)
+{
+	gfw_null_gl_record("glBufferSubData", 4, (uint64_t []){(uint64_t)target, (uint64_t)offset, (uint64_t)size, (uint64_t)(uintptr_t)data});
+}
+
+static GLenum APIENTRY gfw_null_glCheckFramebufferStatus(GLenum target)
+{
+	gfw_null_gl_record("glCheckFramebufferStatus", 1, (uint64_t []){(uint64_t)target});
+	return GL_FRAMEBUFFER_COMPLETE;
+}
+
+static void APIENTRY gfw_null_glClear(GLbitfield mask)
+{
+	gfw_null_gl_record("glClear", 1, (uint64_t []){(uint64_t)mask});
+}
+
+static void APIENTRY gfw_null_glClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+{
+	gfw_null_gl_record("glClearColor", 4, (uint64_t []){gfw_null_gl_float(red), gfw_null_gl_float(green), gfw_null_gl_float(blue), gfw_null_gl_float(alpha)});
+}
+
+static void APIENTRY gfw_null_glClearDepth(GLdouble depth)
+{
+	gfw_null_gl_record("glClearDepth", 1, (uint64_t []){gfw_null_gl_float(depth)});
+}
+
+static GLenum APIENTRY gfw_null_glClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+{
+	gfw_null_gl_record("glClientWaitSync", 3, (uint64_t []){(uint64_t)(uintptr_t)sync, (uint64_t)flags, (uint64_t)timeout});
+	return GL_ALREADY_SIGNALED;
+}
+
+static void APIENTRY gfw_null_glCompileShader(GLuint shader)
+{
+	gfw_null_gl_record("glCompileShader", 1, (uint64_t []){(uint64_t)shader});
+}
+
+static GLuint APIENTRY gfw_null_glCreateProgram(void)
+{
+	gfw_null_gl_record("glCreateProgram", 0, NULL);
+	return gfw_null_gl_generate_name();
+}
+
+static GLuint APIENTRY gfw_null_glCreateShader(GLenum type)
+{
+	gfw_null_gl_record("glCreateShader", 1, (uint64_t []){(uint64_t)type});
+	return gfw_null_gl_generate_name();
+}
+
+static GLuint APIENTRY gfw_null_glCreateShaderProgramv(GLenum type, GLsizei count, const GLchar *const *strings)
+{
+	gfw_null_gl_record("glCreateShaderProgramv", 3, (uint64_t []){(uint64_t)type, (uint64_t)count, (uint64_t)(uintptr_t)strings});
+	return gfw_null_gl_generate_name();
+}
+
+static void APIENTRY gfw_null_glCullFace(GLenum mode)
+{
+	gfw_null_gl_record("glCullFace", 1, (uint64_t []){(uint64_t)mode});
+}
+
+static void APIENTRY gfw_null_glDebugMessageCallback(GLDEBUGPROC callback, const void *userParam)
+{
+	gfw_null_gl_record("glDebugMessageCallback", 2, (uint64_t []){(uint64_t)callback, (uint64_t)(uintptr_t)userParam});
+}
+
+static void APIENTRY gfw_null_glDebugMessageControl(GLenum source, GLenum type, GLenum severity, GLsizei count, const GLuint *ids, GLboolean enabled)
+{
+	gfw_null_gl_record("glDebugMessageControl", 6, (uint64_t []){(uint64_t)source, (uint64_t)type, (uint64_t)severity, (uint64_t)count, (uint64_t)(uintptr_t)ids, (uint64_t)enabled});
+}
+
+static void APIENTRY gfw_null_glDeleteBuffers(GLsizei n, const GLuint *buffers)
+{
+	gfw_null_gl_record("glDeleteBuffers", 2, (uint64_t []){(uint64_t)n, (uint64_t)(uintptr_t)buffers});
+}
+
+static void APIENTRY gfw_null_glDeleteFramebuffers(GLsizei n, const GLuint *framebuffers)
+{
+	gfw_null_gl_record("glDeleteFramebuffers", 2, (uint64_t []){(uint64_t)n, (uint64_t)(uintptr_t)framebuffers});
+}
+
+static void APIENTRY gfw_null_glDeleteProgram(GLuint program)
+{
+	gfw_null_gl_record("glDeleteProgram", 1, (uint64_t []){(uint64_t)program});
+}
+
+static void APIENTRY gfw_null_glDeleteProgramPipelines(GLsizei n, const GLuint *pipelines)
+{
+	gfw_null_gl_record("glDeleteProgramPipelines", 2, (uint64_t []){(uint64_t)n, (uint64_t)(uintptr_t)pipelines});
+}
+
+static void APIENTRY gfw_null_glDeleteQueries(GLsizei n, const GLuint *ids)
+{
+	gfw_null_gl_record("glDeleteQueries", 2, (uint64_t []){(uint64_t)n, (uint64_t)(uintptr_t)ids});
+}
+
+static void APIENTRY gfw_null_glDeleteShader(GLuint shader)
+{
+	gfw_null_gl_record("glDeleteShader", 1, (uint64_t []){(uint64_t)shader});
+}
+
+static void APIENTRY gfw_null_glDeleteSync(GLsync sync)
+{
+	gfw_null_gl_record("glDeleteSync", 1, (uint64_t []){(uint64_t)(uintptr_t)sync});
+}
+
+static void APIENTRY gfw_null_glDeleteTextures(GLsizei n, const GLuint *textures)
+{
+	gfw_null_gl_record("glDeleteTextures", 2, (uint64_t []){(uint64_t)n, (uint64_t)(uintptr_t)textures});
+}
+
+static void APIENTRY gfw_null_glDeleteTransformFeedbacks(GLsizei n, const GLuint *ids)
+{
+	gfw_null_gl_record("glDeleteTransformFeedbacks", 2, (uint64_t []){(uint64_t)n, (uint64_t)(uintptr_t)ids});
+}
+
+static void APIENTRY gfw_null_glDeleteVertexArrays(GLsizei n, const GLuint *arrays)
+{
+	gfw_null_gl_record("glDeleteVertexArrays", 2, (uint64_t []){(uint64_t)n, (uint64_t)(uintptr_t)arrays});
+}
+
+static void APIENTRY gfw_null_glDepthFunc(GLenum func)
+{
+	gfw_null_gl_record("glDepthFunc", 1, (uint64_t []){(uint64_t)func});
+}
+
+static void APIENTRY gfw_null_glDepthRange(GLdouble n, GLdouble f)
+{
+	gfw_null_gl_record("glDepthRange", 2, (uint64_t []){gfw_null_gl_float(n), gfw_null_gl_float(f)});
+}
+
+static void APIENTRY gfw_null_glDetachShader(GLuint program, GLuint shader)
+{
+	gfw_null_gl_record("glDetachShader", 2, (uint64_t []){(uint64_t)program, (uint64_t)shader});
+}
+
+static void APIENTRY gfw_null_glDisable(GLenum cap)
+{
+	gfw_null_gl_record("glDisable", 1, (uint64_t []){(uint64_t)cap});
+}
+
+static void APIENTRY gfw_null_glDisableVertexAttribArray(GLuint index)
+{
+	gfw_null_gl_record("glDisableVertexAttribArray", 1, (uint64_t []){(uint64_t)index});
+}
+
+static void APIENTRY gfw_null_glDispatchCompute(GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z)
+{
+	gfw_null_gl_record("glDispatchCompute", 3, (uint64_t []){(uint64_t)num_groups_x, (uint64_t)num_groups_y, (uint64_t)num_groups_z});
+}
+
+static void APIENTRY gfw_null_glDispatchComputeIndirect(GLintptr indirect)
+{
+	gfw_null_gl_record("glDispatchComputeIndirect", 1, (uint64_t []){(uint64_t)indirect});
+}
+
+static void APIENTRY gfw_null_glDrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+	gfw_null_gl_record("glDrawArrays", 3, (uint64_t []){(uint64_t)mode, (uint64_t)first, (uint64_t)count});
+}
+
+static void APIENTRY gfw_null_glDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancecount)
+{
+	gfw_null_gl_record("glDrawArraysInstanced", 4, (uint64_t []){(uint64_t)mode, (uint64_t)first, (uint64_t)count, (uint64_t)instancecount});
+}
+
+static void APIENTRY gfw_null_glDrawArraysInstancedBaseInstance(GLenum mode, GLint first, GLsizei count, GLsizei instancecount, GLuint baseinstance)
+{
+	gfw_null_gl_record("glDrawArraysInstancedBaseInstance", 5, (uint64_t []){(uint64_t)mode, (uint64_t)first, (uint64_t)count, (uint64_t)instancecount, (uint64_t)baseinstance});
+}
+
+static void APIENTRY gfw_null_glDrawElements(GLenum mode, GLsizei count, GLenum type, const void *indices)
+{
+	gfw_null_gl_record("glDrawElements", 4, (uint64_t []){(uint64_t)mode, (uint64_t)count, (uint64_t)type, (uint64_t)(uintptr_t)indices});
+}
+
+static void APIENTRY gfw_null_glDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instancecount)
+{
+	gfw_null_gl_record("glDrawElementsInstanced", 5, (uint64_t []){(uint64_t)mode, (uint64_t)count, (uint64_t)type, (uint64_t)(uintptr_t)indices, (uint64_t)instancecount});
+}
+
+static void APIENTRY gfw_null_glDrawElementsInstancedBaseInstance(GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instancecount, GLuint baseinstance)
+{
+	gfw_null_gl_record("glDrawElementsInstancedBaseInstance", 6, (uint64_t []){(uint64_t)mode, (uint64_t)count, (uint64_t)type, (uint64_t)(uintptr_t)indices, (uint64_t)instancecount, (uint64_t)baseinstance});
+}
+
+static void APIENTRY gfw_null_glDrawTransformFeedback(GLenum mode, GLuint id)
+{
+	gfw_null_gl_record("glDrawTransformFeedback", 2, (uint64_t []){(uint64_t)mode, (uint64_t)id});
+}
+
+static void APIENTRY gfw_null_glEnable(GLenum cap)
+{
+	gfw_null_gl_record("glEnable", 1, (uint64_t []){(uint64_t)cap});
+}
+
+static void APIENTRY gfw_null_glEnableVertexAttribArray(GLuint index)
+{
+	gfw_null_gl_record("glEnableVertexAttribArray", 1, (uint64_t []){(uint64_t)index});
+}
+
+static void APIENTRY gfw_null_glEndQuery(GLenum target)
+{
+	gfw_null_gl_record("glEndQuery", 1, (uint64_t []){(uint64_t)target});
+}
+
+static void APIENTRY gfw_null_glEndTransformFeedback(void)
+{
+	gfw_null_gl_record("glEndTransformFeedback", 0, NULL);
+}
+
+/* Fences only have to be distinct and non-zero */
+static GLsync APIENTRY gfw_null_glFenceSync(GLenum condition, GLbitfield flags)
+{
+	gfw_null_gl_record("glFenceSync", 2, (uint64_t []){(uint64_t)condition, (uint64_t)flags});
+	return (GLsync)(uintptr_t)gfw_null_gl_generate_name();
+}
+
+static void APIENTRY gfw_null_glFinish(void)
+{
+	gfw_null_gl_record("glFinish", 0, NULL);
+}
+
+static void APIENTRY gfw_null_glFramebufferTexture(GLenum target, GLenum attachment, GLuint texture, GLint level)
+{
+	gfw_null_gl_record("glFramebufferTexture", 4, (uint64_t []){(uint64_t)target, (uint64_t)attachment, (uint64_t)texture, (uint64_t)level});
+}
+
+static void APIENTRY gfw_null_glFrontFace(GLenum mode)
+{
+	gfw_null_gl_record("glFrontFace", 1, (uint64_t []){(uint64_t)mode});
+}
+
+static void APIENTRY gfw_null_glGenBuffers(GLsizei n, GLuint *buffers)
+{
+	gfw_null_gl_record("glGenBuffers", 2, (uint64_t []){(uint64_t)n, (uint64_t)(uintptr_t)buffers});
+	gfw_null_gl_generate_names(n, buffers);
+}
+
+static void APIENTRY gfw_null_glGenFramebuffers(GLsizei n, GLuint *framebuffers)
+{
+	gfw_null_gl_record("glGenFramebuffers", 2, (uint64_t []){(uint64_t)n, (uint64_t)(uintptr_t)framebuffers});
+	gfw_null_gl_generate_names(n, framebuffers);
+}
+
+static void APIENTRY gfw_null_glGenProgramPipelines(GLsizei n, GLuint *pipelines)
+{
+	gfw_null_gl_record("glGenProgramPipelines", 2, (uint64_t []){(uint64_t)n, (uint64_t)(uintptr_t)pipelines});
+	gfw_null_gl_generate_names(n, pipelines);
+}
+
+static void APIENTRY gfw_null_glGenQueries(GLsizei n, GLuint *ids)
+{
+	gfw_null_gl_record("glGenQueries", 2, (uint64_t []){(uint64_t)n, (uint64_t)(uintptr_t)ids});
+	gfw_null_gl_generate_names(n, ids);
+}
+
+static void APIENTRY gfw_null_glGenTextures(GLsizei n, GLuint *textures)
+{
+	gfw_null_gl_record("glGenTextures", 2, (uint64_t []){(uint64_t)n, (uint64_t)(uintptr_t)textures});
+	gfw_null_gl_generate_names(n, textures);
+}
+
+static void APIENTRY gfw_null_glGenTransformFeedbacks(GLsizei n, GLuint *ids)
+{
+	gfw_null_gl_record("glGenTransformFeedbacks", 2, (uint64_t []){(uint64_t)n, (uint64_t)(uintptr_t)ids});
+	gfw_null_gl_generate_names(n, ids);
+}
+
+static void APIENTRY gfw_null_glGenVertexArrays(GLsizei n, GLuint *arrays)
+{
+	gfw_null_gl_record("glGenVertexArrays", 2, (uint64_t []){(uint64_t)n, (uint64_t)(uintptr_t)arrays});
+	gfw_null_gl_generate_names(n, arrays);
+}
+
+static void APIENTRY gfw_null_glGetActiveAttrib(GLuint program, GLuint index, GLsizei bufSize, GLsizei *length, GLint *size, GLenum *type, GLchar *name)
+{
+	gfw_null_gl_record("glGetActiveAttrib", 7, (uint64_t []){(uint64_t)program, (uint64_t)index, (uint64_t)bufSize, (uint64_t)(uintptr_t)length, (uint64_t)(uintptr_t)size, (uint64_t)(uintptr_t)type, (uint64_t)(uintptr_t)name});
+	*size = 0;
+	*type = GL_FLOAT;
+	gfw_null_gl_get_text(bufSize, length, name);
+}
+
+static void APIENTRY gfw_null_glGetActiveUniform(GLuint program, GLuint index, GLsizei bufSize, GLsizei *length, GLint *size, GLenum *type, GLchar *name)
+{
+	gfw_null_gl_record("glGetActiveUniform", 7, (uint64_t []){(uint64_t)program, (uint64_t)index, (uint64_t)bufSize, (uint64_t)(uintptr_t)length, (uint64_t)(uintptr_t)size, (uint64_t)(uintptr_t)type, (uint64_t)(uintptr_t)name});
+	*size = 0;
+	*type = GL_FLOAT;
+	gfw_null_gl_get_text(bufSize, length, name);
+}
+
+static void APIENTRY gfw_null_glGetActiveUniformBlockName(GLuint program, GLuint uniformBlockIndex, GLsizei bufSize, GLsizei *length, GLchar *uniformBlockName)
+{
+	gfw_null_gl_record("glGetActiveUniformBlockName", 5, (uint64_t []){(uint64_t)program, (uint64_t)uniformBlockIndex, (uint64_t)bufSize, (uint64_t)(uintptr_t)length, (uint64_t)(uintptr_t)uniformBlockName});
+	gfw_null_gl_get_text(bufSize, length, uniformBlockName);
+}
+
+static void APIENTRY gfw_null_glGetActiveUniformBlockiv(GLuint program, GLuint uniformBlockIndex, GLenum pname, GLint *params)
+{
+	gfw_null_gl_record("glGetActiveUniformBlockiv", 4, (uint64_t []){(uint64_t)program, (uint64_t)uniformBlockIndex, (uint64_t)pname, (uint64_t)(uintptr_t)params});
+	*params = 0;
+}
+
+static GLint APIENTRY gfw_null_glGetAttribLocation(GLuint program, const GLchar *name)
+{
+	gfw_null_gl_record("glGetAttribLocation", 2, (uint64_t []){(uint64_t)program, (uint64_t)(uintptr_t)name});
+	return gfw_null_gl_get_location(name);
+}
+
+static GLenum APIENTRY gfw_null_glGetError(void)
+{
+	gfw_null_gl_record("glGetError", 0, NULL);
+	return GL_NO_ERROR;
+}
+
+static void APIENTRY gfw_null_glGetFloatv(GLenum pname, GLfloat *data)
+{
+	gfw_null_gl_record("glGetFloatv", 2, (uint64_t []){(uint64_t)pname, (uint64_t)(uintptr_t)data});
+	data[0] = 0.0f;
+	if (pname == GL_BLEND_COLOR) {
+		memset(data, 0, 4 * sizeof(*data));
+	} else if (pname == GL_DEPTH_RANGE) {
+		data[1] = 1.0f;
+	} else if (pname == GL_POINT_SIZE || pname == GL_LINE_WIDTH) {
+		data[0] = 1.0f;
+	}
+}
+
+static void APIENTRY gfw_null_glGetIntegerv(GLenum pname, GLint *data)
+{
+	gfw_null_gl_record("glGetIntegerv", 2, (uint64_t []){(uint64_t)pname, (uint64_t)(uintptr_t)data});
+	gfw_null_gl_get_integers(pname, data);
+}
+
+static void APIENTRY gfw_null_glGetProgramBinary(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary)
+{
+	gfw_null_gl_record("glGetProgramBinary", 5, (uint64_t []){(uint64_t)program, (uint64_t)bufSize, (uint64_t)(uintptr_t)length, (uint64_t)(uintptr_t)binaryFormat, (uint64_t)(uintptr_t)binary});
+	gfw_null_gl_get_text(0, length, NULL);
+}
+
+static void APIENTRY gfw_null_glGetProgramInfoLog(GLuint program, GLsizei bufSize, GLsizei *length, GLchar *infoLog)
+{
+	gfw_null_gl_record("glGetProgramInfoLog", 4, (uint64_t []){(uint64_t)program, (uint64_t)bufSize, (uint64_t)(uintptr_t)length, (uint64_t)(uintptr_t)infoLog});
+	gfw_null_gl_get_text(bufSize, length, infoLog);
+}
+
+static void APIENTRY gfw_null_glGetProgramiv(GLuint program, GLenum pname, GLint *params)
+{
+	gfw_null_gl_record("glGetProgramiv", 3, (uint64_t []){(uint64_t)program, (uint64_t)pname, (uint64_t)(uintptr_t)params});
+	*params = pname == GL_LINK_STATUS || pname == GL_COMPLETION_STATUS_KHR ? GL_TRUE : 0;
+}
+
+static void APIENTRY gfw_null_glGetQueryObjectiv(GLuint id, GLenum pname, GLint *params)
+{
+	gfw_null_gl_record("glGetQueryObjectiv", 3, (uint64_t []){(uint64_t)id, (uint64_t)pname, (uint64_t)(uintptr_t)params});
+	*params = pname == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+}
+
+static void APIENTRY gfw_null_glGetQueryObjectui64v(GLuint id, GLenum pname, GLuint64 *params)
+{
+	gfw_null_gl_record("glGetQueryObjectui64v", 3, (uint64_t []){(uint64_t)id, (uint64_t)pname, (uint64_t)(uintptr_t)params});
+	*params = pname == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+}
+
+static void APIENTRY gfw_null_glGetQueryObjectuiv(GLuint id, GLenum pname, GLuint *params)
+{
+	gfw_null_gl_record("glGetQueryObjectuiv", 3, (uint64_t []){(uint64_t)id, (uint64_t)pname, (uint64_t)(uintptr_t)params});
+	*params = pname == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+}
+
+static void APIENTRY gfw_null_glGetShaderInfoLog(GLuint shader, GLsizei bufSize, GLsizei *length, GLchar *infoLog)
+{
+	gfw_null_gl_record("glGetShaderInfoLog", 4, (uint64_t []){(uint64_t)shader, (uint64_t)bufSize, (uint64_t)(uintptr_t)length, (uint64_t)(uintptr_t)infoLog});
+	gfw_null_gl_get_text(bufSize, length, infoLog);
+}
+
+static void APIENTRY gfw_null_glGetShaderiv(GLuint shader, GLenum pname, GLint *params)
+{
+	gfw_null_gl_record("glGetShaderiv", 3, (uint64_t []){(uint64_t)shader, (uint64_t)pname, (uint64_t)(uintptr_t)params});
+	*params = pname == GL_COMPILE_STATUS || pname == GL_COMPLETION_STATUS_KHR ? GL_TRUE : 0;
+}
+
+static const GLubyte * APIENTRY gfw_null_glGetString(GLenum name)
+{
+	gfw_null_gl_record("glGetString", 1, (uint64_t []){(uint64_t)name});
+	return (const GLubyte *)"GFW null";
+}
+
+static const GLubyte * APIENTRY gfw_null_glGetStringi(GLenum name, GLuint index)
+{
+	gfw_null_gl_record("glGetStringi", 2, (uint64_t []){(uint64_t)name, (uint64_t)index});
+	return (const GLubyte *)"";
+}
+
+static GLint APIENTRY gfw_null_glGetUniformLocation(GLuint program, const GLchar *name)
+{
+	gfw_null_gl_record("glGetUniformLocation", 2, (uint64_t []){(uint64_t)program, (uint64_t)(uintptr_t)name});
+	return gfw_null_gl_get_location(name);
+}
+
+static void APIENTRY gfw_null_glGetUniformfv(GLuint program, GLint location, GLfloat *params)
+{
+	gfw_null_gl_record("glGetUniformfv", 3, (uint64_t []){(uint64_t)program, (uint64_t)location, (uint64_t)(uintptr_t)params});
+}
+
+static void APIENTRY gfw_null_glGetUniformiv(GLuint program, GLint location, GLint *params)
+{
+	gfw_null_gl_record("glGetUniformiv", 3, (uint64_t []){(uint64_t)program, (uint64_t)location, (uint64_t)(uintptr_t)params});
+}
+
+static void APIENTRY gfw_null_glGetUniformuiv(GLuint program, GLint location, GLuint *params)
+{
+	gfw_null_gl_record("glGetUniformuiv", 3, (uint64_t []){(uint64_t)program, (uint64_t)location, (uint64_t)(uintptr_t)params});
+}
+
+static GLboolean APIENTRY gfw_null_glIsBuffer(GLuint buffer)
+{
+	gfw_null_gl_record("glIsBuffer", 1, (uint64_t []){(uint64_t)buffer});
+	return GL_TRUE;
+}
+
+static GLboolean APIENTRY gfw_null_glIsEnabled(GLenum cap)
+{
+	gfw_null_gl_record("glIsEnabled", 1, (uint64_t []){(uint64_t)cap});
+	return GL_FALSE;
+}
+
+static GLboolean APIENTRY gfw_null_glIsFramebuffer(GLuint framebuffer)
+{
+	gfw_null_gl_record("glIsFramebuffer", 1, (uint64_t []){(uint64_t)framebuffer});
+	return GL_TRUE;
+}
+
+static GLboolean APIENTRY gfw_null_glIsTexture(GLuint texture)
+{
+	gfw_null_gl_record("glIsTexture", 1, (uint64_t []){(uint64_t)texture});
+	return GL_TRUE;
+}
+
+static GLboolean APIENTRY gfw_null_glIsVertexArray(GLuint array)
+{
+	gfw_null_gl_record("glIsVertexArray", 1, (uint64_t []){(uint64_t)array});
+	return GL_TRUE;
+}
+
+static void APIENTRY gfw_null_glLineWidth(GLfloat width)
+{
+	gfw_null_gl_record("glLineWidth", 1, (uint64_t []){gfw_null_gl_float(width)});
+}
+
+static void APIENTRY gfw_null_glLinkProgram(GLuint program)
+{
+	gfw_null_gl_record("glLinkProgram", 1, (uint64_t []){(uint64_t)program});
+}
+
+static void APIENTRY gfw_null_glLogicOp(GLenum opcode)
+{
+	gfw_null_gl_record("glLogicOp", 1, (uint64_t []){(uint64_t)opcode});
+}
+
+static void * APIENTRY gfw_null_glMapBuffer(GLenum target, GLenum access)
+{
+	gfw_null_gl_record("glMapBuffer", 2, (uint64_t []){(uint64_t)target, (uint64_t)access});
+	return gfw_null_gl_map(gfw_null_gl_get_buffer_size(target == GL_ARRAY_BUFFER ? gfw_null_gl_array_buffer : 0));
+}
+
+static void * APIENTRY gfw_null_glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+	gfw_null_gl_record("glMapBufferRange", 4, (uint64_t []){(uint64_t)target, (uint64_t)offset, (uint64_t)length, (uint64_t)access});
+	return gfw_null_gl_map(length);
+}
+
+static void APIENTRY gfw_null_glMemoryBarrier(GLbitfield barriers)
+{
+	gfw_null_gl_record("glMemoryBarrier", 1, (uint64_t []){(uint64_t)barriers});
+}
+
+static void APIENTRY gfw_null_glMultiDrawArrays(GLenum mode, const GLint *first, const GLsizei *count, GLsizei drawcount)
+{
+	gfw_null_gl_record("glMultiDrawArrays", 4, (uint64_t []){(uint64_t)mode, (uint64_t)(uintptr_t)first, (uint64_t)(uintptr_t)count, (uint64_t)drawcount});
+}
+
+static void APIENTRY gfw_null_glMultiDrawArraysIndirect(GLenum mode, const void *indirect, GLsizei drawcount, GLsizei stride)
+{
+	gfw_null_gl_record("glMultiDrawArraysIndirect", 4, (uint64_t []){(uint64_t)mode, (uint64_t)(uintptr_t)indirect, (uint64_t)drawcount, (uint64_t)stride});
+}
+
+static void APIENTRY gfw_null_glMultiDrawElements(GLenum mode, const GLsizei *count, GLenum type, const void *const *indices, GLsizei drawcount)
+{
+	gfw_null_gl_record("glMultiDrawElements", 5, (uint64_t []){(uint64_t)mode, (uint64_t)(uintptr_t)count, (uint64_t)type, (uint64_t)(uintptr_t)indices, (uint64_t)drawcount});
+}
+
+static void APIENTRY gfw_null_glObjectLabel(GLenum identifier, GLuint name, GLsizei length, const GLchar *label)
+{
+	gfw_null_gl_record("glObjectLabel", 4, (uint64_t []){(uint64_t)identifier, (uint64_t)name, (uint64_t)length, (uint64_t)(uintptr_t)label});
+}
+
+static void APIENTRY gfw_null_glPointSize(GLfloat size)
+{
+	gfw_null_gl_record("glPointSize", 1, (uint64_t []){gfw_null_gl_float(size)});
+}
+
+static void APIENTRY gfw_null_glPopDebugGroup(void)
+{
+	gfw_null_gl_record("glPopDebugGroup", 0, NULL);
+}
+
+static void APIENTRY gfw_null_glProgramBinary(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length)
+{
+	gfw_null_gl_record("glProgramBinary", 4, (uint64_t []){(uint64_t)program, (uint64_t)binaryFormat, (uint64_t)(uintptr_t)binary, (uint64_t)length});
+}
+
+static void APIENTRY gfw_null_glProgramParameteri(GLuint program, GLenum pname, GLint value)
+{
+	gfw_null_gl_record("glProgramParameteri", 3, (uint64_t []){(uint64_t)program, (uint64_t)pname, (uint64_t)value});
+}
+
+static void APIENTRY gfw_null_glProgramUniform1f(GLuint program, GLint location, GLfloat v0)
+{
+	gfw_null_gl_record("glProgramUniform1f", 3, (uint64_t []){(uint64_t)program, (uint64_t)location, gfw_null_gl_float(v0)});
+}
+
+static void APIENTRY gfw_null_glProgramUniform1fv(GLuint program, GLint location, GLsizei count, const GLfloat *value)
+{
+	gfw_null_gl_record("glProgramUniform1fv", 4, (uint64_t []){(uint64_t)program, (uint64_t)location, (uint64_t)count, (uint64_t)(uintptr_t)value});
+}
+
+static void APIENTRY gfw_null_glProgramUniform1i(GLuint program, GLint location, GLint v0)
+{
+	gfw_null_gl_record("glProgramUniform1i", 3, (uint64_t []){(uint64_t)program, (uint64_t)location, (uint64_t)v0});
+}
+
+static void APIENTRY gfw_null_glProgramUniform1iv(GLuint program, GLint location, GLsizei count, const GLint *value)
+{
+	gfw_null_gl_record("glProgramUniform1iv", 4, (uint64_t []){(uint64_t)program, (uint64_t)location, (uint64_t)count, (uint64_t)(uintptr_t)value});
+}
+
+static void APIENTRY gfw_null_glProgramUniform1ui(GLuint program, GLint location, GLuint v0)
+{
+	gfw_null_gl_record("glProgramUniform1ui", 3, (uint64_t []){(uint64_t)program, (uint64_t)location, (uint64_t)v0});
+}
+
+static void APIENTRY gfw_null_glProgramUniform1uiv(GLuint program, GLint location, GLsizei count, const GLuint *value)
+{
+	gfw_null_gl_record("glProgramUniform1uiv", 4, (uint64_t []){(uint64_t)program, (uint64_t)location, (uint64_t)count, (uint64_t)(uintptr_t)value});
+}
+
+static void APIENTRY gfw_null_glProgramUniformMatrix3fv(GLuint program, GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
+{
+	gfw_null_gl_record("glProgramUniformMatrix3fv", 5, (uint64_t []){(uint64_t)program, (uint64_t)location, (uint64_t)count, (uint64_t)transpose, (uint64_t)(uintptr_t)value});
+}
+
+static void APIENTRY gfw_null_glProgramUniformMatrix4fv(GLuint program, GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
+{
+	gfw_null_gl_record("glProgramUniformMatrix4fv", 5, (uint64_t []){(uint64_t)program, (uint64_t)location, (uint64_t)count, (uint64_t)transpose, (uint64_t)(uintptr_t)value});
+}
+
+static void APIENTRY gfw_null_glPushDebugGroup(GLenum source, GLuint id, GLsizei length, const GLchar *message)
+{
+	gfw_null_gl_record("glPushDebugGroup", 4, (uint64_t []){(uint64_t)source, (uint64_t)id, (uint64_t)length, (uint64_t)(uintptr_t)message});
+}
+
+static void APIENTRY gfw_null_glQueryCounter(GLuint id, GLenum target)
+{
+	gfw_null_gl_record("glQueryCounter", 2, (uint64_t []){(uint64_t)id, (uint64_t)target});
+}
+
+static void APIENTRY gfw_null_glShaderSource(GLuint shader, GLsizei count, const GLchar *const *string, const GLint *length)
+{
+	gfw_null_gl_record("glShaderSource", 4, (uint64_t []){(uint64_t)shader, (uint64_t)count, (uint64_t)(uintptr_t)string, (uint64_t)(uintptr_t)length});
+}
+
+static void APIENTRY gfw_null_glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels)
+{
+	gfw_null_gl_record("glTexImage2D", 9, (uint64_t []){(uint64_t)target, (uint64_t)level, (uint64_t)internalformat, (uint64_t)width, (uint64_t)height, (uint64_t)border, (uint64_t)format, (uint64_t)type, (uint64_t)(uintptr_t)pixels});
+}
+
+static void APIENTRY gfw_null_glTexParameteri(GLenum target, GLenum pname, GLint param)
+{
+	gfw_null_gl_record("glTexParameteri", 3, (uint64_t []){(uint64_t)target, (uint64_t)pname, (uint64_t)param});
+}
+
+static void APIENTRY gfw_null_glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels)
+{
+	gfw_null_gl_record("glTexSubImage2D", 9, (uint64_t []){(uint64_t)target, (uint64_t)level, (uint64_t)xoffset, (uint64_t)yoffset, (uint64_t)width, (uint64_t)height, (uint64_t)format, (uint64_t)type, (uint64_t)(uintptr_t)pixels});
+}
+
+static void APIENTRY gfw_null_glTransformFeedbackVaryings(GLuint program, GLsizei count, const GLchar *const *varyings, GLenum bufferMode)
+{
+	gfw_null_gl_record("glTransformFeedbackVaryings", 4, (uint64_t []){(uint64_t)program, (uint64_t)count, (uint64_t)(uintptr_t)varyings, (uint64_t)bufferMode});
+}
+
+static void APIENTRY gfw_null_glUniform1f(GLint location, GLfloat v0)
+{
+	gfw_null_gl_record("glUniform1f", 2, (uint64_t []){(uint64_t)location, gfw_null_gl_float(v0)});
+}
+
+static void APIENTRY gfw_null_glUniform1fv(GLint location, GLsizei count, const GLfloat *value)
+{
+	gfw_null_gl_record("glUniform1fv", 3, (uint64_t []){(uint64_t)location, (uint64_t)count, (uint64_t)(uintptr_t)value});
+}
+
+static void APIENTRY gfw_null_glUniform1i(GLint location, GLint v0)
+{
+	gfw_null_gl_record("glUniform1i", 2, (uint64_t []){(uint64_t)location, (uint64_t)v0});
+}
+
+static void APIENTRY gfw_null_glUniform1iv(GLint location, GLsizei count, const GLint *value)
+{
+	gfw_null_gl_record("glUniform1iv", 3, (uint64_t []){(uint64_t)location, (uint64_t)count, (uint64_t)(uintptr_t)value});
+}
+
+static void APIENTRY gfw_null_glUniform1ui(GLint location, GLuint v0)
+{
+	gfw_null_gl_record("glUniform1ui", 2, (uint64_t []){(uint64_t)location, (uint64_t)v0});
+}
+
+static void APIENTRY gfw_null_glUniform1uiv(GLint location, GLsizei count, const GLuint *value)
+{
+	gfw_null_gl_record("glUniform1uiv", 3, (uint64_t []){(uint64_t)location, (uint64_t)count, (uint64_t)(uintptr_t)value});
+}
+
+static void APIENTRY gfw_null_glUniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
+{
+	gfw_null_gl_record("glUniformMatrix3fv", 4, (uint64_t []){(uint64_t)location, (uint64_t)count, (uint64_t)transpose, (uint64_t)(uintptr_t)value});
+}
+
+static void APIENTRY gfw_null_glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
+{
+	gfw_null_gl_record("glUniformMatrix4fv", 4, (uint64_t []){(uint64_t)location, (uint64_t)count, (uint64_t)transpose, (uint64_t)(uintptr_t)value});
+}
+
+static GLboolean APIENTRY gfw_null_glUnmapBuffer(GLenum target)
+{
+	gfw_null_gl_record("glUnmapBuffer", 1, (uint64_t []){(uint64_t)target});
+	return GL_TRUE;
+}
+
+static void APIENTRY gfw_null_glUseProgram(GLuint program)
+{
+	gfw_null_gl_record("glUseProgram", 1, (uint64_t []){(uint64_t)program});
+}
+
+static void APIENTRY gfw_null_glUseProgramStages(GLuint pipeline, GLbitfield stages, GLuint program)
+{
+	gfw_null_gl_record("glUseProgramStages", 3, (uint64_t []){(uint64_t)pipeline, (uint64_t)stages, (uint64_t)program});
+}
+
+static void APIENTRY gfw_null_glVertexAttribBinding(GLuint attribindex, GLuint bindingindex)
+{
+	gfw_null_gl_record("glVertexAttribBinding", 2, (uint64_t []){(uint64_t)attribindex, (uint64_t)bindingindex});
+}
+
+static void APIENTRY gfw_null_glVertexAttribDivisor(GLuint index, GLuint divisor)
+{
+	gfw_null_gl_record("glVertexAttribDivisor", 2, (uint64_t []){(uint64_t)index, (uint64_t)divisor});
+}
+
+static void APIENTRY gfw_null_glVertexAttribFormat(GLuint attribindex, GLint size, GLenum type, GLboolean normalized, GLuint relativeoffset)
+{
+	gfw_null_gl_record("glVertexAttribFormat", 5, (uint64_t []){(uint64_t)attribindex, (uint64_t)size, (uint64_t)type, (uint64_t)normalized, (uint64_t)relativeoffset});
+}
+
+static void APIENTRY gfw_null_glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer)
+{
+	gfw_null_gl_record("glVertexAttribPointer", 6, (uint64_t []){(uint64_t)index, (uint64_t)size, (uint64_t)type, (uint64_t)normalized, (uint64_t)stride, (uint64_t)(uintptr_t)pointer});
+}
+
+static void APIENTRY gfw_null_glVertexBindingDivisor(GLuint bindingindex, GLuint divisor)
+{
+	gfw_null_gl_record("glVertexBindingDivisor", 2, (uint64_t []){(uint64_t)bindingindex, (uint64_t)divisor});
+}
+
+static void APIENTRY gfw_null_glViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	gfw_null_gl_record("glViewport", 4, (uint64_t []){(uint64_t)x, (uint64_t)y, (uint64_t)width, (uint64_t)height});
+}
+#endif
+
+struct gfw_null_gl_call *gfw_null_gl_get_calls(size_t *count)
+{
+	*count = gfw_null_gl_calls_count;
+	return gfw_null_gl_calls;
+}
+
+size_t gfw_null_gl_count_calls(const char *function)
+{
+	size_t count = 0;
+	size_t i = 0;
+	while (i < gfw_null_gl_calls_count) {
+		if (strcmp(gfw_null_gl_calls[i].function, function) == 0) {
+			count++;
+		}
+		i++;
+	}
+	return count;
+}
+
+void gfw_null_gl_clear_calls(void)
+{
+	gfw_null_gl_calls_count = 0;
+}
+
+void gfw_null_gl_set_mode(enum gfw_null_gl_mode mode)
+{
+	gfw_null_gl_mode = mode;
+}
+
+void gfw_free_null_gl(void)
+{
+	free(gfw_null_gl_calls);
+	gfw_null_gl_calls = NULL;
+	gfw_null_gl_calls_count = 0;
+	gfw_null_gl_calls_capacity = 0;
+#ifdef GFW_NULL_GL_DISPATCH
+	free(gfw_null_gl_buffer_sizes);
+	gfw_null_gl_buffer_sizes = NULL;
+	gfw_null_gl_buffer_sizes_capacity = 0;
+	free(gfw_null_gl_mapped);
+	gfw_null_gl_mapped = NULL;
+	gfw_null_gl_mapped_size = 0;
+#endif
+}
+
+/* Without glad the GL functions are linked directly and cannot be replaced */
+bool gfw_load_null_gl(enum gfw_null_gl_mode mode)
+{
+	bool success = true;
+	gfw_null_gl_mode = mode;
+#ifdef GFW_NULL_GL_DISPATCH
+	glad_glActiveTexture = gfw_null_glActiveTexture;
+	glad_glAttachShader = gfw_null_glAttachShader;
+	glad_glBeginQuery = gfw_null_glBeginQuery;
+	glad_glBeginTransformFeedback = gfw_null_glBeginTransformFeedback;
+	glad_glBindBuffer = gfw_null_glBindBuffer;
+	glad_glBindBufferBase = gfw_null_glBindBufferBase;
+	glad_glBindFramebuffer = gfw_null_glBindFramebuffer;
+	glad_glBindImageTexture = gfw_null_glBindImageTexture;
+	glad_glBindProgramPipeline = gfw_null_glBindProgramPipeline;
+	glad_glBindTexture = gfw_null_glBindTexture;
+	glad_glBindTransformFeedback = gfw_null_glBindTransformFeedback;
+	glad_glBindVertexArray = gfw_null_glBindVertexArray;
+	glad_glBindVertexBuffer = gfw_null_glBindVertexBuffer;
+	glad_glBlendColor = gfw_null_glBlendColor;
+	glad_glBlendEquationSeparate = gfw_null_glBlendEquationSeparate;
+	glad_glBlendFuncSeparate = gfw_null_glBlendFuncSeparate;
+	glad_glBufferData = gfw_null_glBufferData;
+	glad_glBufferSubData = gfw_null_glBufferSubData;
+	glad_glCheckFramebufferStatus = gfw_null_glCheckFramebufferStatus;
+	glad_glClear = gfw_null_glClear;
+	glad_glClearColor = gfw_null_glClearColor;
+	glad_glClearDepth = gfw_null_glClearDepth;
+	glad_glClientWaitSync = gfw_null_glClientWaitSync;
+	glad_glCompileShader = gfw_null_glCompileShader;
+	glad_glCreateProgram = gfw_null_glCreateProgram;
+	glad_glCreateShader = gfw_null_glCreateShader;
+	glad_glCreateShaderProgramv = gfw_null_glCreateShaderProgramv;
+	glad_glCullFace = gfw_null_glCullFace;
+	glad_glDebugMessageCallback = gfw_null_glDebugMessageCallback;
+	glad_glDebugMessageControl = gfw_null_glDebugMessageControl;
+	glad_glDeleteBuffers = gfw_null_glDeleteBuffers;
+	glad_glDeleteFramebuffers = gfw_null_glDeleteFramebuffers;
+	glad_glDeleteProgram = gfw_null_glDeleteProgram;
+	glad_glDeleteProgramPipelines = gfw_null_glDeleteProgramPipelines;
+	glad_glDeleteQueries = gfw_null_glDeleteQueries;
+	glad_glDeleteShader = gfw_null_glDeleteShader;
+	glad_glDeleteSync = gfw_null_glDeleteSync;
+	glad_glDeleteTextures = gfw_null_glDeleteTextures;
+	glad_glDeleteTransformFeedbacks = gfw_null_glDeleteTransformFeedbacks;
+	glad_glDeleteVertexArrays = gfw_null_glDeleteVertexArrays;
+	glad_glDepthFunc = gfw_null_glDepthFunc;
+	glad_glDepthRange = gfw_null_glDepthRange;
+	glad_glDetachShader = gfw_null_glDetachShader;
+	glad_glDisable = gfw_null_glDisable;
+	glad_glDisableVertexAttribArray = gfw_null_glDisableVertexAttribArray;
+	glad_glDispatchCompute = gfw_null_glDispatchCompute;
+	glad_glDispatchComputeIndirect = gfw_null_glDispatchComputeIndirect;
+	glad_glDrawArrays = gfw_null_glDrawArrays;
+	glad_glDrawArraysInstanced = gfw_null_glDrawArraysInstanced;
+	glad_glDrawArraysInstancedBaseInstance = gfw_null_glDrawArraysInstancedBaseInstance;
+	glad_glDrawElements = gfw_null_glDrawElements;
+	glad_glDrawElementsInstanced = gfw_null_glDrawElementsInstanced;
+	glad_glDrawElementsInstancedBaseInstance = gfw_null_glDrawElementsInstancedBaseInstance;
+	glad_glDrawTransformFeedback = gfw_null_glDrawTransformFeedback;
+	glad_glEnable = gfw_null_glEnable;
+	glad_glEnableVertexAttribArray = gfw_null_glEnableVertexAttribArray;
+	glad_glEndQuery = gfw_null_glEndQuery;
+	glad_glEndTransformFeedback = gfw_null_glEndTransformFeedback;
+	glad_glFenceSync = gfw_null_glFenceSync;
+	glad_glFinish = gfw_null_glFinish;
+	glad_glFramebufferTexture = gfw_null_glFramebufferTexture;
+	glad_glFrontFace = gfw_null_glFrontFace;
+	glad_glGenBuffers = gfw_null_glGenBuffers;
+	glad_glGenFramebuffers = gfw_null_glGenFramebuffers;
+	glad_glGenProgramPipelines = gfw_null_glGenProgramPipelines;
+	glad_glGenQueries = gfw_null_glGenQueries;
+	glad_glGenTextures = gfw_null_glGenTextures;
+	glad_glGenTransformFeedbacks = gfw_null_glGenTransformFeedbacks;
+	glad_glGenVertexArrays = gfw_null_glGenVertexArrays;
+	glad_glGetActiveAttrib = gfw_null_glGetActiveAttrib;
+	glad_glGetActiveUniform = gfw_null_glGetActiveUniform;
+	glad_glGetActiveUniformBlockName = gfw_null_glGetActiveUniformBlockName;
+	glad_glGetActiveUniformBlockiv = gfw_null_glGetActiveUniformBlockiv;
+	glad_glGetAttribLocation = gfw_null_glGetAttribLocation;
+	glad_glGetError = gfw_null_glGetError;
+	glad_glGetFloatv = gfw_null_glGetFloatv;
+	glad_glGetIntegerv = gfw_null_glGetIntegerv;
+	glad_glGetProgramBinary = gfw_null_glGetProgramBinary;
+	glad_glGetProgramInfoLog = gfw_null_glGetProgramInfoLog;
+	glad_glGetProgramiv = gfw_null_glGetProgramiv;
+	glad_glGetQueryObjectiv = gfw_null_glGetQueryObjectiv;
+	glad_glGetQueryObjectui64v = gfw_null_glGetQueryObjectui64v;
+	glad_glGetQueryObjectuiv = gfw_null_glGetQueryObjectuiv;
+	glad_glGetShaderInfoLog = gfw_null_glGetShaderInfoLog;
+	glad_glGetShaderiv = gfw_null_glGetShaderiv;
+	glad_glGetString = gfw_null_glGetString;
+	glad_glGetStringi = gfw_null_glGetStringi;
+	glad_glGetUniformLocation = gfw_null_glGetUniformLocation;
+	glad_glGetUniformfv = gfw_null_glGetUniformfv;
+	glad_glGetUniformiv = gfw_null_glGetUniformiv;
+	glad_glGetUniformuiv = gfw_null_glGetUniformuiv;
+	glad_glIsBuffer = gfw_null_glIsBuffer;
+	glad_glIsEnabled = gfw_null_glIsEnabled;
+	glad_glIsFramebuffer = gfw_null_glIsFramebuffer;
+	glad_glIsTexture = gfw_null_glIsTexture;
+	glad_glIsVertexArray = gfw_null_glIsVertexArray;
+	glad_glLineWidth = gfw_null_glLineWidth;
+	glad_glLinkProgram = gfw_null_glLinkProgram;
+	glad_glLogicOp = gfw_null_glLogicOp;
+	glad_glMapBuffer = gfw_null_glMapBuffer;
+	glad_glMapBufferRange = gfw_null_glMapBufferRange;
+	glad_glMemoryBarrier = gfw_null_glMemoryBarrier;
+	glad_glMultiDrawArrays = gfw_null_glMultiDrawArrays;
+	glad_glMultiDrawArraysIndirect = gfw_null_glMultiDrawArraysIndirect;
+	glad_glMultiDrawElements = gfw_null_glMultiDrawElements;
+	glad_glObjectLabel = gfw_null_glObjectLabel;
+	glad_glPointSize = gfw_null_glPointSize;
+	glad_glPopDebugGroup = gfw_null_glPopDebugGroup;
+	glad_glProgramBinary = gfw_null_glProgramBinary;
+	glad_glProgramParameteri = gfw_null_glProgramParameteri;
+	glad_glProgramUniform1f = gfw_null_glProgramUniform1f;
+	glad_glProgramUniform1fv = gfw_null_glProgramUniform1fv;
+	glad_glProgramUniform1i = gfw_null_glProgramUniform1i;
+	glad_glProgramUniform1iv = gfw_null_glProgramUniform1iv;
+	glad_glProgramUniform1ui = gfw_null_glProgramUniform1ui;
+	glad_glProgramUniform1uiv = gfw_null_glProgramUniform1uiv;
+	glad_glProgramUniformMatrix3fv = gfw_null_glProgramUniformMatrix3fv;
+	glad_glProgramUniformMatrix4fv = gfw_null_glProgramUniformMatrix4fv;
+	glad_glPushDebugGroup = gfw_null_glPushDebugGroup;
+	glad_glQueryCounter = gfw_null_glQueryCounter;
+	glad_glShaderSource = gfw_null_glShaderSource;
+	glad_glTexImage2D = gfw_null_glTexImage2D;
+	glad_glTexParameteri = gfw_null_glTexParameteri;
+	glad_glTexSubImage2D = gfw_null_glTexSubImage2D;
+	glad_glTransformFeedbackVaryings = gfw_null_glTransformFeedbackVaryings;
+	glad_glUniform1f = gfw_null_glUniform1f;
+	glad_glUniform1fv = gfw_null_glUniform1fv;
+	glad_glUniform1i = gfw_null_glUniform1i;
+	glad_glUniform1iv = gfw_null_glUniform1iv;
+	glad_glUniform1ui = gfw_null_glUniform1ui;
+	glad_glUniform1uiv = gfw_null_glUniform1uiv;
+	glad_glUniformMatrix3fv = gfw_null_glUniformMatrix3fv;
+	glad_glUniformMatrix4fv = gfw_null_glUniformMatrix4fv;
+	glad_glUnmapBuffer = gfw_null_glUnmapBuffer;
+	glad_glUseProgram = gfw_null_glUseProgram;
+	glad_glUseProgramStages = gfw_null_glUseProgramStages;
+	glad_glVertexAttribBinding = gfw_null_glVertexAttribBinding;
+	glad_glVertexAttribDivisor = gfw_null_glVertexAttribDivisor;
+	glad_glVertexAttribFormat = gfw_null_glVertexAttribFormat;
+	glad_glVertexAttribPointer = gfw_null_glVertexAttribPointer;
+	glad_glVertexBindingDivisor = gfw_null_glVertexBindingDivisor;
+	glad_glViewport = gfw_null_glViewport;
+#else
+	success = false;
+	fprintf(stderr, "Error: the null GL backend needs a glad dispatch table.\n");
+#endif
+	return success;
+}
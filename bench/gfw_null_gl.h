@@ -0,0 +1,46 @@
+/*
+Copyright © 2018 Felipe Ferreira da Silva
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use of
+this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject to
+the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef GFW_NULL_GL_H
+#define GFW_NULL_GL_H
+
+#include "gfw.h"
+
+#define GFW_NULL_GL_ARGUMENTS_MAX 9
+
+enum gfw_null_gl_mode {
+	GFW_NULL_GL_MODE_DISCARD,
+	GFW_NULL_GL_MODE_RECORD
+};
+
+struct gfw_null_gl_call {
+	const char *function;
+	uint32_t arguments_count;
+	uint64_t arguments[GFW_NULL_GL_ARGUMENTS_MAX];
+};
+
+struct gfw_null_gl_call *gfw_null_gl_get_calls(size_t *count);
+size_t gfw_null_gl_count_calls(const char *function);
+void gfw_null_gl_clear_calls(void);
+void gfw_null_gl_set_mode(enum gfw_null_gl_mode mode);
+void gfw_free_null_gl(void);
+bool gfw_load_null_gl(enum gfw_null_gl_mode mode);
+
+#endif
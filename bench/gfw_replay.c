@@ -0,0 +1,581 @@
+/*
+Copyright © 2018 Felipe Ferreira da Silva
+
+This software is provided 'as-is', without any express or implied warranty. In
+no event will the authors be held liable for any damages arising from the use of
+this software.
+
+Permission is granted to anyone to use this software for any purpose, including
+commercial applications, and to alter it and redistribute it freely, subject to
+the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not claim
+     that you wrote the original software. If you use this software in a
+     product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "gfw.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "gfw_headless.h"
+
+#define GFW_REPLAY_ARGUMENTS_MAX 16
+
+enum gfw_replay_object_type {
+	GFW_REPLAY_OBJECT_TEXTURE = 1,
+	GFW_REPLAY_OBJECT_FRAMEBUFFER,
+	GFW_REPLAY_OBJECT_VERTEX_DATA,
+	GFW_REPLAY_OBJECT_VERTEX_STATE,
+	GFW_REPLAY_OBJECT_SHADER
+};
+
+struct gfw_replay_object {
+	uint64_t key;
+	void *object;
+};
+
+/* Objects are found by the GL name they had while the trace was captured */
+static struct gfw_replay_object *gfw_replay_objects = NULL;
+static uint32_t gfw_replay_objects_capacity = 0;
+static uint32_t gfw_replay_objects_count = 0;
+static uint64_t *gfw_replay_frames = NULL;
+static uint32_t gfw_replay_frames_capacity = 0;
+static uint32_t gfw_replay_frames_count = 0;
+static uint32_t gfw_replay_missing = 0;
+
+static uint64_t gfw_replay_get_time(void)
+{
+	struct timespec time = {0};
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (uint64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+static int gfw_replay_compare(const void *a, const void *b)
+{
+	uint64_t value_a = *(const uint64_t *)a;
+	uint64_t value_b = *(const uint64_t *)b;
+	return (value_a > value_b) - (value_a < value_b);
+}
+
+static uint64_t gfw_replay_key(enum gfw_replay_object_type type, uint64_t id)
+{
+	return ((uint64_t)type << 32) | (id & 0xffffffff);
+}
+
+static uint32_t gfw_replay_slot(struct gfw_replay_object *objects, uint32_t capacity, uint64_t key)
+{
+	uint32_t i = (uint32_t)((key * UINT64_C(0x9e3779b97f4a7c15)) >> 32) & (capacity - 1);
+	while (objects[i].key != 0 && objects[i].key != key) {
+		i = (i + 1) & (capacity - 1);
+	}
+	return i;
+}
+
+static void *gfw_replay_find(enum gfw_replay_object_type type, uint64_t id)
+{
+	void *object = NULL;
+	if (gfw_replay_objects_capacity > 0) {
+		object = gfw_replay_objects[gfw_replay_slot(gfw_replay_objects, gfw_replay_objects_capacity, gfw_replay_key(type, id))].object;
+	}
+	if (!object) {
+		gfw_replay_missing++;
+	}
+	return object;
+}
+
+static void gfw_replay_free(enum gfw_replay_object_type type, void *object)
+{
+	if (type == GFW_REPLAY_OBJECT_TEXTURE) {
+		gfw_free_texture(object);
+	} else if (type == GFW_REPLAY_OBJECT_FRAMEBUFFER) {
+		gfw_free_framebuffer(object);
+	} else if (type == GFW_REPLAY_OBJECT_VERTEX_DATA) {
+		gfw_free_vertex_data(object);
+	} else if (type == GFW_REPLAY_OBJECT_VERTEX_STATE) {
+		gfw_free_vertex_state(object);
+	} else if (type == GFW_REPLAY_OBJECT_SHADER) {
+		gfw_free_shader(object);
+	}
+	free(object);
+}
+
+static bool gfw_replay_insert(enum gfw_replay_object_type type, uint64_t id, void *object)
+{
+	bool success = true;
+	struct gfw_replay_object *objects = NULL;
+	uint32_t capacity = 0;
+	uint32_t i = 0;
+	uint32_t slot = 0;
+	if ((gfw_replay_objects_count + 1) * 2 > gfw_replay_objects_capacity) {
+		capacity = gfw_replay_objects_capacity > 0 ? gfw_replay_objects_capacity * 2 : 64;
+		objects = calloc(capacity, sizeof(*objects));
+		if (!objects) {
+			success = false;
+			goto done;
+		}
+		while (i < gfw_replay_objects_capacity) {
+			if (gfw_replay_objects[i].object) {
+				objects[gfw_replay_slot(objects, capacity, gfw_replay_objects[i].key)] = gfw_replay_objects[i];
+			}
+			i++;
+		}
+		free(gfw_replay_objects);
+		gfw_replay_objects = objects;
+		gfw_replay_objects_capacity = capacity;
+	}
+	slot = gfw_replay_slot(gfw_replay_objects, gfw_replay_objects_capacity, gfw_replay_key(type, id));
+	if (gfw_replay_objects[slot].object) {
+		/* GL names are reused after deletion, so a missed free is done here */
+		gfw_replay_free(type, gfw_replay_objects[slot].object);
+	} else {
+		gfw_replay_objects_count++;
+	}
+	gfw_replay_objects[slot].key = gfw_replay_key(type, id);
+	gfw_replay_objects[slot].object = object;
+done:
+	return success;
+}
+
+/* The slot keeps its key so later probes still pass over it */
+static void gfw_replay_remove(enum gfw_replay_object_type type, uint64_t id)
+{
+	uint32_t slot = 0;
+	if (gfw_replay_objects_capacity == 0) {
+		return;
+	}
+	slot = gfw_replay_slot(gfw_replay_objects, gfw_replay_objects_capacity, gfw_replay_key(type, id));
+	free(gfw_replay_objects[slot].object);
+	gfw_replay_objects[slot].object = NULL;
+}
+
+static bool gfw_replay_end_frame(uint64_t begin)
+{
+	bool success = true;
+	uint64_t *frames = NULL;
+	glFinish();
+	if (gfw_replay_frames_count == gfw_replay_frames_capacity) {
+		frames = realloc(gfw_replay_frames, sizeof(*frames) * (gfw_replay_frames_capacity > 0 ? gfw_replay_frames_capacity * 2 : 256));
+		if (!frames) {
+			success = false;
+			goto done;
+		}
+		gfw_replay_frames = frames;
+		gfw_replay_frames_capacity = gfw_replay_frames_capacity > 0 ? gfw_replay_frames_capacity * 2 : 256;
+	}
+	gfw_replay_frames[gfw_replay_frames_count] = gfw_replay_get_time() - begin;
+	gfw_replay_frames_count++;
+done:
+	return success;
+}
+
+static void gfw_replay_state(union gfw_trace_argument *arguments, uint8_t *payload)
+{
+	struct gfw_pipeline_state_descriptor descriptor;
+	struct gfw_pipeline_state *pipeline_state = NULL;
+	memcpy(&descriptor, payload, sizeof(descriptor));
+	if (arguments[0].u) {
+		gfw_set_viewport(arguments[1].i, arguments[2].i, arguments[3].i, arguments[4].i);
+	}
+	gfw_set_depth_range(arguments[5].f, arguments[6].f);
+	pipeline_state = gfw_get_pipeline_state(descriptor);
+	if (pipeline_state) {
+		gfw_pipeline_state_apply(pipeline_state);
+	}
+}
+
+static void gfw_replay_shader(union gfw_trace_argument *arguments, uint8_t *payload)
+{
+	struct gfw_shader *shader = calloc(1, sizeof(*shader));
+	char *sources[3] = {NULL, NULL, NULL};
+	char *varyings[GFW_REPLAY_ARGUMENTS_MAX];
+	uint64_t offset = 0;
+	uint32_t i = 0;
+	if (!shader || arguments[4].u > GFW_REPLAY_ARGUMENTS_MAX) {
+		free(shader);
+		return;
+	}
+	while (i < 3) {
+		if (arguments[1 + i].u > 0) {
+			sources[i] = (char *)payload + offset;
+			offset = offset + arguments[1 + i].u;
+		}
+		i++;
+	}
+	i = 0;
+	while (i < arguments[4].u) {
+		varyings[i] = (char *)payload + offset;
+		offset = offset + strlen(varyings[i]) + 1;
+		i++;
+	}
+	if (gfw_init_shader_with_feedback(shader, sources[0], sources[1], sources[2], varyings, arguments[4].u, arguments[5].u)) {
+		gfw_replay_insert(GFW_REPLAY_OBJECT_SHADER, arguments[0].u, shader);
+	} else {
+		free(shader);
+	}
+}
+
+static void gfw_replay_uniform(union gfw_trace_argument *arguments, uint8_t *payload)
+{
+	if (arguments[0].u == GL_FLOAT_MAT4) {
+		gfw_shader_set_uniform_mat4(arguments[1].i, arguments[3].u, (gfw_float_t *)payload);
+	} else if (arguments[0].u == GL_FLOAT_MAT3) {
+		gfw_shader_set_uniform_mat3(arguments[1].i, arguments[3].u, (gfw_float_t *)payload);
+	} else if (arguments[0].u == GL_FLOAT) {
+		gfw_shader_set_uniform_floatv(arguments[1].i, (gfw_float_t *)payload, arguments[2].u);
+	} else if (arguments[0].u == GL_INT) {
+		gfw_shader_set_uniform_intv(arguments[1].i, (gfw_int_t *)payload, arguments[2].u);
+	} else if (arguments[0].u == GL_UNSIGNED_INT) {
+		gfw_shader_set_uniform_uintv(arguments[1].i, (gfw_uint_t *)payload, arguments[2].u);
+	}
+}
+
+static void gfw_replay_multi_draw(union gfw_trace_argument *arguments, uint8_t *payload, bool elements)
+{
+	struct gfw_vertex_state *vertex_state = NULL;
+	struct gfw_draw_list draw_list = {0};
+	struct gfw_draw_command *commands = (struct gfw_draw_command *)payload;
+	uint64_t count = elements ? arguments[3].u : arguments[2].u;
+	uint64_t i = 0;
+	if (!(vertex_state = gfw_replay_find(GFW_REPLAY_OBJECT_VERTEX_STATE, arguments[0].u)) || !gfw_init_draw_list(&draw_list, count)) {
+		return;
+	}
+	while (i < count) {
+		gfw_draw_list_push_instanced(&draw_list, commands[i].first, commands[i].count, commands[i].instance_count, commands[i].base_instance);
+		i++;
+	}
+	if (elements) {
+		gfw_vertex_state_multi_draw_elements(vertex_state, arguments[1].u, arguments[2].u, &draw_list);
+	} else {
+		gfw_vertex_state_multi_draw(vertex_state, arguments[1].u, &draw_list);
+	}
+	gfw_free_draw_list(&draw_list);
+}
+
+static void gfw_replay_call(struct gfw_trace_record *record, union gfw_trace_argument *arguments, uint8_t *payload)
+{
+	struct gfw_texture_descriptor descriptor = {0};
+	struct gfw_texture *texture = NULL;
+	struct gfw_framebuffer *framebuffer = NULL;
+	struct gfw_vertex_data *vertex_data = NULL;
+	struct gfw_vertex_state *vertex_state = NULL;
+	struct gfw_shader *shader = NULL;
+	switch (record->call) {
+	case GFW_TRACE_CALL_STATE:
+		gfw_replay_state(arguments, payload);
+		break;
+	case GFW_TRACE_CALL_INIT_TEXTURE:
+		texture = calloc(1, sizeof(*texture));
+		descriptor.pixel_format = arguments[1].u;
+		descriptor.horizontal_wrap = arguments[2].u;
+		descriptor.vertical_wrap = arguments[3].u;
+		descriptor.mag_filter = arguments[4].u;
+		descriptor.min_filter = arguments[5].u;
+		descriptor.width = arguments[6].u;
+		descriptor.height = arguments[7].u;
+		descriptor.data = record->payload_size > 0 ? payload : NULL;
+		if (texture && gfw_init_texture(texture, descriptor)) {
+			gfw_replay_insert(GFW_REPLAY_OBJECT_TEXTURE, arguments[0].u, texture);
+		} else {
+			free(texture);
+		}
+		break;
+	case GFW_TRACE_CALL_TEXTURE_PUT_SUBIMAGE:
+		if ((texture = gfw_replay_find(GFW_REPLAY_OBJECT_TEXTURE, arguments[0].u))) {
+			gfw_texture_put_subimage(texture, arguments[1].i, arguments[2].i, payload, arguments[3].u, arguments[4].u);
+		}
+		break;
+	case GFW_TRACE_CALL_TEXTURE_ACTIVATE:
+		gfw_texture_activate(arguments[0].u);
+		break;
+	case GFW_TRACE_CALL_TEXTURE_BIND:
+		if ((texture = gfw_replay_find(GFW_REPLAY_OBJECT_TEXTURE, arguments[0].u))) {
+			gfw_texture_bind(texture);
+		}
+		break;
+	case GFW_TRACE_CALL_TEXTURE_UNBIND:
+		gfw_texture_unbind();
+		break;
+	case GFW_TRACE_CALL_FREE_TEXTURE:
+		if ((texture = gfw_replay_find(GFW_REPLAY_OBJECT_TEXTURE, arguments[0].u))) {
+			gfw_free_texture(texture);
+			gfw_replay_remove(GFW_REPLAY_OBJECT_TEXTURE, arguments[0].u);
+		}
+		break;
+	case GFW_TRACE_CALL_INIT_FRAMEBUFFER:
+		framebuffer = calloc(1, sizeof(*framebuffer));
+		texture = gfw_replay_find(GFW_REPLAY_OBJECT_TEXTURE, arguments[1].u);
+		if (framebuffer && texture && gfw_init_framebuffer(framebuffer, texture)) {
+			gfw_replay_insert(GFW_REPLAY_OBJECT_FRAMEBUFFER, arguments[0].u, framebuffer);
+		} else {
+			free(framebuffer);
+		}
+		break;
+	case GFW_TRACE_CALL_FRAMEBUFFER_BIND:
+		if ((framebuffer = gfw_replay_find(GFW_REPLAY_OBJECT_FRAMEBUFFER, arguments[0].u))) {
+			gfw_framebuffer_bind(framebuffer);
+		}
+		break;
+	case GFW_TRACE_CALL_FRAMEBUFFER_UNBIND:
+		gfw_framebuffer_unbind();
+		break;
+	case GFW_TRACE_CALL_FRAMEBUFFER_CLEAR_COLOR:
+		gfw_framebuffer_clear_color(arguments[0].f, arguments[1].f, arguments[2].f, arguments[3].f);
+		break;
+	case GFW_TRACE_CALL_FRAMEBUFFER_CLEAR_DEPTH:
+		gfw_framebuffer_clear_depth(arguments[0].f);
+		break;
+	case GFW_TRACE_CALL_FRAMEBUFFER_CLEAR:
+		gfw_framebuffer_clear(arguments[0].u, arguments[1].u);
+		break;
+	case GFW_TRACE_CALL_FREE_FRAMEBUFFER:
+		if ((framebuffer = gfw_replay_find(GFW_REPLAY_OBJECT_FRAMEBUFFER, arguments[0].u))) {
+			gfw_free_framebuffer(framebuffer);
+			gfw_replay_remove(GFW_REPLAY_OBJECT_FRAMEBUFFER, arguments[0].u);
+		}
+		break;
+	case GFW_TRACE_CALL_INIT_VERTEX_DATA:
+		vertex_data = calloc(1, sizeof(*vertex_data));
+		if (vertex_data && gfw_init_vertex_data(vertex_data, arguments[1].u, arguments[2].u)) {
+			gfw_replay_insert(GFW_REPLAY_OBJECT_VERTEX_DATA, arguments[0].u, vertex_data);
+		} else {
+			free(vertex_data);
+		}
+		break;
+	case GFW_TRACE_CALL_VERTEX_DATA_BIND:
+		if ((vertex_data = gfw_replay_find(GFW_REPLAY_OBJECT_VERTEX_DATA, arguments[0].u))) {
+			gfw_vertex_data_bind(vertex_data);
+		}
+		break;
+	case GFW_TRACE_CALL_VERTEX_DATA_UNBIND:
+		gfw_vertex_data_unbind();
+		break;
+	case GFW_TRACE_CALL_VERTEX_DATA_UPLOAD:
+		/* The data was mapped while bound, so it is still bound here */
+		if ((vertex_data = gfw_replay_find(GFW_REPLAY_OBJECT_VERTEX_DATA, arguments[0].u))) {
+			glBufferSubData(GL_ARRAY_BUFFER, arguments[1].u, record->payload_size, payload);
+		}
+		break;
+	case GFW_TRACE_CALL_FREE_VERTEX_DATA:
+		if ((vertex_data = gfw_replay_find(GFW_REPLAY_OBJECT_VERTEX_DATA, arguments[0].u))) {
+			gfw_free_vertex_data(vertex_data);
+			gfw_replay_remove(GFW_REPLAY_OBJECT_VERTEX_DATA, arguments[0].u);
+		}
+		break;
+	case GFW_TRACE_CALL_INIT_VERTEX_STATE:
+		vertex_state = calloc(1, sizeof(*vertex_state));
+		if (vertex_state && gfw_init_vertex_state(vertex_state)) {
+			gfw_replay_insert(GFW_REPLAY_OBJECT_VERTEX_STATE, arguments[0].u, vertex_state);
+		} else {
+			free(vertex_state);
+		}
+		break;
+	case GFW_TRACE_CALL_VERTEX_STATE_SET_LAYOUT:
+		vertex_state = gfw_replay_find(GFW_REPLAY_OBJECT_VERTEX_STATE, arguments[0].u);
+		vertex_data = gfw_replay_find(GFW_REPLAY_OBJECT_VERTEX_DATA, arguments[2].u);
+		if (vertex_state && vertex_data) {
+			gfw_vertex_state_set_layout(vertex_state, arguments[1].u, vertex_data, (struct gfw_attribute *)payload, arguments[3].u);
+		}
+		break;
+	case GFW_TRACE_CALL_VERTEX_STATE_SET_INDEX_DATA:
+		vertex_state = gfw_replay_find(GFW_REPLAY_OBJECT_VERTEX_STATE, arguments[0].u);
+		vertex_data = gfw_replay_find(GFW_REPLAY_OBJECT_VERTEX_DATA, arguments[1].u);
+		if (vertex_state && vertex_data) {
+			gfw_vertex_state_set_index_data(vertex_state, vertex_data);
+		}
+		break;
+	case GFW_TRACE_CALL_VERTEX_STATE_BIND:
+		if ((vertex_state = gfw_replay_find(GFW_REPLAY_OBJECT_VERTEX_STATE, arguments[0].u))) {
+			gfw_vertex_state_bind(vertex_state);
+		}
+		break;
+	case GFW_TRACE_CALL_VERTEX_STATE_UNBIND:
+		gfw_vertex_state_unbind();
+		break;
+	case GFW_TRACE_CALL_VERTEX_STATE_DRAW_RANGE:
+		if ((vertex_state = gfw_replay_find(GFW_REPLAY_OBJECT_VERTEX_STATE, arguments[0].u))) {
+			gfw_vertex_state_draw_range(vertex_state, arguments[1].u, arguments[2].u, arguments[3].u);
+		}
+		break;
+	case GFW_TRACE_CALL_VERTEX_STATE_DRAW_ELEMENTS:
+		if ((vertex_state = gfw_replay_find(GFW_REPLAY_OBJECT_VERTEX_STATE, arguments[0].u))) {
+			gfw_vertex_state_draw_elements(vertex_state, arguments[1].u, arguments[2].u, arguments[3].u, arguments[4].u);
+		}
+		break;
+	case GFW_TRACE_CALL_VERTEX_STATE_DRAW_INSTANCED:
+		if ((vertex_state = gfw_replay_find(GFW_REPLAY_OBJECT_VERTEX_STATE, arguments[0].u))) {
+			gfw_vertex_state_draw_instanced(vertex_state, arguments[1].u, arguments[2].u, arguments[3].u, arguments[4].u, arguments[5].u);
+		}
+		break;
+	case GFW_TRACE_CALL_VERTEX_STATE_DRAW_ELEMENTS_INSTANCED:
+		if ((vertex_state = gfw_replay_find(GFW_REPLAY_OBJECT_VERTEX_STATE, arguments[0].u))) {
+			gfw_vertex_state_draw_elements_instanced(vertex_state, arguments[1].u, arguments[2].u, arguments[3].u, arguments[4].u, arguments[5].u, arguments[6].u);
+		}
+		break;
+	case GFW_TRACE_CALL_VERTEX_STATE_MULTI_DRAW:
+		gfw_replay_multi_draw(arguments, payload, false);
+		break;
+	case GFW_TRACE_CALL_VERTEX_STATE_MULTI_DRAW_ELEMENTS:
+		gfw_replay_multi_draw(arguments, payload, true);
+		break;
+	case GFW_TRACE_CALL_VERTEX_STATE_MULTI_DRAW_INDIRECT:
+		vertex_state = gfw_replay_find(GFW_REPLAY_OBJECT_VERTEX_STATE, arguments[0].u);
+		vertex_data = gfw_replay_find(GFW_REPLAY_OBJECT_VERTEX_DATA, arguments[2].u);
+		if (vertex_state && vertex_data) {
+			gfw_vertex_state_multi_draw_indirect(vertex_state, arguments[1].u, vertex_data, arguments[3].u, arguments[4].u);
+		}
+		break;
+	case GFW_TRACE_CALL_DRAW_LIST_UPLOAD:
+		if ((vertex_data = gfw_replay_find(GFW_REPLAY_OBJECT_VERTEX_DATA, arguments[0].u))) {
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, vertex_data->vbo_gl_id);
+			glBufferSubData(GL_DRAW_INDIRECT_BUFFER, arguments[1].u, record->payload_size, payload);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		}
+		break;
+	case GFW_TRACE_CALL_FREE_VERTEX_STATE:
+		if ((vertex_state = gfw_replay_find(GFW_REPLAY_OBJECT_VERTEX_STATE, arguments[0].u))) {
+			gfw_free_vertex_state(vertex_state);
+			gfw_replay_remove(GFW_REPLAY_OBJECT_VERTEX_STATE, arguments[0].u);
+		}
+		break;
+	case GFW_TRACE_CALL_INIT_SHADER:
+		gfw_replay_shader(arguments, payload);
+		break;
+	case GFW_TRACE_CALL_SHADER_USE:
+		if ((shader = gfw_replay_find(GFW_REPLAY_OBJECT_SHADER, arguments[0].u))) {
+			gfw_shader_use(shader);
+		}
+		break;
+	case GFW_TRACE_CALL_SHADER_SET_UNIFORM:
+		gfw_replay_uniform(arguments, payload);
+		break;
+	case GFW_TRACE_CALL_SHADER_DRAW_RANGE:
+		gfw_shader_draw_range((struct gfw_attribute *)payload, arguments[3].u, arguments[0].u, arguments[1].u, arguments[2].u);
+		break;
+	case GFW_TRACE_CALL_FREE_SHADER:
+		if ((shader = gfw_replay_find(GFW_REPLAY_OBJECT_SHADER, arguments[0].u))) {
+			gfw_free_shader(shader);
+			gfw_replay_remove(GFW_REPLAY_OBJECT_SHADER, arguments[0].u);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+static bool gfw_replay_run(FILE *file)
+{
+	bool success = true;
+	struct gfw_trace_header header = {0};
+	struct gfw_trace_record record = {0};
+	union gfw_trace_argument arguments[GFW_REPLAY_ARGUMENTS_MAX];
+	uint8_t *payload = NULL;
+	uint64_t payload_capacity = 0;
+	uint8_t *new_payload = NULL;
+	uint64_t begin = 0;
+	if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != GFW_TRACE_MAGIC || header.version != GFW_TRACE_VERSION) {
+		success = false;
+		fprintf(stderr, "Error: not a trace of this version.\n");
+		goto done;
+	}
+	begin = gfw_replay_get_time();
+	while (fread(&record, sizeof(record), 1, file) == 1) {
+		if (record.arguments_count > GFW_REPLAY_ARGUMENTS_MAX
+			|| fread(arguments, sizeof(*arguments), record.arguments_count, file) != record.arguments_count) {
+			success = false;
+			fprintf(stderr, "Error: truncated trace record.\n");
+			goto done;
+		}
+		/* Payloads are 8-byte aligned in memory since they are read into a fresh allocation */
+		if (record.payload_size > payload_capacity) {
+			new_payload = realloc(payload, record.payload_size);
+			if (!new_payload) {
+				success = false;
+				fprintf(stderr, "Error: failed to allocate trace payload.\n");
+				goto done;
+			}
+			payload = new_payload;
+			payload_capacity = record.payload_size;
+		}
+		if (record.payload_size > 0 && fread(payload, 1, record.payload_size, file) != record.payload_size) {
+			success = false;
+			fprintf(stderr, "Error: truncated trace payload.\n");
+			goto done;
+		}
+		if (record.call == GFW_TRACE_CALL_FRAME) {
+			if (!gfw_replay_end_frame(begin)) {
+				success = false;
+				goto done;
+			}
+			begin = gfw_replay_get_time();
+		} else {
+			gfw_replay_call(&record, arguments, payload);
+		}
+	}
+done:
+	free(payload);
+	return success;
+}
+
+static void gfw_replay_report(void)
+{
+	uint64_t *sorted = NULL;
+	uint64_t total = 0;
+	uint32_t i = 0;
+	printf("{\n\t\"renderer\": \"%s\",\n\t\"frames\": %u,\n\t\"missing_objects\": %u,\n",
+		(char *)glGetString(GL_RENDERER),
+		gfw_replay_frames_count,
+		gfw_replay_missing);
+	printf("\t\"frame_ns\": [");
+	while (i < gfw_replay_frames_count) {
+		printf("%s%llu", i > 0 ? ", " : "", (unsigned long long)gfw_replay_frames[i]);
+		total = total + gfw_replay_frames[i];
+		i++;
+	}
+	printf("]");
+	sorted = malloc(sizeof(*sorted) * (gfw_replay_frames_count > 0 ? gfw_replay_frames_count : 1));
+	if (sorted && gfw_replay_frames_count > 0) {
+		memcpy(sorted, gfw_replay_frames, sizeof(*sorted) * gfw_replay_frames_count);
+		qsort(sorted, gfw_replay_frames_count, sizeof(*sorted), gfw_replay_compare);
+		printf(",\n\t\"min_ns\": %llu,\n\t\"median_ns\": %llu,\n\t\"mean_ns\": %llu,\n\t\"p99_ns\": %llu,\n\t\"max_ns\": %llu",
+			(unsigned long long)sorted[0],
+			(unsigned long long)sorted[gfw_replay_frames_count / 2],
+			(unsigned long long)(total / gfw_replay_frames_count),
+			(unsigned long long)sorted[(gfw_replay_frames_count - 1) * 99 / 100],
+			(unsigned long long)sorted[gfw_replay_frames_count - 1]);
+	}
+	printf("\n}\n");
+	free(sorted);
+}
+
+int main(int argc, char **argv)
+{
+	int status = EXIT_SUCCESS;
+	FILE *file = NULL;
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s TRACE\n", argv[0]);
+		status = EXIT_FAILURE;
+		goto done;
+	}
+	file = fopen(argv[1], "rb");
+	if (!file) {
+		fprintf(stderr, "Error: failed to open %s.\n", argv[1]);
+		status = EXIT_FAILURE;
+		goto done;
+	}
+	if (!gfw_init_headless_context() || !gfw_replay_run(file)) {
+		status = EXIT_FAILURE;
+		goto done;
+	}
+	gfw_replay_report();
+done:
+	if (file) {
+		fclose(file);
+	}
+	return status;
+}
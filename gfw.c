@@ -18,21 +18,156 @@ the following restrictions:
   3. This notice may not be removed or altered from any source distribution.
 */
 
+#if defined(__unix__) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
 #include "gfw.h"
-#ifdef GFW_ABORT_ON_BACKEND_ERROR
 #include <stdlib.h>
-#endif
-#ifdef GFW_PRINT_BACKEND_ERROR
 #include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#if ((defined(GFW_ASYNC_BACKEND_ERROR) || defined(GFW_TRACE)) && defined(__unix__)) || defined(__linux__)
+#include <pthread.h>
+#endif
+#ifdef __unix__
+#include <time.h>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+#ifndef GFW_TRACE_BUFFER_SIZE
+#define GFW_TRACE_BUFFER_SIZE (1024 * 1024)
+#endif
+
+#ifndef GFW_FRAME_WAIT_TIMEOUT
+#define GFW_FRAME_WAIT_TIMEOUT 1000000000ull
+#endif
+
+#ifndef GFW_DELETIONS_PER_FRAME
+#define GFW_DELETIONS_PER_FRAME 64
 #endif
 
 #ifndef GFW_SHADER_LOG_MAX_LENGTH
 #define GFW_SHADER_LOG_MAX_LENGTH 1024
 #endif
 
+#ifndef GFW_SHADER_NAME_MAX_LENGTH
+#define GFW_SHADER_NAME_MAX_LENGTH 256
+#endif
+
+#ifndef GFW_SHADER_INCLUDE_MAX_DEPTH
+#define GFW_SHADER_INCLUDE_MAX_DEPTH 16
+#endif
+
+#ifndef GFW_SHADER_PATH_MAX_LENGTH
+#define GFW_SHADER_PATH_MAX_LENGTH 512
+#endif
+
+#ifndef GFW_PROGRAM_CACHE_PATH_MAX_LENGTH
+#define GFW_PROGRAM_CACHE_PATH_MAX_LENGTH 512
+#endif
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+#define GFW_HASH_BASIS 2166136261u
+#define GFW_HASH_PRIME 16777619u
+#define GFW_HASH64_BASIS 14695981039346656037ull
+#define GFW_HASH64_PRIME 1099511628211ull
+#define GFW_PROGRAM_CACHE_MAGIC 0x50574647u
+#define GFW_PROGRAM_CACHE_VERSION 2u
+#define GFW_PROGRAM_CACHE_DRIVER_MAX_LENGTH 128
+
+/* Hash */
+static uint32_t gfw_hash(uint32_t hash, const void *data, size_t size)
+{
+	const uint8_t *bytes = data;
+	size_t i = 0;
+	while (i < size) {
+		hash = (hash ^ bytes[i]) * GFW_HASH_PRIME;
+		i++;
+	}
+	return hash;
+}
+
+static void gfw_prepare_draw(void);
+
+/* Statistics */
+#ifdef GFW_STATISTICS
+static uint64_t gfw_statistics_counters[GFW_STATISTICS_COUNT] = {0};
+#define GFW_COUNT_STATISTIC(statistic, value) \
+	(gfw_statistics_counters[(statistic)] = gfw_statistics_counters[(statistic)] + (value))
+#else
+#define GFW_COUNT_STATISTIC(statistic, value)
+#endif
+
+/* Trace */
+#ifdef GFW_TRACE
+static FILE *gfw_trace_file = NULL;
+static struct gfw_vertex_data *gfw_trace_mapped_vertex_data = NULL;
+static size_t gfw_trace_mapped_offset = 0;
+static void gfw_trace_call(enum gfw_trace_call call, union gfw_trace_argument *arguments, uint32_t arguments_count, const void *payload, uint64_t payload_size);
+static void gfw_trace_vertex_data_upload(void);
+static void gfw_trace_shader(struct gfw_shader *shader,
+	char *vertex_source,
+	char *geometry_source,
+	char *fragment_source,
+	char **varyings,
+	size_t varyings_count,
+	bool interleaved);
+static void gfw_trace_state(void);
+#define GFW_TRACE_UINT(value) {.u = (uint64_t)(value)}
+#define GFW_TRACE_INT(value) {.i = (int64_t)(value)}
+#define GFW_TRACE_FLOAT(value) {.f = (double)(value)}
+#define GFW_TRACE_CALL(call, payload, payload_size, ...) \
+	do { \
+		if (gfw_trace_file) { \
+			union gfw_trace_argument trace_arguments[] = {__VA_ARGS__}; \
+			gfw_trace_call((call), trace_arguments, sizeof(trace_arguments) / sizeof(trace_arguments[0]), (payload), (payload_size)); \
+		} \
+	} while (0)
+#else
+#define GFW_TRACE_CALL(call, payload, payload_size, ...)
+#endif
+
+/* Deletion */
+#ifdef GFW_DEFERRED_DELETION
+enum gfw_deletion_type {
+	GFW_DELETION_BUFFER,
+	GFW_DELETION_VERTEX_ARRAY,
+	GFW_DELETION_FRAMEBUFFER,
+	GFW_DELETION_TEXTURE,
+	GFW_DELETION_PROGRAM
+};
+
+#define GFW_DELETION_TYPES (GFW_DELETION_PROGRAM + 1)
+#define GFW_DELETION_BATCH_SIZE 64
+
+static void gfw_defer_deletion(enum gfw_deletion_type type, GLuint gl_id);
+#endif
+
+/* Handle */
+static void gfw_update_handle(enum gfw_handle_type type, const void *object, gfw_uint_t gl_id, uint64_t size);
+
+static uint64_t gfw_hash64(uint64_t hash, const void *data, size_t size)
+{
+	const uint8_t *bytes = data;
+	size_t i = 0;
+	while (i < size) {
+		hash = (hash ^ bytes[i]) * GFW_HASH64_PRIME;
+		i++;
+	}
+	return hash;
+}
+
 /* Texture */
 void gfw_texture_unbind(void)
 {
+	GFW_TRACE_CALL(GFW_TRACE_CALL_TEXTURE_UNBIND, NULL, 0, GFW_TRACE_UINT(0));
 	glBindTexture(GL_TEXTURE_2D, 0);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
@@ -48,6 +183,8 @@ void gfw_texture_unbind(void)
 
 void gfw_texture_bind(struct gfw_texture *texture)
 {
+	GFW_TRACE_CALL(GFW_TRACE_CALL_TEXTURE_BIND, NULL, 0, GFW_TRACE_UINT(texture->texture_gl_id));
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_BINDS, 1);
 	glBindTexture(GL_TEXTURE_2D, texture->texture_gl_id);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
@@ -64,6 +201,7 @@ void gfw_texture_bind(struct gfw_texture *texture)
 void gfw_texture_activate(uint32_t index)
 {
 	GLenum texture = GL_TEXTURE0;
+	GFW_TRACE_CALL(GFW_TRACE_CALL_TEXTURE_ACTIVATE, NULL, 0, GFW_TRACE_UINT(index));
 	if (index > GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS || index > 31) {
 #ifdef GFW_PRINT_BACKEND_ERROR
 		printf("Error: failed to activate texture of index out of range.\n");
@@ -86,8 +224,66 @@ void gfw_texture_activate(uint32_t index)
 #endif
 }
 
+static uint32_t gfw_get_texture_pixel_size(enum gfw_texture_pixel_format pixel_format)
+{
+	uint32_t size = 4;
+	if (pixel_format == GFW_TEXTURE_PIXEL_FORMAT_RGB) {
+		size = 3;
+	} else if (pixel_format == GFW_TEXTURE_PIXEL_FORMAT_PALETTE) {
+		size = 1;
+	}
+	return size;
+}
+
+/* Sized formats, since unsized ones cannot be bound as images on every driver */
+static GLenum gfw_get_texture_internal_format(enum gfw_texture_pixel_format pixel_format)
+{
+	GLenum format = GL_RGBA8;
+	if (pixel_format == GFW_TEXTURE_PIXEL_FORMAT_RGB) {
+		format = GL_RGB8;
+	} else if (pixel_format == GFW_TEXTURE_PIXEL_FORMAT_PALETTE) {
+		format = GL_R8;
+	}
+	return format;
+}
+
+bool gfw_texture_bind_image(struct gfw_texture *texture, uint32_t unit, enum gfw_image_access access)
+{
+	bool success = true;
+	GLenum format = gfw_get_texture_internal_format(texture->pixel_format);
+	if (format == GL_RGB8) {
+		/* Three component textures have no image format */
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to bind texture image of unsupported pixel format.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+		goto done;
+	}
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_BINDS, 1);
+	glBindImageTexture(unit, texture->texture_gl_id, 0, GL_FALSE, 0, access, format);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to bind texture image.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#else
+		goto done;
+#endif
+	}
+#endif
+done:
+	return success;
+}
+
 void gfw_texture_put_subimage(struct gfw_texture *texture, int32_t x, int32_t y, uint8_t *data, uint32_t width, uint32_t height)
 {
+	GFW_TRACE_CALL(GFW_TRACE_CALL_TEXTURE_PUT_SUBIMAGE, data, (uint64_t)width * height * gfw_get_texture_pixel_size(texture->pixel_format), GFW_TRACE_UINT(texture->texture_gl_id), GFW_TRACE_INT(x), GFW_TRACE_INT(y), GFW_TRACE_UINT(width), GFW_TRACE_UINT(height));
 	glBindTexture(GL_TEXTURE_2D, texture->texture_gl_id);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
@@ -99,6 +295,7 @@ void gfw_texture_put_subimage(struct gfw_texture *texture, int32_t x, int32_t y,
 #endif
 	}
 #endif
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_UPLOAD_BYTES, (uint64_t)width * height * gfw_get_texture_pixel_size(texture->pixel_format));
 	glTexSubImage2D(GL_TEXTURE_2D,
 		0,
 		x,
@@ -133,7 +330,11 @@ void gfw_texture_put_subimage(struct gfw_texture *texture, int32_t x, int32_t y,
 
 void gfw_free_texture(struct gfw_texture *texture)
 {
+	GFW_TRACE_CALL(GFW_TRACE_CALL_FREE_TEXTURE, NULL, 0, GFW_TRACE_UINT(texture->texture_gl_id));
 	if (glIsTexture(texture->texture_gl_id)) {
+#ifdef GFW_DEFERRED_DELETION
+		gfw_defer_deletion(GFW_DELETION_TEXTURE, texture->texture_gl_id);
+#else
 		glDeleteTextures(1, &texture->texture_gl_id);
 #ifdef GFW_CHECK_BACKEND_ERROR
 		if (glGetError() != GL_NO_ERROR) {
@@ -144,6 +345,7 @@ void gfw_free_texture(struct gfw_texture *texture)
 			abort();
 #endif
 		}
+#endif
 #endif
 	} else {
 #ifdef GFW_PRINT_BACKEND_ERROR
@@ -157,6 +359,7 @@ void gfw_free_texture(struct gfw_texture *texture)
 	texture->pixel_format = 0;
 	texture->width = 0;
 	texture->height = 0;
+	gfw_update_handle(GFW_HANDLE_TYPE_TEXTURE, texture, 0, 0);
 }
 
 bool gfw_init_texture(struct gfw_texture *texture, struct gfw_texture_descriptor descriptor)
@@ -248,10 +451,15 @@ bool gfw_init_texture(struct gfw_texture *texture, struct gfw_texture_descriptor
 		goto done;
 #endif
 	}
+#endif
+#ifdef GFW_STATISTICS
+	if (descriptor.data) {
+		GFW_COUNT_STATISTIC(GFW_STATISTIC_UPLOAD_BYTES, (uint64_t)descriptor.width * descriptor.height * gfw_get_texture_pixel_size(descriptor.pixel_format));
+	}
 #endif
 	glTexImage2D(GL_TEXTURE_2D,
 		0,
-		descriptor.pixel_format,
+		gfw_get_texture_internal_format(descriptor.pixel_format),
 		descriptor.width,
 		descriptor.height,
 		0,
@@ -299,12 +507,17 @@ bool gfw_init_texture(struct gfw_texture *texture, struct gfw_texture_descriptor
 #if defined(GFW_CHECK_BACKEND_ERROR) && !defined(GFW_ABORT_ON_BACKEND_ERROR)
 done:
 #endif
+	if (success) {
+		gfw_update_handle(GFW_HANDLE_TYPE_TEXTURE, texture, texture->texture_gl_id, (uint64_t)texture->width * texture->height * gfw_get_texture_pixel_size(texture->pixel_format));
+		GFW_TRACE_CALL(GFW_TRACE_CALL_INIT_TEXTURE, descriptor.data, descriptor.data ? (uint64_t)descriptor.width * descriptor.height * gfw_get_texture_pixel_size(descriptor.pixel_format) : 0, GFW_TRACE_UINT(texture->texture_gl_id), GFW_TRACE_UINT(descriptor.pixel_format), GFW_TRACE_UINT(descriptor.horizontal_wrap), GFW_TRACE_UINT(descriptor.vertical_wrap), GFW_TRACE_UINT(descriptor.mag_filter), GFW_TRACE_UINT(descriptor.min_filter), GFW_TRACE_UINT(descriptor.width), GFW_TRACE_UINT(descriptor.height));
+	}
 	return success;
 }
 
 /* Framebuffer */
 void gfw_framebuffer_clear_color(gfw_float_t r, gfw_float_t g, gfw_float_t b, gfw_float_t a)
 {
+	GFW_TRACE_CALL(GFW_TRACE_CALL_FRAMEBUFFER_CLEAR_COLOR, NULL, 0, GFW_TRACE_FLOAT(r), GFW_TRACE_FLOAT(g), GFW_TRACE_FLOAT(b), GFW_TRACE_FLOAT(a));
 	glClearColor(r, g, b, a);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
@@ -320,6 +533,7 @@ void gfw_framebuffer_clear_color(gfw_float_t r, gfw_float_t g, gfw_float_t b, gf
 
 void gfw_framebuffer_clear_depth(gfw_float_t depth)
 {
+	GFW_TRACE_CALL(GFW_TRACE_CALL_FRAMEBUFFER_CLEAR_DEPTH, NULL, 0, GFW_TRACE_FLOAT(depth));
 	glClearDepth(depth);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
@@ -336,6 +550,9 @@ void gfw_framebuffer_clear_depth(gfw_float_t depth)
 void gfw_framebuffer_clear(bool color, bool depth)
 {
 	GLbitfield mask = 0;
+	/* Dither and rasterizer discard apply to clears */
+	gfw_flush_state();
+	GFW_TRACE_CALL(GFW_TRACE_CALL_FRAMEBUFFER_CLEAR, NULL, 0, GFW_TRACE_UINT(color), GFW_TRACE_UINT(depth));
 	if (color) {
 		mask = mask | GL_COLOR_BUFFER_BIT;
 	}
@@ -357,6 +574,7 @@ void gfw_framebuffer_clear(bool color, bool depth)
 
 void gfw_framebuffer_unbind(void)
 {
+	GFW_TRACE_CALL(GFW_TRACE_CALL_FRAMEBUFFER_UNBIND, NULL, 0, GFW_TRACE_UINT(0));
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
@@ -372,6 +590,8 @@ void gfw_framebuffer_unbind(void)
 
 void gfw_framebuffer_bind(struct gfw_framebuffer *framebuffer)
 {
+	GFW_TRACE_CALL(GFW_TRACE_CALL_FRAMEBUFFER_BIND, NULL, 0, GFW_TRACE_UINT(framebuffer->framebuffer_gl_id));
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_BINDS, 1);
 	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer->framebuffer_gl_id);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
@@ -387,7 +607,11 @@ void gfw_framebuffer_bind(struct gfw_framebuffer *framebuffer)
 
 void gfw_free_framebuffer(struct gfw_framebuffer *framebuffer)
 {
+	GFW_TRACE_CALL(GFW_TRACE_CALL_FREE_FRAMEBUFFER, NULL, 0, GFW_TRACE_UINT(framebuffer->framebuffer_gl_id));
 	if (glIsFramebuffer(framebuffer->framebuffer_gl_id)) {
+#ifdef GFW_DEFERRED_DELETION
+		gfw_defer_deletion(GFW_DELETION_FRAMEBUFFER, framebuffer->framebuffer_gl_id);
+#else
 		glDeleteFramebuffers(1, &framebuffer->framebuffer_gl_id);
 #ifdef GFW_CHECK_BACKEND_ERROR
 		if (glGetError() != GL_NO_ERROR) {
@@ -398,6 +622,7 @@ void gfw_free_framebuffer(struct gfw_framebuffer *framebuffer)
 			abort();
 #endif
 		}
+#endif
 #endif
 	} else {
 #ifdef GFW_PRINT_BACKEND_ERROR
@@ -409,6 +634,7 @@ void gfw_free_framebuffer(struct gfw_framebuffer *framebuffer)
 	}
 	framebuffer->framebuffer_gl_id = 0;
 	framebuffer->texture = NULL;
+	gfw_update_handle(GFW_HANDLE_TYPE_FRAMEBUFFER, framebuffer, 0, 0);
 }
 
 bool gfw_init_framebuffer(struct gfw_framebuffer *framebuffer, struct gfw_texture *texture)
@@ -501,6 +727,10 @@ bool gfw_init_framebuffer(struct gfw_framebuffer *framebuffer, struct gfw_textur
 #if defined(GFW_CHECK_BACKEND_ERROR) && !defined(GFW_ABORT_ON_BACKEND_ERROR)
 done:
 #endif
+	if (success) {
+		gfw_update_handle(GFW_HANDLE_TYPE_FRAMEBUFFER, framebuffer, framebuffer->framebuffer_gl_id, 0);
+		GFW_TRACE_CALL(GFW_TRACE_CALL_INIT_FRAMEBUFFER, NULL, 0, GFW_TRACE_UINT(framebuffer->framebuffer_gl_id), GFW_TRACE_UINT(texture->texture_gl_id));
+	}
 	return success;
 }
 
@@ -529,13 +759,26 @@ bool gfw_vertex_data_push(struct gfw_vertex_data *vertex_data, uint8_t *data, si
 		vertex_data->buffer[vertex_data->count + i] = data[i];
 		i++;
 	}
+#ifdef GFW_TRACE
+	if (gfw_trace_mapped_vertex_data == vertex_data) {
+		GFW_TRACE_CALL(GFW_TRACE_CALL_VERTEX_DATA_UPLOAD, data, size,
+			GFW_TRACE_UINT(vertex_data->vbo_gl_id),
+			GFW_TRACE_UINT(gfw_trace_mapped_offset + vertex_data->count));
+	}
+#endif
 	vertex_data->count = vertex_data->count + size;
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_UPLOAD_BYTES, size);
 done:
 	return success;
 }
 
 void gfw_vertex_data_unmap(void)
 {
+#ifdef GFW_TRACE
+	if (gfw_trace_file && gfw_trace_mapped_vertex_data) {
+		gfw_trace_vertex_data_upload();
+	}
+#endif
 	if (!glUnmapBuffer(GL_ARRAY_BUFFER)) {
 #ifdef GFW_PRINT_BACKEND_ERROR
 		printf("Warning: failed to unmap vertex data.\n");
@@ -556,6 +799,11 @@ void gfw_vertex_data_unmap(void)
 void gfw_vertex_data_map_range(struct gfw_vertex_data *vertex_data, bool read, bool write, size_t offset, size_t range)
 {
 	GLint vbo_gl_id = 0;
+#ifdef GFW_TRACE
+	/* Written bytes not pushed are read back at unmap */
+	read = read || (gfw_trace_file && write);
+#endif
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_MAPS, 1);
 	glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &vbo_gl_id);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (vbo_gl_id == 0 || vbo_gl_id != (GLint)vertex_data->vbo_gl_id) {
@@ -596,11 +844,20 @@ void gfw_vertex_data_map_range(struct gfw_vertex_data *vertex_data, bool read, b
 #endif
 	vertex_data->range = range;
 	vertex_data->count = 0;
+#ifdef GFW_TRACE
+	gfw_trace_mapped_vertex_data = write ? vertex_data : NULL;
+	gfw_trace_mapped_offset = offset;
+#endif
 }
 
 void gfw_vertex_data_map(struct gfw_vertex_data *vertex_data, bool read, bool write)
 {
 	GLint vbo_gl_id = 0;
+#ifdef GFW_TRACE
+	/* Written bytes not pushed are read back at unmap */
+	read = read || (gfw_trace_file && write);
+#endif
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_MAPS, 1);
 	glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &vbo_gl_id);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (vbo_gl_id == 0 || vbo_gl_id != (GLint)vertex_data->vbo_gl_id) {
@@ -631,10 +888,31 @@ void gfw_vertex_data_map(struct gfw_vertex_data *vertex_data, bool read, bool wr
 #endif
 	vertex_data->range = vertex_data->size;
 	vertex_data->count = 0;
+#ifdef GFW_TRACE
+	gfw_trace_mapped_vertex_data = write ? vertex_data : NULL;
+	gfw_trace_mapped_offset = 0;
+#endif
+}
+
+void gfw_vertex_data_bind_storage(struct gfw_vertex_data *vertex_data, uint32_t index)
+{
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_BINDS, 1);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, index, vertex_data->vbo_gl_id);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to bind vertex data as storage.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
 }
 
 void gfw_vertex_data_unbind(void)
 {
+	GFW_TRACE_CALL(GFW_TRACE_CALL_VERTEX_DATA_UNBIND, NULL, 0, GFW_TRACE_UINT(0));
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
@@ -650,6 +928,8 @@ void gfw_vertex_data_unbind(void)
 
 void gfw_vertex_data_bind(struct gfw_vertex_data *vertex_data)
 {
+	GFW_TRACE_CALL(GFW_TRACE_CALL_VERTEX_DATA_BIND, NULL, 0, GFW_TRACE_UINT(vertex_data->vbo_gl_id));
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_BINDS, 1);
 	glBindBuffer(GL_ARRAY_BUFFER, vertex_data->vbo_gl_id);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
@@ -665,6 +945,10 @@ void gfw_vertex_data_bind(struct gfw_vertex_data *vertex_data)
 
 void gfw_free_vertex_data(struct gfw_vertex_data *vertex_data)
 {
+	GFW_TRACE_CALL(GFW_TRACE_CALL_FREE_VERTEX_DATA, NULL, 0, GFW_TRACE_UINT(vertex_data->vbo_gl_id));
+#ifdef GFW_DEFERRED_DELETION
+	gfw_defer_deletion(GFW_DELETION_BUFFER, vertex_data->vbo_gl_id);
+#else
 	glDeleteBuffers(1, &vertex_data->vbo_gl_id);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
@@ -675,17 +959,19 @@ void gfw_free_vertex_data(struct gfw_vertex_data *vertex_data)
 		abort();
 #endif
 	}
+#endif
 #endif
 	vertex_data->vbo_gl_id = 0;
 	vertex_data->count = 0;
 	vertex_data->range = 0;
 	vertex_data->size = 0;
 	vertex_data->buffer = NULL;
+	gfw_update_handle(GFW_HANDLE_TYPE_VERTEX_DATA, vertex_data, 0, 0);
 }
 
 bool gfw_init_vertex_data(struct gfw_vertex_data *vertex_data, size_t size, enum gfw_vertex_data_usage usage)
 {
-	bool success = false;
+	bool success = true;
 	vertex_data->count = 0;
 	vertex_data->range = 0;
 	vertex_data->size = size;
@@ -765,28 +1051,62 @@ bool gfw_init_vertex_data(struct gfw_vertex_data *vertex_data, size_t size, enum
 #if defined(GFW_CHECK_BACKEND_ERROR) && !defined(GFW_ABORT_ON_BACKEND_ERROR)
 done:
 #endif
+	if (success) {
+		gfw_update_handle(GFW_HANDLE_TYPE_VERTEX_DATA, vertex_data, vertex_data->vbo_gl_id, size);
+		GFW_TRACE_CALL(GFW_TRACE_CALL_INIT_VERTEX_DATA, NULL, 0, GFW_TRACE_UINT(vertex_data->vbo_gl_id), GFW_TRACE_UINT(size), GFW_TRACE_UINT(usage));
+	}
 	return success;
 }
 
 /* Vertex State */
-void gfw_vertex_state_unbind(void)
+/* Legacy draws write their attributes into whatever vertex array is bound */
+static struct gfw_vertex_state *gfw_bound_vertex_state = NULL;
+
+static size_t gfw_index_size(enum gfw_index_type index_type)
 {
-	glBindVertexArray(0);
-#ifdef GFW_CHECK_BACKEND_ERROR
-	if (glGetError() != GL_NO_ERROR) {
-#ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to unbind vertex state.\n");
-#endif
-#ifdef GFW_ABORT_ON_BACKEND_ERROR
-		abort();
-#endif
+	size_t size = sizeof(gfw_uint_t);
+	if (index_type == GFW_INDEX_UBYTE) {
+		size = sizeof(gfw_ubyte_t);
+	} else if (index_type == GFW_INDEX_USHORT) {
+		size = sizeof(gfw_ushort_t);
 	}
-#endif
+	return size;
 }
 
-void gfw_vertex_state_bind(struct gfw_vertex_state *vertex_state)
+#ifdef GFW_VERTEX_ATTRIB_BINDING
+/* A stride of 0 means tightly packed, as glVertexAttribPointer reads it, while a binding would repeat one element */
+static size_t gfw_get_attribute_stride(struct gfw_attribute *attribute)
 {
+	size_t size = sizeof(gfw_float_t);
+	if (attribute->stride > 0) {
+		return attribute->stride;
+	}
+	if (attribute->type == GFW_ATTRIBUTE_BYTE || attribute->type == GFW_ATTRIBUTE_UBYTE) {
+		size = sizeof(gfw_byte_t);
+	} else if (attribute->type == GFW_ATTRIBUTE_SHORT || attribute->type == GFW_ATTRIBUTE_USHORT) {
+		size = sizeof(gfw_short_t);
+	} else if (attribute->type == GFW_ATTRIBUTE_HALF_FLOAT) {
+		size = sizeof(gfw_half_float_t);
+	} else if (attribute->type == GFW_ATTRIBUTE_DOUBLE) {
+		size = sizeof(gfw_double_t);
+	}
+	return size * attribute->count;
+}
+#endif
+
+void gfw_vertex_state_draw_elements_instanced(struct gfw_vertex_state *vertex_state,
+	enum gfw_primitive primitive,
+	enum gfw_index_type index_type,
+	size_t first,
+	size_t count,
+	size_t instance_count,
+	uint32_t base_instance)
+{
+	gfw_prepare_draw();
+	GFW_TRACE_CALL(GFW_TRACE_CALL_VERTEX_STATE_DRAW_ELEMENTS_INSTANCED, NULL, 0, GFW_TRACE_UINT(vertex_state->vao_gl_id), GFW_TRACE_UINT(primitive), GFW_TRACE_UINT(index_type), GFW_TRACE_UINT(first), GFW_TRACE_UINT(count), GFW_TRACE_UINT(instance_count), GFW_TRACE_UINT(base_instance));
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_DRAWS, 1);
 	glBindVertexArray(vertex_state->vao_gl_id);
+	gfw_bound_vertex_state = vertex_state;
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 #ifdef GFW_PRINT_BACKEND_ERROR
@@ -797,15 +1117,25 @@ void gfw_vertex_state_bind(struct gfw_vertex_state *vertex_state)
 #endif
 	}
 #endif
-}
-
-void gfw_free_vertex_state(struct gfw_vertex_state *vertex_state)
-{
-	glDeleteVertexArrays(1, &vertex_state->vao_gl_id);
+	/* The base instance variant requires GL 4.2, so it is only used when needed */
+	if (base_instance > 0) {
+		glDrawElementsInstancedBaseInstance(primitive,
+			count,
+			index_type,
+			(GLvoid *)(first * gfw_index_size(index_type)),
+			instance_count,
+			base_instance);
+	} else {
+		glDrawElementsInstanced(primitive,
+			count,
+			index_type,
+			(GLvoid *)(first * gfw_index_size(index_type)),
+			instance_count);
+	}
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to delete vertex state.\n");
+		printf("Error: failed to draw instanced elements of vertex state.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
@@ -814,24 +1144,18 @@ void gfw_free_vertex_state(struct gfw_vertex_state *vertex_state)
 #endif
 }
 
-bool gfw_init_vertex_state(struct gfw_vertex_state *vertex_state)
+void gfw_vertex_state_draw_instanced(struct gfw_vertex_state *vertex_state,
+	enum gfw_primitive primitive,
+	size_t first,
+	size_t count,
+	size_t instance_count,
+	uint32_t base_instance)
 {
-	bool success = false;
-	glGenVertexArrays(1, &vertex_state->vao_gl_id);
-#ifdef GFW_CHECK_BACKEND_ERROR
-	if (glGetError() != GL_NO_ERROR) {
-		success = false;
-#ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to generate vertex array object for vertex state.\n");
-#endif
-#ifdef GFW_ABORT_ON_BACKEND_ERROR
-		abort();
-#else
-		goto done;
-#endif
-	}
-#endif
+	gfw_prepare_draw();
+	GFW_TRACE_CALL(GFW_TRACE_CALL_VERTEX_STATE_DRAW_INSTANCED, NULL, 0, GFW_TRACE_UINT(vertex_state->vao_gl_id), GFW_TRACE_UINT(primitive), GFW_TRACE_UINT(first), GFW_TRACE_UINT(count), GFW_TRACE_UINT(instance_count), GFW_TRACE_UINT(base_instance));
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_DRAWS, 1);
 	glBindVertexArray(vertex_state->vao_gl_id);
+	gfw_bound_vertex_state = vertex_state;
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 #ifdef GFW_PRINT_BACKEND_ERROR
@@ -839,64 +1163,48 @@ bool gfw_init_vertex_state(struct gfw_vertex_state *vertex_state)
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
-#else
-		goto done;
 #endif
 	}
 #endif
-#ifdef GFW_CHECK_BACKEND_ERROR
-	if (!glIsVertexArray(vertex_state->vao_gl_id)) {
-		success = false;
-#ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to initialize vertex state.\n");
-#endif
-#ifdef GFW_ABORT_ON_BACKEND_ERROR
-		abort();
-#else
-		goto done;
-#endif
+	if (base_instance > 0) {
+		glDrawArraysInstancedBaseInstance(primitive, first, count, instance_count, base_instance);
+	} else {
+		glDrawArraysInstanced(primitive, first, count, instance_count);
 	}
-#endif
-	glBindVertexArray(0);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to unbind vertex state.\n");
+		printf("Error: failed to draw instanced vertex state.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
 #endif
 	}
 #endif
-#if defined(GFW_CHECK_BACKEND_ERROR) && !defined(GFW_ABORT_ON_BACKEND_ERROR)
-done:
-#endif
-	return success;
 }
 
-/* Shader */
-void gfw_shader_set_uniform_mat4(gfw_int_t location, bool normalize, gfw_float_t *matrix)
+void gfw_vertex_state_draw_elements(struct gfw_vertex_state *vertex_state, enum gfw_primitive primitive, enum gfw_index_type index_type, size_t first, size_t count)
 {
-	glUniformMatrix4fv(location, 1, normalize, matrix);
+	gfw_prepare_draw();
+	GFW_TRACE_CALL(GFW_TRACE_CALL_VERTEX_STATE_DRAW_ELEMENTS, NULL, 0, GFW_TRACE_UINT(vertex_state->vao_gl_id), GFW_TRACE_UINT(primitive), GFW_TRACE_UINT(index_type), GFW_TRACE_UINT(first), GFW_TRACE_UINT(count));
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_DRAWS, 1);
+	glBindVertexArray(vertex_state->vao_gl_id);
+	gfw_bound_vertex_state = vertex_state;
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to set 4x4 matrix uniform variable.\n");
+		printf("Error: failed to bind vertex state.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
 #endif
 	}
 #endif
-}
-
-void gfw_shader_set_uniform_mat3(gfw_int_t location, bool normalize, gfw_float_t *matrix)
-{
-	glUniformMatrix3fv(location, 1, normalize, matrix);
+	glDrawElements(primitive, count, index_type, (GLvoid *)(first * gfw_index_size(index_type)));
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to set 3x3 matrix uniform variable.\n");
+		printf("Error: failed to draw elements of vertex state.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
@@ -905,28 +1213,28 @@ void gfw_shader_set_uniform_mat3(gfw_int_t location, bool normalize, gfw_float_t
 #endif
 }
 
-void gfw_shader_set_uniform_float(gfw_int_t location, gfw_float_t f)
+void gfw_vertex_state_draw_range(struct gfw_vertex_state *vertex_state, enum gfw_primitive primitive, size_t first, size_t count)
 {
-	glUniform1f(location, f);
+	gfw_prepare_draw();
+	GFW_TRACE_CALL(GFW_TRACE_CALL_VERTEX_STATE_DRAW_RANGE, NULL, 0, GFW_TRACE_UINT(vertex_state->vao_gl_id), GFW_TRACE_UINT(primitive), GFW_TRACE_UINT(first), GFW_TRACE_UINT(count));
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_DRAWS, 1);
+	glBindVertexArray(vertex_state->vao_gl_id);
+	gfw_bound_vertex_state = vertex_state;
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to set floating-point uniform variable.\n");
+		printf("Error: failed to bind vertex state.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
 #endif
 	}
 #endif
-}
-
-void gfw_shader_set_uniform_floatv(gfw_int_t location, gfw_float_t *f, uint32_t count)
-{
-	glUniform1fv(location, count, f);
+	glDrawArrays(primitive, first, count);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to set floating-point uniform array.\n");
+		printf("Error: failed to draw vertex state.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
@@ -935,161 +1243,368 @@ void gfw_shader_set_uniform_floatv(gfw_int_t location, gfw_float_t *f, uint32_t
 #endif
 }
 
-void gfw_shader_set_uniform_int(gfw_int_t location, gfw_int_t i)
+static uint32_t gfw_hash_attributes(struct gfw_attribute *attributes, size_t attributes_count)
 {
-	glUniform1i(location, i);
-#ifdef GFW_CHECK_BACKEND_ERROR
-	if (glGetError() != GL_NO_ERROR) {
-#ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to set integer uniform variable.\n");
-#endif
-#ifdef GFW_ABORT_ON_BACKEND_ERROR
-		abort();
-#endif
+	uint32_t hash = GFW_HASH_BASIS;
+	uint32_t i = 0;
+	hash = gfw_hash(hash, &attributes_count, sizeof(attributes_count));
+	while (i < attributes_count) {
+		/* Fields are hashed one by one to skip the structure padding */
+		hash = gfw_hash(hash, &attributes[i].location, sizeof(attributes[i].location));
+		hash = gfw_hash(hash, &attributes[i].type, sizeof(attributes[i].type));
+		hash = gfw_hash(hash, &attributes[i].count, sizeof(attributes[i].count));
+		hash = gfw_hash(hash, &attributes[i].normalize, sizeof(attributes[i].normalize));
+		hash = gfw_hash(hash, &attributes[i].stride, sizeof(attributes[i].stride));
+		hash = gfw_hash(hash, &attributes[i].offset, sizeof(attributes[i].offset));
+		hash = gfw_hash(hash, &attributes[i].divisor, sizeof(attributes[i].divisor));
+		i++;
 	}
-#endif
+	return hash;
 }
 
-void gfw_shader_set_uniform_intv(gfw_int_t location, gfw_int_t *i, uint32_t count)
+/* Legacy attribute calls changed the bound vertex array, so its layouts are recorded again */
+static void gfw_vertex_state_forget_layouts(struct gfw_vertex_state *vertex_state)
 {
-	glUniform1iv(location, count, i);
-#ifdef GFW_CHECK_BACKEND_ERROR
-	if (glGetError() != GL_NO_ERROR) {
-#ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to set integer uniform array.\n");
-#endif
-#ifdef GFW_ABORT_ON_BACKEND_ERROR
-		abort();
-#endif
+	uint32_t i = 0;
+	while (i < GFW_VERTEX_STATE_MAX_BINDINGS) {
+		vertex_state->binding_vbo_gl_ids[i] = 0;
+		vertex_state->binding_layout_hashes[i] = 0;
+		vertex_state->binding_attributes_counts[i] = SIZE_MAX;
+		i++;
 	}
-#endif
 }
 
-void gfw_shader_set_uniform_uint(gfw_int_t location, gfw_uint_t i)
+/* The hash only rejects early, equal hashes are confirmed field by field */
+static bool gfw_vertex_state_has_layout(struct gfw_vertex_state *vertex_state,
+	uint32_t binding,
+	uint32_t hash,
+	struct gfw_attribute *attributes,
+	size_t attributes_count)
 {
-	glUniform1ui(location, i);
-#ifdef GFW_CHECK_BACKEND_ERROR
-	if (glGetError() != GL_NO_ERROR) {
-#ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to set unsigned integer uniform variable.\n");
-#endif
-#ifdef GFW_ABORT_ON_BACKEND_ERROR
-		abort();
-#endif
+	struct gfw_attribute *stored = vertex_state->binding_attributes[binding];
+	uint32_t i = 0;
+	if (vertex_state->binding_layout_hashes[binding] != hash
+		|| vertex_state->binding_attributes_counts[binding] != attributes_count) {
+		return false;
 	}
-#endif
+	while (i < attributes_count) {
+		if (stored[i].location != attributes[i].location
+			|| stored[i].type != attributes[i].type
+			|| stored[i].count != attributes[i].count
+			|| stored[i].normalize != attributes[i].normalize
+			|| stored[i].stride != attributes[i].stride
+			|| stored[i].offset != attributes[i].offset
+			|| stored[i].divisor != attributes[i].divisor) {
+			return false;
+		}
+		i++;
+	}
+	return true;
 }
 
-void gfw_shader_set_uniform_uintv(gfw_int_t location, gfw_uint_t *i, uint32_t count)
+static bool gfw_vertex_state_set_attributes(struct gfw_vertex_state *vertex_state,
+	uint32_t binding,
+	struct gfw_attribute *attributes,
+	size_t attributes_count,
+	uint32_t location_mask)
 {
-	glUniform1uiv(location, count, i);
-#ifdef GFW_CHECK_BACKEND_ERROR
-	if (glGetError() != GL_NO_ERROR) {
-#ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to set unsigned integer uniform array.\n");
+	bool success = true;
+	uint32_t disabled_mask = vertex_state->binding_location_masks[binding] & ~location_mask;
+	uint32_t location = 0;
+	uint32_t i = 0;
+	/* Locations still owned by another binding stay enabled */
+	while (i < GFW_VERTEX_STATE_MAX_BINDINGS) {
+		if (i != binding) {
+			disabled_mask = disabled_mask & ~vertex_state->binding_location_masks[i];
+		}
+		i++;
+	}
+	i = 0;
+	/* Disable attributes of the previous layout that are not in the new one */
+	while (location < 32) {
+		if (disabled_mask & (1u << location)) {
+			glDisableVertexAttribArray(location);
+		}
+		location++;
+	}
+	while (i < attributes_count) {
+#ifdef GFW_VERTEX_ATTRIB_BINDING
+		glVertexAttribFormat(attributes[i].location,
+			attributes[i].count,
+			attributes[i].type,
+			attributes[i].normalize,
+			attributes[i].offset);
+		glVertexAttribBinding(attributes[i].location, binding);
+#else
+		glVertexAttribPointer(attributes[i].location,
+			attributes[i].count,
+			attributes[i].type,
+			attributes[i].normalize,
+			attributes[i].stride,
+			(GLvoid *)attributes[i].offset);
+		glVertexAttribDivisor(attributes[i].location, attributes[i].divisor);
+#endif
+		glEnableVertexAttribArray(attributes[i].location);
+#ifdef GFW_CHECK_BACKEND_ERROR
+		if (glGetError() != GL_NO_ERROR) {
+			success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+			printf("Error: failed to set vertex state attribute.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+			abort();
+#else
+			goto done;
+#endif
+		}
+#endif
+		i++;
+	}
+#ifdef GFW_VERTEX_ATTRIB_BINDING
+	/* All attributes of a binding share the divisor, as checked in gfw_vertex_state_set_layout */
+	glVertexBindingDivisor(binding, attributes_count > 0 ? attributes[0].divisor : 0);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to set vertex state binding divisor.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
+#else
+		goto done;
 #endif
 	}
 #endif
+#endif
+#if defined(GFW_CHECK_BACKEND_ERROR) && !defined(GFW_ABORT_ON_BACKEND_ERROR)
+done:
+#endif
+	return success;
 }
 
-gfw_int_t gfw_shader_get_uniform_location(struct gfw_shader *shader, char *name)
+bool gfw_vertex_state_set_layout(struct gfw_vertex_state *vertex_state,
+	uint32_t binding,
+	struct gfw_vertex_data *vertex_data,
+	struct gfw_attribute *attributes,
+	size_t attributes_count)
 {
-	gfw_int_t location = glGetUniformLocation(shader->program_gl_id, name);
+	bool success = true;
+	bool bound = false;
+	bool known_layout = false;
+	uint32_t hash = 0;
+	uint32_t location_mask = 0;
+	uint32_t i = 0;
+	GFW_TRACE_CALL(GFW_TRACE_CALL_VERTEX_STATE_SET_LAYOUT, attributes, attributes_count * sizeof(*attributes), GFW_TRACE_UINT(vertex_state->vao_gl_id), GFW_TRACE_UINT(binding), GFW_TRACE_UINT(vertex_data->vbo_gl_id), GFW_TRACE_UINT(attributes_count));
+	if (binding >= GFW_VERTEX_STATE_MAX_BINDINGS) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to set layout of vertex state binding out of range.\n");
+#endif
+		goto done;
+	}
+	while (i < attributes_count) {
+		if (attributes[i].location < 0 || attributes[i].location > 31) {
+			success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+			printf("Error: failed to set layout of vertex state attribute location out of range.\n");
+#endif
+			goto done;
+		}
+#ifdef GFW_VERTEX_ATTRIB_BINDING
+		/* A binding has a single stride and divisor */
+		if (gfw_get_attribute_stride(&attributes[i]) != gfw_get_attribute_stride(&attributes[0]) || attributes[i].divisor != attributes[0].divisor) {
+			success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+			printf("Error: failed to set layout of vertex state attributes with different strides or divisors in one binding.\n");
+#endif
+			goto done;
+		}
+#endif
+		location_mask = location_mask | (1u << attributes[i].location);
+		i++;
+	}
+	/* Identical layouts are recorded only once in the vertex state */
+	hash = gfw_hash_attributes(attributes, attributes_count);
+	known_layout = gfw_vertex_state_has_layout(vertex_state, binding, hash, attributes, attributes_count);
+	if (known_layout && vertex_state->binding_vbo_gl_ids[binding] == vertex_data->vbo_gl_id) {
+		goto done;
+	}
+	glBindVertexArray(vertex_state->vao_gl_id);
+	gfw_bound_vertex_state = vertex_state;
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
+		success = false;
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to get uniform location.\n");
+		printf("Error: failed to bind vertex state.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
+#else
+		goto done;
 #endif
 	}
 #endif
-	return location;
-}
-
-gfw_int_t gfw_shader_get_attribute_location(struct gfw_shader *shader, char *name)
-{
-	gfw_int_t location = glGetAttribLocation(shader->program_gl_id, name);
+	bound = true;
+#ifdef GFW_VERTEX_ATTRIB_BINDING
+	/* With separate format and binding, only the buffer changes for a known layout */
+	if (!known_layout) {
+		if (!gfw_vertex_state_set_attributes(vertex_state, binding, attributes, attributes_count, location_mask)) {
+			success = false;
+			goto done;
+		}
+	}
+	/* All attributes of a binding share the stride and divisor, as checked above */
+	glBindVertexBuffer(binding,
+		vertex_data->vbo_gl_id,
+		0,
+		attributes_count > 0 ? gfw_get_attribute_stride(&attributes[0]) : 0);
+#else
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_data->vbo_gl_id);
+#endif
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
+		success = false;
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to get shader attribute location.\n");
+		printf("Error: failed to bind vertex data for vertex state.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
+#else
+		goto done;
 #endif
 	}
 #endif
-	return location;
-}
-
-void gfw_shader_draw_range(struct gfw_attribute *attributes,
-	size_t attributes_count,
-	enum gfw_primitive primitive,
-	size_t first,
-	size_t count)
-{
-	uint32_t i = 0;
-	while (i < attributes_count) {
-		glEnableVertexAttribArray(attributes[i].location);
-		glVertexAttribPointer(attributes[i].location,
-			attributes[i].count,
-			attributes[i].type,
-			attributes[i].normalize,
-			attributes[i].stride,
-			(GLvoid *)attributes[i].offset);
-		i++;
+#ifndef GFW_VERTEX_ATTRIB_BINDING
+	if (!gfw_vertex_state_set_attributes(vertex_state, binding, attributes, attributes_count, location_mask)) {
+		success = false;
+		goto done;
 	}
-	glDrawArrays(primitive, first, count);
-	i = 0;
-	while (i < attributes_count) {
-		glDisableVertexAttribArray(attributes[i].location);
-		i++;
+#endif
+	glBindVertexArray(0);
+	gfw_bound_vertex_state = NULL;
+#ifndef GFW_VERTEX_ATTRIB_BINDING
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+#endif
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to unbind vertex state.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#else
+		goto done;
+#endif
+	}
+#endif
+	vertex_state->binding_vbo_gl_ids[binding] = vertex_data->vbo_gl_id;
+	vertex_state->binding_layout_hashes[binding] = hash;
+	vertex_state->binding_location_masks[binding] = location_mask;
+	/* Layouts too long to store are never treated as known */
+	if (attributes_count <= GFW_VERTEX_STATE_MAX_ATTRIBUTES) {
+		memcpy(vertex_state->binding_attributes[binding], attributes, sizeof(*attributes) * attributes_count);
+		vertex_state->binding_attributes_counts[binding] = attributes_count;
+	} else {
+		vertex_state->binding_attributes_counts[binding] = SIZE_MAX;
+	}
+done:
+	/* Error paths leave the vertex state unbound, like the success path */
+	if (!success && bound) {
+		glBindVertexArray(0);
+		gfw_bound_vertex_state = NULL;
+#ifndef GFW_VERTEX_ATTRIB_BINDING
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+#endif
 	}
+	return success;
 }
 
-void gfw_shader_use(struct gfw_shader *shader)
+bool gfw_vertex_state_set_index_data(struct gfw_vertex_state *vertex_state, struct gfw_vertex_data *vertex_data)
 {
-	glUseProgram(shader->program_gl_id);
+	bool success = true;
+	GFW_TRACE_CALL(GFW_TRACE_CALL_VERTEX_STATE_SET_INDEX_DATA, NULL, 0, GFW_TRACE_UINT(vertex_state->vao_gl_id), GFW_TRACE_UINT(vertex_data->vbo_gl_id));
+	if (vertex_state->index_vbo_gl_id == vertex_data->vbo_gl_id) {
+		goto done;
+	}
+	glBindVertexArray(vertex_state->vao_gl_id);
+	gfw_bound_vertex_state = vertex_state;
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
+		success = false;
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to use shader.\n");
+		printf("Error: failed to bind vertex state.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#else
+		goto done;
+#endif
+	}
+#endif
+	/* The element buffer binding is part of the vertex array object */
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vertex_data->vbo_gl_id);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to bind index data for vertex state.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#else
+		goto done;
+#endif
+	}
+#endif
+	glBindVertexArray(0);
+	gfw_bound_vertex_state = NULL;
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to unbind vertex state.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
+#else
+		goto done;
 #endif
 	}
 #endif
+	vertex_state->index_vbo_gl_id = vertex_data->vbo_gl_id;
+done:
+	return success;
 }
 
-void gfw_free_shader(struct gfw_shader *shader)
+void gfw_vertex_state_unbind(void)
 {
-	glDeleteProgram(shader->program_gl_id);
+	GFW_TRACE_CALL(GFW_TRACE_CALL_VERTEX_STATE_UNBIND, NULL, 0, GFW_TRACE_UINT(0));
+	glBindVertexArray(0);
+	gfw_bound_vertex_state = NULL;
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to delete shader program.\n");
+		printf("Error: failed to unbind vertex state.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
 #endif
 	}
 #endif
-	shader->program_gl_id = 0;
 }
 
-static void gfw_detach_shader(GLuint program_gl_id, GLuint shader_gl_id)
+void gfw_vertex_state_bind(struct gfw_vertex_state *vertex_state)
 {
-	glDetachShader(program_gl_id, shader_gl_id);
+	GFW_TRACE_CALL(GFW_TRACE_CALL_VERTEX_STATE_BIND, NULL, 0, GFW_TRACE_UINT(vertex_state->vao_gl_id));
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_BINDS, 1);
+	glBindVertexArray(vertex_state->vao_gl_id);
+	gfw_bound_vertex_state = vertex_state;
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to detach shader.\n");
+		printf("Error: failed to bind vertex state.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
@@ -1098,38 +1613,58 @@ static void gfw_detach_shader(GLuint program_gl_id, GLuint shader_gl_id)
 #endif
 }
 
-static void gfw_delete_shader(GLuint shader_gl_id)
+void gfw_free_vertex_state(struct gfw_vertex_state *vertex_state)
 {
-	glDeleteShader(shader_gl_id);
+	uint32_t i = 0;
+	GFW_TRACE_CALL(GFW_TRACE_CALL_FREE_VERTEX_STATE, NULL, 0, GFW_TRACE_UINT(vertex_state->vao_gl_id));
+	if (gfw_bound_vertex_state == vertex_state) {
+		gfw_bound_vertex_state = NULL;
+	}
+#ifdef GFW_DEFERRED_DELETION
+	gfw_defer_deletion(GFW_DELETION_VERTEX_ARRAY, vertex_state->vao_gl_id);
+#else
+	glDeleteVertexArrays(1, &vertex_state->vao_gl_id);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to delete shader.\n");
+		printf("Error: failed to delete vertex state.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
 #endif
 	}
 #endif
+#endif
+	vertex_state->vao_gl_id = 0;
+	vertex_state->index_vbo_gl_id = 0;
+	while (i < GFW_VERTEX_STATE_MAX_BINDINGS) {
+		vertex_state->binding_vbo_gl_ids[i] = 0;
+		vertex_state->binding_layout_hashes[i] = 0;
+		vertex_state->binding_location_masks[i] = 0;
+		vertex_state->binding_attributes_counts[i] = 0;
+		i++;
+	}
+	gfw_update_handle(GFW_HANDLE_TYPE_VERTEX_STATE, vertex_state, 0, 0);
 }
 
-static bool gfw_compile_shader(GLuint *shader_gl_id, GLenum shader_type, char *source)
+bool gfw_init_vertex_state(struct gfw_vertex_state *vertex_state)
 {
 	bool success = true;
-	GLint param = 0;
-	char log_string[GFW_SHADER_LOG_MAX_LENGTH] = {0};
-	*shader_gl_id = glCreateShader(shader_type);
+	uint32_t i = 0;
+	vertex_state->index_vbo_gl_id = 0;
+	while (i < GFW_VERTEX_STATE_MAX_BINDINGS) {
+		vertex_state->binding_vbo_gl_ids[i] = 0;
+		vertex_state->binding_layout_hashes[i] = 0;
+		vertex_state->binding_location_masks[i] = 0;
+		vertex_state->binding_attributes_counts[i] = 0;
+		i++;
+	}
+	glGenVertexArrays(1, &vertex_state->vao_gl_id);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 		success = false;
 #ifdef GFW_PRINT_BACKEND_ERROR
-		if (shader_type == GL_VERTEX_SHADER) {
-			printf("Error: failed to create vertex shader.\n");
-		} else if (shader_type == GL_FRAGMENT_SHADER) {
-			printf("Error: failed to create fragment shader.\n");
-		} else if (shader_type == GL_GEOMETRY_SHADER) {
-			printf("Error: failed to create geometry shader.\n");
-		}
+		printf("Error: failed to generate vertex array object for vertex state.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
@@ -1138,18 +1673,12 @@ static bool gfw_compile_shader(GLuint *shader_gl_id, GLenum shader_type, char *s
 #endif
 	}
 #endif
-	glShaderSource(*shader_gl_id, 1, (const char **)&source, NULL);
+	glBindVertexArray(vertex_state->vao_gl_id);
+	gfw_bound_vertex_state = vertex_state;
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
-		success = false;
 #ifdef GFW_PRINT_BACKEND_ERROR
-		if (shader_type == GL_VERTEX_SHADER) {
-			printf("Error: failed to set vertex shader source.\n");
-		} else if (shader_type == GL_FRAGMENT_SHADER) {
-			printf("Error: failed to set fragment shader source.\n");
-		} else if (shader_type == GL_GEOMETRY_SHADER) {
-			printf("Error: failed to set geometry shader source.\n");
-		}
+		printf("Error: failed to bind vertex state.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
@@ -1158,18 +1687,11 @@ static bool gfw_compile_shader(GLuint *shader_gl_id, GLenum shader_type, char *s
 #endif
 	}
 #endif
-	glCompileShader(*shader_gl_id);
 #ifdef GFW_CHECK_BACKEND_ERROR
-	if (glGetError() != GL_NO_ERROR) {
+	if (!glIsVertexArray(vertex_state->vao_gl_id)) {
 		success = false;
 #ifdef GFW_PRINT_BACKEND_ERROR
-		if (shader_type == GL_VERTEX_SHADER) {
-			printf("Error: failed to compile vertex shader.\n");
-		} else if (shader_type == GL_FRAGMENT_SHADER) {
-			printf("Error: failed to compile fragment shader.\n");
-		} else if (shader_type == GL_GEOMETRY_SHADER) {
-			printf("Error: failed to compile geometry shader.\n");
-		}
+		printf("Error: failed to initialize vertex state.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
@@ -1178,111 +1700,51 @@ static bool gfw_compile_shader(GLuint *shader_gl_id, GLenum shader_type, char *s
 #endif
 	}
 #endif
-	glGetShaderiv(*shader_gl_id, GL_COMPILE_STATUS, &param);
+	glBindVertexArray(0);
+	gfw_bound_vertex_state = NULL;
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
-		success = false;
 #ifdef GFW_PRINT_BACKEND_ERROR
-		if (shader_type == GL_VERTEX_SHADER) {
-			printf("Error: failed to get vertex shader status.\n");
-		} else if (shader_type == GL_FRAGMENT_SHADER) {
-			printf("Error: failed to get fragment shader status.\n");
-		} else if (shader_type == GL_GEOMETRY_SHADER) {
-			printf("Error: failed to get geometry shader status.\n");
-		}
+		printf("Error: failed to unbind vertex state.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
-#else
-		goto done;
 #endif
 	}
 #endif
-	if (!param) {
-		GLsizei length;
-		glGetShaderInfoLog(*shader_gl_id,
-			GFW_SHADER_LOG_MAX_LENGTH,
-			&length,
-			log_string);
-#ifdef GFW_CHECK_BACKEND_ERROR
-		if (glGetError() != GL_NO_ERROR) {
-			success = false;
-#ifdef GFW_PRINT_BACKEND_ERROR
-			if (shader_type == GL_VERTEX_SHADER) {
-				printf("Error: failed to get vertex shader info log.\n");
-			} else if (shader_type == GL_FRAGMENT_SHADER) {
-				printf("Error: failed to get fragment shader info log.\n");
-			} else if (shader_type == GL_GEOMETRY_SHADER) {
-				printf("Error: failed to get geometry shader info log.\n");
-			}
-#endif
-#ifdef GFW_ABORT_ON_BACKEND_ERROR
-			abort();
-#else
-			goto done;
-#endif
-		}
-#endif
-#ifdef GFW_PRINT_BACKEND_ERROR
-		if (shader_type == GL_VERTEX_SHADER) {
-			printf("Vertex shader error:\n %s", log_string);
-		} else if (shader_type == GL_FRAGMENT_SHADER) {
-			printf("Fragment shader error:\n %s", log_string);
-		} else if (shader_type == GL_GEOMETRY_SHADER) {
-			printf("Geometry shader error:\n %s", log_string);
-		}
+#if defined(GFW_CHECK_BACKEND_ERROR) && !defined(GFW_ABORT_ON_BACKEND_ERROR)
+done:
 #endif
-		success = false;
-		goto done;
+	if (success) {
+		gfw_update_handle(GFW_HANDLE_TYPE_VERTEX_STATE, vertex_state, vertex_state->vao_gl_id, 0);
+		GFW_TRACE_CALL(GFW_TRACE_CALL_INIT_VERTEX_STATE, NULL, 0, GFW_TRACE_UINT(vertex_state->vao_gl_id));
 	}
-done:
 	return success;
 }
 
-bool gfw_init_shader(struct gfw_shader *shader, char *vertex_source, char *geometry_source, char *fragment_source)
+/* Draw list */
+void gfw_vertex_state_multi_draw_indirect(struct gfw_vertex_state *vertex_state,
+	enum gfw_primitive primitive,
+	struct gfw_vertex_data *indirect_data,
+	size_t offset,
+	size_t draw_count)
 {
-	bool success = true;
-	GLuint vertex_shader_gl_id = 0;
-	GLuint geometry_shader_gl_id = 0;
-	GLuint fragment_shader_gl_id = 0;
-	GLint param = 0;
-	char log_string[GFW_SHADER_LOG_MAX_LENGTH] = {0};
-	/* Vertex shader */
-	if (!gfw_compile_shader(&vertex_shader_gl_id, GL_VERTEX_SHADER, vertex_source)) {
-		success = false;
-		goto done;
-	}
-	if (geometry_source) {
-		if (!gfw_compile_shader(&geometry_shader_gl_id, GL_GEOMETRY_SHADER, geometry_source)) {
-			success = false;
-			goto done;
-		}
-	}
-	if (!gfw_compile_shader(&fragment_shader_gl_id, GL_FRAGMENT_SHADER, fragment_source)) {
-		success = false;
-		goto done;
-	}
-	/* Create program and attach shaders */
-	shader->program_gl_id = glCreateProgram();
-#ifdef GFW_CHECK_BACKEND_ERROR
-	if (glGetError() != GL_NO_ERROR) {
-		success = false;
+	/* The draw count is passed on as a GLsizei */
+	if (draw_count > INT_MAX) {
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to create shader program.\n");
+		printf("Error: failed to draw indirect vertex state with more than INT_MAX draws.\n");
 #endif
-#ifdef GFW_ABORT_ON_BACKEND_ERROR
-		abort();
-#else
 		goto done;
-#endif
 	}
-#endif
-	glAttachShader(shader->program_gl_id, vertex_shader_gl_id);
+	gfw_prepare_draw();
+	GFW_TRACE_CALL(GFW_TRACE_CALL_VERTEX_STATE_MULTI_DRAW_INDIRECT, NULL, 0, GFW_TRACE_UINT(vertex_state->vao_gl_id), GFW_TRACE_UINT(primitive), GFW_TRACE_UINT(indirect_data->vbo_gl_id), GFW_TRACE_UINT(offset), GFW_TRACE_UINT(draw_count));
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_DRAWS, 1);
+	glBindVertexArray(vertex_state->vao_gl_id);
+	gfw_bound_vertex_state = vertex_state;
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
-		success = false;
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to attach vertex shader.\n");
+		printf("Error: failed to bind vertex state.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
@@ -1291,28 +1753,11 @@ bool gfw_init_shader(struct gfw_shader *shader, char *vertex_source, char *geome
 #endif
 	}
 #endif
-	if (geometry_source) {
-		glAttachShader(shader->program_gl_id, geometry_shader_gl_id);
-#ifdef GFW_CHECK_BACKEND_ERROR
-		if (glGetError() != GL_NO_ERROR) {
-			success = false;
-#ifdef GFW_PRINT_BACKEND_ERROR
-			printf("Error: failed to attach geometry shader.\n");
-#endif
-#ifdef GFW_ABORT_ON_BACKEND_ERROR
-			abort();
-#else
-			goto done;
-#endif
-		}
-#endif
-	}
-	glAttachShader(shader->program_gl_id, fragment_shader_gl_id);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_data->vbo_gl_id);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
-		success = false;
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to attach fragment shader.\n");
+		printf("Error: failed to bind indirect data.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
@@ -1321,12 +1766,11 @@ bool gfw_init_shader(struct gfw_shader *shader, char *vertex_source, char *geome
 #endif
 	}
 #endif
-	glLinkProgram(shader->program_gl_id);
+	glMultiDrawArraysIndirect(primitive, (GLvoid *)offset, draw_count, sizeof(struct gfw_draw_command));
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
-		success = false;
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to link shader program.\n");
+		printf("Error: failed to draw indirect vertex state.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
@@ -1335,72 +1779,64 @@ bool gfw_init_shader(struct gfw_shader *shader, char *vertex_source, char *geome
 #endif
 	}
 #endif
-	/* Check status */
-	glGetProgramiv(shader->program_gl_id, GL_LINK_STATUS, &param);
+done:
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void gfw_vertex_state_multi_draw_elements(struct gfw_vertex_state *vertex_state, enum gfw_primitive primitive, enum gfw_index_type index_type, struct gfw_draw_list *draw_list)
+{
+	uint32_t i = 0;
+	while (i < draw_list->count) {
+		draw_list->offsets[i] = (GLvoid *)(draw_list->commands[i].first * gfw_index_size(index_type));
+		i++;
+	}
+	gfw_prepare_draw();
+	GFW_TRACE_CALL(GFW_TRACE_CALL_VERTEX_STATE_MULTI_DRAW_ELEMENTS, draw_list->commands, draw_list->count * sizeof(struct gfw_draw_command), GFW_TRACE_UINT(vertex_state->vao_gl_id), GFW_TRACE_UINT(primitive), GFW_TRACE_UINT(index_type), GFW_TRACE_UINT(draw_list->count));
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_DRAWS, 1);
+	glBindVertexArray(vertex_state->vao_gl_id);
+	gfw_bound_vertex_state = vertex_state;
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
-		success = false;
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to get shader program status.\n");
+		printf("Error: failed to bind vertex state.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
-#else
-		goto done;
 #endif
 	}
 #endif
-	if (!param) {
-		GLsizei length;
-		glGetProgramInfoLog(shader->program_gl_id,
-			GFW_SHADER_LOG_MAX_LENGTH,
-			&length,
-			log_string);
-#ifdef GFW_CHECK_BACKEND_ERROR
-		if (glGetError() != GL_NO_ERROR) {
-			success = false;
-#ifdef GFW_PRINT_BACKEND_ERROR
-			printf("Error: failed to get program info log.\n");
-#endif
-#ifdef GFW_ABORT_ON_BACKEND_ERROR
-			abort();
-#else
-			goto done;
-#endif
-		}
-#endif
-#ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Program shader error:\n %s", log_string);
-#endif
-		gfw_delete_shader(vertex_shader_gl_id);
-		if (geometry_source) {
-			gfw_delete_shader(geometry_shader_gl_id);
+	if (draw_list->instanced) {
+		/* Instanced records can not go through glMultiDrawElements */
+		i = 0;
+		while (i < draw_list->count) {
+			/* The base instance variant requires GL 4.2, so it is only used when needed */
+			if (draw_list->commands[i].base_instance > 0) {
+				glDrawElementsInstancedBaseInstance(primitive,
+					draw_list->commands[i].count,
+					index_type,
+					draw_list->offsets[i],
+					draw_list->commands[i].instance_count,
+					draw_list->commands[i].base_instance);
+			} else {
+				glDrawElementsInstanced(primitive,
+					draw_list->commands[i].count,
+					index_type,
+					draw_list->offsets[i],
+					draw_list->commands[i].instance_count);
+			}
+			i++;
 		}
-		gfw_delete_shader(fragment_shader_gl_id);
-		success = false;
-		goto done;
-	}
-	/* Detach and delete unneeded shaders */
-	gfw_detach_shader(shader->program_gl_id, vertex_shader_gl_id);
-	gfw_delete_shader(vertex_shader_gl_id);
-	if (geometry_source) {
-		gfw_detach_shader(shader->program_gl_id, geometry_shader_gl_id);
-		gfw_delete_shader(geometry_shader_gl_id);
+	} else {
+		glMultiDrawElements(primitive,
+			draw_list->counts,
+			index_type,
+			(const GLvoid *const *)draw_list->offsets,
+			draw_list->count);
 	}
-	gfw_detach_shader(shader->program_gl_id, fragment_shader_gl_id);
-	gfw_delete_shader(fragment_shader_gl_id);
-done:
-	return success;
-}
-
-/* Graphic state */
-void gfw_set_viewport(int32_t x, int32_t y, uint32_t width, uint32_t height)
-{
-	glViewport(x, y, width, height);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to set viewport.\n");
+		printf("Error: failed to draw elements of draw list.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
@@ -1409,28 +1845,48 @@ void gfw_set_viewport(int32_t x, int32_t y, uint32_t width, uint32_t height)
 #endif
 }
 
-void gfw_enable_blend(void)
+void gfw_vertex_state_multi_draw(struct gfw_vertex_state *vertex_state, enum gfw_primitive primitive, struct gfw_draw_list *draw_list)
 {
-	glEnable(GL_BLEND);
+	uint32_t i = 0;
+	gfw_prepare_draw();
+	GFW_TRACE_CALL(GFW_TRACE_CALL_VERTEX_STATE_MULTI_DRAW, draw_list->commands, draw_list->count * sizeof(struct gfw_draw_command), GFW_TRACE_UINT(vertex_state->vao_gl_id), GFW_TRACE_UINT(primitive), GFW_TRACE_UINT(draw_list->count));
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_DRAWS, 1);
+	glBindVertexArray(vertex_state->vao_gl_id);
+	gfw_bound_vertex_state = vertex_state;
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to enable blending.\n");
+		printf("Error: failed to bind vertex state.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
 #endif
 	}
 #endif
-}
-
-void gfw_disable_blend(void)
-{
-	glDisable(GL_BLEND);
+	if (draw_list->instanced) {
+		/* Instanced records can not go through glMultiDrawArrays */
+		while (i < draw_list->count) {
+			if (draw_list->commands[i].base_instance > 0) {
+				glDrawArraysInstancedBaseInstance(primitive,
+					draw_list->commands[i].first,
+					draw_list->commands[i].count,
+					draw_list->commands[i].instance_count,
+					draw_list->commands[i].base_instance);
+			} else {
+				glDrawArraysInstanced(primitive,
+					draw_list->commands[i].first,
+					draw_list->commands[i].count,
+					draw_list->commands[i].instance_count);
+			}
+			i++;
+		}
+	} else {
+		glMultiDrawArrays(primitive, draw_list->firsts, draw_list->counts, draw_list->count);
+	}
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to disable blending.\n");
+		printf("Error: failed to draw draw list.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
@@ -1439,133 +1895,464 @@ void gfw_disable_blend(void)
 #endif
 }
 
-void gfw_enable_clip_distance(uint32_t i)
+bool gfw_draw_list_upload(struct gfw_draw_list *draw_list, struct gfw_vertex_data *indirect_data, size_t offset)
 {
-	glEnable(GL_CLIP_DISTANCE0 + i);
-#ifdef GFW_CHECK_BACKEND_ERROR
-	if (glGetError() != GL_NO_ERROR) {
+	bool success = true;
+	bool bound = false;
+	size_t size = draw_list->count * sizeof(struct gfw_draw_command);
+	if (offset + size > indirect_data->size) {
+		success = false;
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to enable clip distance in space %u.\n", i);
-#endif
-#ifdef GFW_ABORT_ON_BACKEND_ERROR
-		abort();
+		printf("Warning: not enough space in indirect data for draw list.\n");
 #endif
+		goto done;
 	}
-#endif
-}
-
-void gfw_disable_clip_distance(uint32_t i)
-{
-	glDisable(GL_CLIP_DISTANCE0 + i);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_data->vbo_gl_id);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
+		success = false;
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to disable clip distance in space %u.\n", i);
+		printf("Error: failed to bind indirect data.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
+#else
+		goto done;
 #endif
 	}
 #endif
-}
-
-void gfw_enable_color_logic_operation(void)
-{
-	glEnable(GL_COLOR_LOGIC_OP);
+	bound = true;
+	GFW_TRACE_CALL(GFW_TRACE_CALL_DRAW_LIST_UPLOAD, draw_list->commands, size, GFW_TRACE_UINT(indirect_data->vbo_gl_id), GFW_TRACE_UINT(offset));
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_UPLOAD_BYTES, size);
+	glBufferSubData(GL_DRAW_INDIRECT_BUFFER, offset, size, draw_list->commands);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
+		success = false;
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to enable color logic operation.\n");
+		printf("Error: failed to upload draw list.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
+#else
+		goto done;
 #endif
 	}
 #endif
+done:
+	if (bound) {
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+	return success;
 }
 
-void gfw_disable_color_logic_operation(void)
+bool gfw_draw_list_push_instanced(struct gfw_draw_list *draw_list, size_t first, size_t count, size_t instance_count, uint32_t base_instance)
 {
-	glDisable(GL_COLOR_LOGIC_OP);
-#ifdef GFW_CHECK_BACKEND_ERROR
-	if (glGetError() != GL_NO_ERROR) {
+	bool success = true;
+	if (draw_list->count >= draw_list->capacity) {
+		success = false;
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to disable color logic operation.\n");
-#endif
-#ifdef GFW_ABORT_ON_BACKEND_ERROR
-		abort();
+		printf("Warning: not enough space in draw list for draw.\n");
 #endif
+		goto done;
 	}
+	/* Firsts and counts are passed on as GLint and GLsizei */
+	if (first > INT_MAX || count > INT_MAX || instance_count > INT_MAX) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Warning: draw of draw list out of range.\n");
 #endif
+		goto done;
+	}
+	draw_list->firsts[draw_list->count] = first;
+	draw_list->counts[draw_list->count] = count;
+	draw_list->commands[draw_list->count].count = count;
+	draw_list->commands[draw_list->count].instance_count = instance_count;
+	draw_list->commands[draw_list->count].first = first;
+	draw_list->commands[draw_list->count].base_instance = base_instance;
+	if (instance_count != 1 || base_instance != 0) {
+		draw_list->instanced = true;
+	}
+	draw_list->count = draw_list->count + 1;
+done:
+	return success;
 }
 
-void gfw_enable_cull_face(void)
+bool gfw_draw_list_push(struct gfw_draw_list *draw_list, size_t first, size_t count)
 {
-	glEnable(GL_CULL_FACE);
-#ifdef GFW_CHECK_BACKEND_ERROR
-	if (glGetError() != GL_NO_ERROR) {
+	return gfw_draw_list_push_instanced(draw_list, first, count, 1, 0);
+}
+
+void gfw_draw_list_clear(struct gfw_draw_list *draw_list)
+{
+	draw_list->count = 0;
+	draw_list->instanced = false;
+}
+
+void gfw_free_draw_list(struct gfw_draw_list *draw_list)
+{
+	free(draw_list->firsts);
+	free(draw_list->counts);
+	free(draw_list->offsets);
+	free(draw_list->commands);
+	draw_list->firsts = NULL;
+	draw_list->counts = NULL;
+	draw_list->offsets = NULL;
+	draw_list->commands = NULL;
+	draw_list->count = 0;
+	draw_list->capacity = 0;
+	draw_list->instanced = false;
+}
+
+bool gfw_init_draw_list(struct gfw_draw_list *draw_list, size_t capacity)
+{
+	bool success = true;
+	draw_list->count = 0;
+	draw_list->capacity = capacity;
+	draw_list->instanced = false;
+	draw_list->firsts = NULL;
+	draw_list->counts = NULL;
+	draw_list->offsets = NULL;
+	draw_list->commands = NULL;
+	if (capacity == 0) {
+		success = false;
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to enable cull face.\n");
+		printf("Error: failed to create draw list with capacity 0.\n");
 #endif
-#ifdef GFW_ABORT_ON_BACKEND_ERROR
-		abort();
+		goto done;
+	}
+	/* The draw count of a list is passed on as a GLsizei */
+	if (capacity > INT_MAX) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to create draw list with capacity above INT_MAX.\n");
 #endif
+		goto done;
 	}
+	draw_list->firsts = malloc(capacity * sizeof(*draw_list->firsts));
+	draw_list->counts = malloc(capacity * sizeof(*draw_list->counts));
+	draw_list->offsets = malloc(capacity * sizeof(*draw_list->offsets));
+	draw_list->commands = malloc(capacity * sizeof(*draw_list->commands));
+	if (!draw_list->firsts || !draw_list->counts || !draw_list->offsets || !draw_list->commands) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to allocate draw list.\n");
 #endif
+		gfw_free_draw_list(draw_list);
+	}
+done:
+	return success;
 }
 
-void gfw_disable_cull_face(void)
+/* Shader */
+static struct gfw_shader *gfw_current_shader = NULL;
+static bool gfw_program_in_use = false;
+static struct gfw_uniform_statistics gfw_uniform_statistics = {0};
+static bool gfw_has_program_uniforms(void);
+
+/* A program in use takes the plain setters, the program setters need GL 4.1 */
+static void gfw_upload_uniform(struct gfw_shader *shader, struct gfw_shader_uniform *uniform, bool in_use)
 {
-	glDisable(GL_CULL_FACE);
+	/* Array elements are set from the location of the first dirty one, whatever the numbering */
+	gfw_int_t location = shader->uniform_locations[uniform->locations_offset + uniform->dirty_first];
+	GLsizei count = uniform->dirty_last - uniform->dirty_first;
+	void *data = shader->uniform_storage + uniform->offset + uniform->dirty_first * uniform->element_size;
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_UNIFORM_UPDATES, 1);
+	if (in_use) {
+		if (uniform->type == GL_FLOAT) {
+			glUniform1fv(location, count, data);
+		} else if (uniform->type == GL_UNSIGNED_INT) {
+			glUniform1uiv(location, count, data);
+		} else if (uniform->type == GL_FLOAT_MAT3) {
+			glUniformMatrix3fv(location, count, uniform->transpose, data);
+		} else if (uniform->type == GL_FLOAT_MAT4) {
+			glUniformMatrix4fv(location, count, uniform->transpose, data);
+		} else {
+			glUniform1iv(location, count, data);
+		}
+	} else if (uniform->type == GL_FLOAT) {
+		glProgramUniform1fv(shader->program_gl_id, location, count, data);
+	} else if (uniform->type == GL_UNSIGNED_INT) {
+		glProgramUniform1uiv(shader->program_gl_id, location, count, data);
+	} else if (uniform->type == GL_FLOAT_MAT3) {
+		glProgramUniformMatrix3fv(shader->program_gl_id, location, count, uniform->transpose, data);
+	} else if (uniform->type == GL_FLOAT_MAT4) {
+		glProgramUniformMatrix4fv(shader->program_gl_id, location, count, uniform->transpose, data);
+	} else {
+		glProgramUniform1iv(shader->program_gl_id, location, count, data);
+	}
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to disable cull face.\n");
+		printf("Error: failed to upload uniform variable.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
 #endif
 	}
 #endif
+	uniform->dirty = false;
+	gfw_uniform_statistics.issued = gfw_uniform_statistics.issued + 1;
 }
 
-void gfw_enable_depth_clamp(void)
+static GLenum gfw_get_uniform_setter_type(GLenum type)
 {
-	glEnable(GL_DEPTH_CLAMP);
-#ifdef GFW_CHECK_BACKEND_ERROR
-	if (glGetError() != GL_NO_ERROR) {
-#ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to enable depth clamp.\n");
-#endif
-#ifdef GFW_ABORT_ON_BACKEND_ERROR
-		abort();
-#endif
+	/* Booleans and samplers are set through the integer setters */
+	if (type == GL_FLOAT || type == GL_UNSIGNED_INT || type == GL_FLOAT_MAT3 || type == GL_FLOAT_MAT4) {
+		return type;
 	}
-#endif
+	return GL_INT;
 }
 
-void gfw_disable_depth_clamp(void)
+/* Returns false when the uniform is not shadowed and has to be set directly */
+static bool gfw_shadow_uniform(gfw_int_t location, GLenum setter_type, void *data, uint32_t element_size, uint32_t count, bool transpose)
 {
-	glDisable(GL_DEPTH_CLAMP);
-#ifdef GFW_CHECK_BACKEND_ERROR
-	if (glGetError() != GL_NO_ERROR) {
+	struct gfw_shader *shader = gfw_current_shader;
+	struct gfw_shader_uniform *uniform = NULL;
+	uint32_t first = 0;
+	uint8_t *storage = NULL;
+	if (!shader || !shader->uniform_slots || location < 0 || (uint32_t)location >= shader->uniform_slots_count) {
+		return false;
+	}
+	if (shader->uniform_slots[location] < 0) {
+		return false;
+	}
+	uniform = &shader->uniforms[shader->uniform_slots[location]];
+	first = shader->uniform_slot_elements[location];
+	/* A setter of another family is left to the driver, which reports the mismatch */
+	if (gfw_get_uniform_setter_type(uniform->type) != setter_type
+		|| uniform->element_size != element_size
+		|| first + count > uniform->size) {
+		return false;
+	}
+	storage = shader->uniform_storage + uniform->offset + first * element_size;
+	if (uniform->transpose == transpose && memcmp(storage, data, count * element_size) == 0) {
+		gfw_uniform_statistics.skipped = gfw_uniform_statistics.skipped + 1;
+		return true;
+	}
+	memcpy(storage, data, count * element_size);
+	if (!uniform->dirty) {
+		uniform->dirty = true;
+		uniform->dirty_first = first;
+		uniform->dirty_last = first + count;
+		shader->dirty_uniforms[shader->dirty_uniforms_count] = shader->uniform_slots[location];
+		shader->dirty_uniforms_count = shader->dirty_uniforms_count + 1;
+	} else {
+		if (first < uniform->dirty_first) {
+			uniform->dirty_first = first;
+		}
+		if (first + count > uniform->dirty_last) {
+			uniform->dirty_last = first + count;
+		}
+	}
+	/* Changing the transpose flag changes the meaning of every element */
+	if (uniform->transpose != transpose) {
+		uniform->transpose = transpose;
+		uniform->dirty_first = 0;
+		uniform->dirty_last = uniform->size;
+	}
+	gfw_uniform_statistics.deferred = gfw_uniform_statistics.deferred + 1;
+	return true;
+}
+
+static uint32_t gfw_get_uniform_element_size(GLenum type)
+{
+	uint32_t size = 0;
+	if (type == GL_FLOAT || type == GL_INT || type == GL_UNSIGNED_INT || type == GL_BOOL) {
+		size = 4;
+	} else if (type == GL_FLOAT_MAT3) {
+		size = 9 * sizeof(gfw_float_t);
+	} else if (type == GL_FLOAT_MAT4) {
+		size = 16 * sizeof(gfw_float_t);
+	} else if (type == GL_SAMPLER_1D || type == GL_SAMPLER_2D || type == GL_SAMPLER_3D
+		|| type == GL_SAMPLER_CUBE || type == GL_SAMPLER_2D_ARRAY || type == GL_SAMPLER_2D_SHADOW
+		|| type == GL_SAMPLER_BUFFER || type == GL_INT_SAMPLER_2D || type == GL_UNSIGNED_INT_SAMPLER_2D) {
+		size = 4;
+	}
+	return size;
+}
+
+static void gfw_reset_uniform_shadow(struct gfw_shader *shader)
+{
+	shader->uniforms = NULL;
+	shader->uniforms_count = 0;
+	shader->uniform_slots = NULL;
+	shader->uniform_slot_elements = NULL;
+	shader->uniform_slots_count = 0;
+	shader->uniform_locations = NULL;
+	shader->dirty_uniforms = NULL;
+	shader->dirty_uniforms_count = 0;
+	shader->uniform_storage = NULL;
+}
+
+static void gfw_free_uniform_shadow(struct gfw_shader *shader)
+{
+	free(shader->uniforms);
+	free(shader->uniform_slots);
+	free(shader->uniform_slot_elements);
+	free(shader->uniform_locations);
+	free(shader->dirty_uniforms);
+	free(shader->uniform_storage);
+	gfw_reset_uniform_shadow(shader);
+}
+
+static void gfw_build_uniform_shadow(struct gfw_shader *shader)
+{
+	struct gfw_shader_uniform *uniform = NULL;
+	struct gfw_shader_variable *variable = NULL;
+	char name[GFW_SHADER_NAME_MAX_LENGTH] = {0};
+	gfw_int_t location = 0;
+	uint32_t storage_size = 0;
+	uint32_t locations_count = 0;
+	uint32_t element = 0;
+	uint32_t i = 0;
+	uint32_t j = 0;
+	gfw_free_uniform_shadow(shader);
+	shader->uniforms = calloc(shader->variables_count + 1, sizeof(*shader->uniforms));
+	shader->dirty_uniforms = calloc(shader->variables_count + 1, sizeof(*shader->dirty_uniforms));
+	if (!shader->uniforms || !shader->dirty_uniforms) {
+		goto error;
+	}
+	/* Only uniforms of types with a setter are shadowed, the others are set directly */
+	while (i < shader->variables_capacity) {
+		variable = &shader->variables[i];
+		if (variable->kind == GFW_SHADER_VARIABLE_UNIFORM && gfw_get_uniform_element_size(variable->type) > 0) {
+			uniform = &shader->uniforms[shader->uniforms_count];
+			uniform->location = variable->location;
+			uniform->type = variable->type;
+			uniform->size = variable->size;
+			uniform->element_size = gfw_get_uniform_element_size(variable->type);
+			uniform->offset = storage_size;
+			uniform->locations_offset = locations_count;
+			storage_size = storage_size + uniform->size * uniform->element_size;
+			locations_count = locations_count + uniform->size;
+			shader->uniforms_count = shader->uniforms_count + 1;
+		}
+		i++;
+	}
+	shader->uniform_storage = calloc(storage_size + 1, 1);
+	shader->uniform_locations = malloc((locations_count + 1) * sizeof(*shader->uniform_locations));
+	if (!shader->uniform_storage || !shader->uniform_locations) {
+		goto error;
+	}
+	/* Array elements are not guaranteed consecutive locations, so each one is queried */
+	i = 0;
+	j = 0;
+	while (i < shader->variables_capacity) {
+		variable = &shader->variables[i];
+		if (variable->kind == GFW_SHADER_VARIABLE_UNIFORM && gfw_get_uniform_element_size(variable->type) > 0) {
+			uniform = &shader->uniforms[j];
+			element = 0;
+			while (element < uniform->size) {
+				if (element == 0) {
+					location = uniform->location;
+				} else {
+					snprintf(name, sizeof(name), "%s[%u]", variable->name, element);
+					location = glGetUniformLocation(shader->program_gl_id, name);
+				}
+				shader->uniform_locations[uniform->locations_offset + element] = location;
+				if (location >= 0 && (uint32_t)location + 1 > shader->uniform_slots_count) {
+					shader->uniform_slots_count = (uint32_t)location + 1;
+				}
+				element++;
+			}
+			j++;
+		}
+		i++;
+	}
+	shader->uniform_slots = malloc((shader->uniform_slots_count + 1) * sizeof(*shader->uniform_slots));
+	shader->uniform_slot_elements = malloc((shader->uniform_slots_count + 1) * sizeof(*shader->uniform_slot_elements));
+	if (!shader->uniform_slots || !shader->uniform_slot_elements) {
+		goto error;
+	}
+	i = 0;
+	while (i < shader->uniform_slots_count) {
+		shader->uniform_slots[i] = -1;
+		i++;
+	}
+	i = 0;
+	while (i < shader->uniforms_count) {
+		uniform = &shader->uniforms[i];
+		j = 0;
+		while (j < uniform->size) {
+			location = shader->uniform_locations[uniform->locations_offset + j];
+			/* Elements the driver did not report stay unshadowed */
+			if (location >= 0) {
+				shader->uniform_slots[location] = i;
+				shader->uniform_slot_elements[location] = j;
+				/* Initializers in the shader source are the starting values */
+				if (uniform->type == GL_FLOAT || uniform->type == GL_FLOAT_MAT3 || uniform->type == GL_FLOAT_MAT4) {
+					glGetUniformfv(shader->program_gl_id,
+						location,
+						(GLfloat *)(shader->uniform_storage + uniform->offset + j * uniform->element_size));
+				} else if (uniform->type == GL_UNSIGNED_INT) {
+					glGetUniformuiv(shader->program_gl_id,
+						location,
+						(GLuint *)(shader->uniform_storage + uniform->offset + j * uniform->element_size));
+				} else {
+					glGetUniformiv(shader->program_gl_id,
+						location,
+						(GLint *)(shader->uniform_storage + uniform->offset + j * uniform->element_size));
+				}
+			}
+			j++;
+		}
+		i++;
+	}
+	return;
+error:
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to disable depth clamp.\n");
-#endif
-#ifdef GFW_ABORT_ON_BACKEND_ERROR
-		abort();
+	printf("Warning: failed to allocate shader uniform storage.\n");
 #endif
+	gfw_free_uniform_shadow(shader);
+}
+
+void gfw_reset_uniform_statistics(void)
+{
+	gfw_uniform_statistics.skipped = 0;
+	gfw_uniform_statistics.deferred = 0;
+	gfw_uniform_statistics.issued = 0;
+}
+
+void gfw_get_uniform_statistics(struct gfw_uniform_statistics *statistics)
+{
+	*statistics = gfw_uniform_statistics;
+}
+
+void gfw_shader_flush_uniforms(struct gfw_shader *shader)
+{
+	bool in_use = gfw_current_shader == shader && gfw_program_in_use;
+	uint32_t i = 0;
+	/* Without program setters the values stay dirty until the program is used */
+	if (!in_use && !gfw_has_program_uniforms()) {
+		return;
 	}
-#endif
+	while (i < shader->dirty_uniforms_count) {
+		gfw_upload_uniform(shader, &shader->uniforms[shader->dirty_uniforms[i]], in_use);
+		i++;
+	}
+	shader->dirty_uniforms_count = 0;
 }
 
-void gfw_enable_depth_test(void)
+static void gfw_prepare_draw(void)
+{
+	gfw_flush_state();
+	if (gfw_current_shader && gfw_current_shader->dirty_uniforms_count > 0) {
+		gfw_shader_flush_uniforms(gfw_current_shader);
+	}
+}
+
+void gfw_shader_set_uniform_mat4(gfw_int_t location, bool normalize, gfw_float_t *matrix)
 {
-	glEnable(GL_DEPTH_TEST);
+	GFW_TRACE_CALL(GFW_TRACE_CALL_SHADER_SET_UNIFORM, matrix, 16 * sizeof(*matrix), GFW_TRACE_UINT(GL_FLOAT_MAT4), GFW_TRACE_INT(location), GFW_TRACE_UINT(1), GFW_TRACE_UINT(normalize));
+	if (gfw_shadow_uniform(location, GL_FLOAT_MAT4, matrix, 16 * sizeof(gfw_float_t), 1, normalize)) {
+		return;
+	}
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_UNIFORM_UPDATES, 1);
+	glUniformMatrix4fv(location, 1, normalize, matrix);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to enable depth test.\n");
+		printf("Error: failed to set 4x4 matrix uniform variable.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
@@ -1574,13 +2361,18 @@ void gfw_enable_depth_test(void)
 #endif
 }
 
-void gfw_disable_depth_test(void)
+void gfw_shader_set_uniform_mat3(gfw_int_t location, bool normalize, gfw_float_t *matrix)
 {
-	glDisable(GL_DEPTH_TEST);
+	GFW_TRACE_CALL(GFW_TRACE_CALL_SHADER_SET_UNIFORM, matrix, 9 * sizeof(*matrix), GFW_TRACE_UINT(GL_FLOAT_MAT3), GFW_TRACE_INT(location), GFW_TRACE_UINT(1), GFW_TRACE_UINT(normalize));
+	if (gfw_shadow_uniform(location, GL_FLOAT_MAT3, matrix, 9 * sizeof(gfw_float_t), 1, normalize)) {
+		return;
+	}
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_UNIFORM_UPDATES, 1);
+	glUniformMatrix3fv(location, 1, normalize, matrix);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to disable depth test.\n");
+		printf("Error: failed to set 3x3 matrix uniform variable.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
@@ -1589,13 +2381,18 @@ void gfw_disable_depth_test(void)
 #endif
 }
 
-void gfw_enable_dither(void)
+void gfw_shader_set_uniform_float(gfw_int_t location, gfw_float_t f)
 {
-	glEnable(GL_DITHER);
+	GFW_TRACE_CALL(GFW_TRACE_CALL_SHADER_SET_UNIFORM, &f, sizeof(f), GFW_TRACE_UINT(GL_FLOAT), GFW_TRACE_INT(location), GFW_TRACE_UINT(1), GFW_TRACE_UINT(false));
+	if (gfw_shadow_uniform(location, GL_FLOAT, &f, sizeof(f), 1, false)) {
+		return;
+	}
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_UNIFORM_UPDATES, 1);
+	glUniform1f(location, f);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to enable dither.\n");
+		printf("Error: failed to set floating-point uniform variable.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
@@ -1604,13 +2401,18 @@ void gfw_enable_dither(void)
 #endif
 }
 
-void gfw_disable_dither(void)
+void gfw_shader_set_uniform_floatv(gfw_int_t location, gfw_float_t *f, uint32_t count)
 {
-	glDisable(GL_DITHER);
+	GFW_TRACE_CALL(GFW_TRACE_CALL_SHADER_SET_UNIFORM, f, count * sizeof(*f), GFW_TRACE_UINT(GL_FLOAT), GFW_TRACE_INT(location), GFW_TRACE_UINT(count), GFW_TRACE_UINT(false));
+	if (gfw_shadow_uniform(location, GL_FLOAT, f, sizeof(*f), count, false)) {
+		return;
+	}
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_UNIFORM_UPDATES, 1);
+	glUniform1fv(location, count, f);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to enable dither.\n");
+		printf("Error: failed to set floating-point uniform array.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
@@ -1619,13 +2421,18 @@ void gfw_disable_dither(void)
 #endif
 }
 
-void gfw_enable_line_smooth(void)
+void gfw_shader_set_uniform_int(gfw_int_t location, gfw_int_t i)
 {
-	glEnable(GL_LINE_SMOOTH);
+	GFW_TRACE_CALL(GFW_TRACE_CALL_SHADER_SET_UNIFORM, &i, sizeof(i), GFW_TRACE_UINT(GL_INT), GFW_TRACE_INT(location), GFW_TRACE_UINT(1), GFW_TRACE_UINT(false));
+	if (gfw_shadow_uniform(location, GL_INT, &i, sizeof(i), 1, false)) {
+		return;
+	}
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_UNIFORM_UPDATES, 1);
+	glUniform1i(location, i);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to enable line smooth.\n");
+		printf("Error: failed to set integer uniform variable.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
@@ -1634,13 +2441,18 @@ void gfw_enable_line_smooth(void)
 #endif
 }
 
-void gfw_disable_line_smooth(void)
+void gfw_shader_set_uniform_intv(gfw_int_t location, gfw_int_t *i, uint32_t count)
 {
-	glDisable(GL_LINE_SMOOTH);
+	GFW_TRACE_CALL(GFW_TRACE_CALL_SHADER_SET_UNIFORM, i, count * sizeof(*i), GFW_TRACE_UINT(GL_INT), GFW_TRACE_INT(location), GFW_TRACE_UINT(count), GFW_TRACE_UINT(false));
+	if (gfw_shadow_uniform(location, GL_INT, i, sizeof(*i), count, false)) {
+		return;
+	}
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_UNIFORM_UPDATES, 1);
+	glUniform1iv(location, count, i);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to disable line smooth.\n");
+		printf("Error: failed to set integer uniform array.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
@@ -1649,13 +2461,18 @@ void gfw_disable_line_smooth(void)
 #endif
 }
 
-void gfw_set_blend_equation(enum gfw_blend_equation blend_equation_rgb, enum gfw_blend_equation blend_equation_alpha)
+void gfw_shader_set_uniform_uint(gfw_int_t location, gfw_uint_t i)
 {
-	glBlendEquationSeparate(blend_equation_rgb, blend_equation_alpha);
+	GFW_TRACE_CALL(GFW_TRACE_CALL_SHADER_SET_UNIFORM, &i, sizeof(i), GFW_TRACE_UINT(GL_UNSIGNED_INT), GFW_TRACE_INT(location), GFW_TRACE_UINT(1), GFW_TRACE_UINT(false));
+	if (gfw_shadow_uniform(location, GL_UNSIGNED_INT, &i, sizeof(i), 1, false)) {
+		return;
+	}
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_UNIFORM_UPDATES, 1);
+	glUniform1ui(location, i);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to set blend equation.\n");
+		printf("Error: failed to set unsigned integer uniform variable.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
@@ -1664,13 +2481,18 @@ void gfw_set_blend_equation(enum gfw_blend_equation blend_equation_rgb, enum gfw
 #endif
 }
 
-void gfw_set_blend_function(enum gfw_blend_factor blend_factor_source, enum gfw_blend_factor blend_factor_destination)
+void gfw_shader_set_uniform_uintv(gfw_int_t location, gfw_uint_t *i, uint32_t count)
 {
-	glBlendFunc(blend_factor_source, blend_factor_destination);
+	GFW_TRACE_CALL(GFW_TRACE_CALL_SHADER_SET_UNIFORM, i, count * sizeof(*i), GFW_TRACE_UINT(GL_UNSIGNED_INT), GFW_TRACE_INT(location), GFW_TRACE_UINT(count), GFW_TRACE_UINT(false));
+	if (gfw_shadow_uniform(location, GL_UNSIGNED_INT, i, sizeof(*i), count, false)) {
+		return;
+	}
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_UNIFORM_UPDATES, 1);
+	glUniform1uiv(location, count, i);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to set blend function.\n");
+		printf("Error: failed to set unsigned integer uniform array.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
@@ -1679,58 +2501,293 @@ void gfw_set_blend_function(enum gfw_blend_factor blend_factor_source, enum gfw_
 #endif
 }
 
-void gfw_set_blend_function_separate(enum gfw_blend_factor blend_factor_source_rgb, enum gfw_blend_factor blend_factor_destination_rgb, enum gfw_blend_factor blend_factor_source_alpha, enum gfw_blend_factor blend_factor_destination_alpha)
+uint32_t gfw_name_hash(const char *name)
+{
+	return gfw_hash(GFW_HASH_BASIS, name, strlen(name));
+}
+
+struct gfw_shader_variable *gfw_shader_find_variable(struct gfw_shader *shader, enum gfw_shader_variable_kind kind, uint32_t hash)
+{
+	struct gfw_shader_variable *variable = NULL;
+	uint32_t mask = shader->variables_capacity - 1;
+	uint32_t i = hash & mask;
+	if (!shader->variables) {
+		goto done;
+	}
+	while (shader->variables[i].kind != GFW_SHADER_VARIABLE_NONE) {
+		if (shader->variables[i].hash == hash && shader->variables[i].kind == kind) {
+			variable = &shader->variables[i];
+			break;
+		}
+		i = (i + 1) & mask;
+	}
+done:
+	return variable;
+}
+
+static struct gfw_shader_variable *gfw_shader_find_named_variable(struct gfw_shader *shader, enum gfw_shader_variable_kind kind, char *name)
+{
+	struct gfw_shader_variable *variable = NULL;
+	uint32_t hash = gfw_name_hash(name);
+	uint32_t mask = shader->variables_capacity - 1;
+	uint32_t i = hash & mask;
+	if (!shader->variables) {
+		goto done;
+	}
+	/* Different names can share a hash, so a hit is only taken once the name matches */
+	while (shader->variables[i].kind != GFW_SHADER_VARIABLE_NONE) {
+		if (shader->variables[i].hash == hash && shader->variables[i].kind == kind
+			&& strcmp(shader->variables[i].name, name) == 0) {
+			variable = &shader->variables[i];
+			break;
+		}
+		i = (i + 1) & mask;
+	}
+done:
+	return variable;
+}
+
+gfw_int_t gfw_shader_find_block_index(struct gfw_shader *shader, uint32_t hash)
+{
+	struct gfw_shader_variable *variable = gfw_shader_find_variable(shader, GFW_SHADER_VARIABLE_BLOCK, hash);
+	return variable ? variable->location : -1;
+}
+
+gfw_int_t gfw_shader_find_uniform_location(struct gfw_shader *shader, uint32_t hash)
+{
+	struct gfw_shader_variable *variable = gfw_shader_find_variable(shader, GFW_SHADER_VARIABLE_UNIFORM, hash);
+	return variable ? variable->location : -1;
+}
+
+gfw_int_t gfw_shader_find_attribute_location(struct gfw_shader *shader, uint32_t hash)
+{
+	struct gfw_shader_variable *variable = gfw_shader_find_variable(shader, GFW_SHADER_VARIABLE_ATTRIBUTE, hash);
+	return variable ? variable->location : -1;
+}
+
+static void gfw_insert_shader_variable(struct gfw_shader *shader, struct gfw_shader_variable variable)
+{
+	uint32_t mask = shader->variables_capacity - 1;
+	uint32_t i = variable.hash & mask;
+	while (shader->variables[i].kind != GFW_SHADER_VARIABLE_NONE) {
+		/* Colliding names are probed past and only exact duplicates are dropped */
+		if (shader->variables[i].hash == variable.hash && shader->variables[i].kind == variable.kind
+			&& strcmp(shader->variables[i].name, variable.name) == 0) {
+			return;
+		}
+		i = (i + 1) & mask;
+	}
+	shader->variables[i] = variable;
+	shader->variables_count = shader->variables_count + 1;
+}
+
+static void gfw_name_shader_variable(struct gfw_shader *shader, struct gfw_shader_variable *variable, char *name, GLsizei length, size_t *names_offset)
+{
+	/* Arrays are reported as name[0] and are looked up without the subscript */
+	if (length > 3 && strcmp(name + length - 3, "[0]") == 0) {
+		length = length - 3;
+	}
+	variable->hash = gfw_hash(GFW_HASH_BASIS, name, length);
+	variable->name = shader->variable_names + *names_offset;
+	memcpy(variable->name, name, length);
+	variable->name[length] = '\0';
+	*names_offset = *names_offset + length + 1;
+}
+
+static size_t gfw_shader_names_size(GLint count, GLint length)
+{
+	/* Reported lengths include the terminator and names are truncated to the query buffer */
+	if (length <= 0 || length > GFW_SHADER_NAME_MAX_LENGTH) {
+		length = GFW_SHADER_NAME_MAX_LENGTH;
+	}
+	return (size_t)count * (size_t)length;
+}
+
+static void gfw_free_shader_variables(struct gfw_shader *shader)
+{
+	free(shader->variables);
+	free(shader->variable_names);
+	shader->variables = NULL;
+	shader->variable_names = NULL;
+	shader->variables_capacity = 0;
+	shader->variables_count = 0;
+}
+
+static void gfw_reflect_shader(struct gfw_shader *shader)
 {
-	glBlendFuncSeparate(blend_factor_source_rgb, blend_factor_destination_rgb, blend_factor_source_alpha, blend_factor_destination_alpha);
+	GLint uniforms_count = 0;
+	GLint attributes_count = 0;
+	GLint blocks_count = 0;
+	GLint i = 0;
+	GLint uniform_name_length = 0;
+	GLint attribute_name_length = 0;
+	GLint block_name_length = 0;
+	GLsizei length = 0;
+	size_t names_offset = 0;
+	char name[GFW_SHADER_NAME_MAX_LENGTH] = {0};
+	struct gfw_shader_variable variable = {0};
+	gfw_free_shader_variables(shader);
+	shader->variables_capacity = 8;
+	glGetProgramiv(shader->program_gl_id, GL_ACTIVE_UNIFORMS, &uniforms_count);
+	glGetProgramiv(shader->program_gl_id, GL_ACTIVE_ATTRIBUTES, &attributes_count);
+	glGetProgramiv(shader->program_gl_id, GL_ACTIVE_UNIFORM_BLOCKS, &blocks_count);
+	glGetProgramiv(shader->program_gl_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &uniform_name_length);
+	glGetProgramiv(shader->program_gl_id, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &attribute_name_length);
+	glGetProgramiv(shader->program_gl_id, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &block_name_length);
+	/* The table is kept at most half full */
+	while (shader->variables_capacity < 2 * (uint32_t)(uniforms_count + attributes_count + blocks_count)) {
+		shader->variables_capacity = shader->variables_capacity * 2;
+	}
+	shader->variables = calloc(shader->variables_capacity, sizeof(*shader->variables));
+	shader->variable_names = malloc(gfw_shader_names_size(uniforms_count, uniform_name_length)
+		+ gfw_shader_names_size(attributes_count, attribute_name_length)
+		+ gfw_shader_names_size(blocks_count, block_name_length) + 1);
+	if (!shader->variables || !shader->variable_names) {
+		gfw_free_shader_variables(shader);
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Warning: failed to allocate shader variables.\n");
+#endif
+		return;
+	}
+	i = 0;
+	while (i < uniforms_count) {
+		glGetActiveUniform(shader->program_gl_id, i, sizeof(name), &length, &variable.size, &variable.type, name);
+		variable.location = glGetUniformLocation(shader->program_gl_id, name);
+		/* Members of uniform blocks have no location */
+		if (variable.location >= 0) {
+			variable.kind = GFW_SHADER_VARIABLE_UNIFORM;
+			gfw_name_shader_variable(shader, &variable, name, length, &names_offset);
+			gfw_insert_shader_variable(shader, variable);
+		}
+		i++;
+	}
+	i = 0;
+	while (i < attributes_count) {
+		glGetActiveAttrib(shader->program_gl_id, i, sizeof(name), &length, &variable.size, &variable.type, name);
+		variable.location = glGetAttribLocation(shader->program_gl_id, name);
+		/* Built-in inputs have no location */
+		if (variable.location >= 0) {
+			variable.kind = GFW_SHADER_VARIABLE_ATTRIBUTE;
+			gfw_name_shader_variable(shader, &variable, name, length, &names_offset);
+			gfw_insert_shader_variable(shader, variable);
+		}
+		i++;
+	}
+	i = 0;
+	while (i < blocks_count) {
+		glGetActiveUniformBlockName(shader->program_gl_id, i, sizeof(name), &length, name);
+		glGetActiveUniformBlockiv(shader->program_gl_id, i, GL_UNIFORM_BLOCK_DATA_SIZE, &variable.size);
+		variable.kind = GFW_SHADER_VARIABLE_BLOCK;
+		gfw_name_shader_variable(shader, &variable, name, length, &names_offset);
+		variable.location = i;
+		variable.type = 0;
+		gfw_insert_shader_variable(shader, variable);
+		i++;
+	}
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to set blend functions.\n");
+		printf("Error: failed to reflect shader program.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
 #endif
 	}
 #endif
+	gfw_build_uniform_shadow(shader);
 }
 
-void gfw_set_blend_color(gfw_float_t r, gfw_float_t g, gfw_float_t b, gfw_float_t a)
+gfw_int_t gfw_shader_get_uniform_location(struct gfw_shader *shader, char *name)
 {
-	glBlendColor(r, g, b, a);
+	gfw_int_t location = 0;
+	struct gfw_shader_variable *variable = gfw_shader_find_named_variable(shader, GFW_SHADER_VARIABLE_UNIFORM, name);
+	if (variable) {
+		return variable->location;
+	}
+	/* Array elements and inactive names are left to the driver */
+	location = glGetUniformLocation(shader->program_gl_id, name);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to set blending color.\n");
+		printf("Error: failed to get uniform location.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
 #endif
 	}
 #endif
+	return location;
 }
 
-void gfw_set_color_logic_operation(enum gfw_color_logic_operation color_logic_operation)
+gfw_int_t gfw_shader_get_attribute_location(struct gfw_shader *shader, char *name)
 {
-	glLogicOp(color_logic_operation);
+	gfw_int_t location = 0;
+	struct gfw_shader_variable *variable = gfw_shader_find_named_variable(shader, GFW_SHADER_VARIABLE_ATTRIBUTE, name);
+	if (variable) {
+		return variable->location;
+	}
+	location = glGetAttribLocation(shader->program_gl_id, name);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to set color logic operation.\n");
+		printf("Error: failed to get shader attribute location.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
 #endif
 	}
 #endif
+	return location;
 }
 
-void gfw_set_cull_face_mode(enum gfw_cull_face_mode cull_face_mode)
+void gfw_shader_draw_range(struct gfw_attribute *attributes,
+	size_t attributes_count,
+	enum gfw_primitive primitive,
+	size_t first,
+	size_t count)
+{
+	uint32_t i = 0;
+	gfw_prepare_draw();
+	if (gfw_bound_vertex_state) {
+		gfw_vertex_state_forget_layouts(gfw_bound_vertex_state);
+	}
+	GFW_TRACE_CALL(GFW_TRACE_CALL_SHADER_DRAW_RANGE, attributes, attributes_count * sizeof(*attributes), GFW_TRACE_UINT(primitive), GFW_TRACE_UINT(first), GFW_TRACE_UINT(count), GFW_TRACE_UINT(attributes_count));
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_DRAWS, 1);
+	while (i < attributes_count) {
+		glEnableVertexAttribArray(attributes[i].location);
+		glVertexAttribPointer(attributes[i].location,
+			attributes[i].count,
+			attributes[i].type,
+			attributes[i].normalize,
+			attributes[i].stride,
+			(GLvoid *)attributes[i].offset);
+		if (attributes[i].divisor > 0) {
+			glVertexAttribDivisor(attributes[i].location, attributes[i].divisor);
+		}
+		i++;
+	}
+	glDrawArrays(primitive, first, count);
+	i = 0;
+	while (i < attributes_count) {
+		if (attributes[i].divisor > 0) {
+			glVertexAttribDivisor(attributes[i].location, 0);
+		}
+		glDisableVertexAttribArray(attributes[i].location);
+		i++;
+	}
+}
+
+void gfw_shader_use(struct gfw_shader *shader)
 {
-	glCullFace(cull_face_mode);
+	GFW_TRACE_CALL(GFW_TRACE_CALL_SHADER_USE, NULL, 0, GFW_TRACE_UINT(shader->program_gl_id));
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_BINDS, 1);
+	gfw_current_shader = shader;
+	gfw_program_in_use = true;
+	glUseProgram(shader->program_gl_id);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to set cull face mode.\n");
+		printf("Error: failed to use shader.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
@@ -1739,28 +2796,56 @@ void gfw_set_cull_face_mode(enum gfw_cull_face_mode cull_face_mode)
 #endif
 }
 
-void gfw_set_front_face(enum gfw_cull_face_front front_face)
+void gfw_free_shader(struct gfw_shader *shader)
 {
-	glFrontFace(front_face);
+	GFW_TRACE_CALL(GFW_TRACE_CALL_FREE_SHADER, NULL, 0, GFW_TRACE_UINT(shader->program_gl_id));
+#ifdef GFW_DEFERRED_DELETION
+	/* Stages below are only flagged for deletion while the program is alive */
+	gfw_defer_deletion(GFW_DELETION_PROGRAM, shader->program_gl_id);
+#else
+	glDeleteProgram(shader->program_gl_id);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to set face culling front face.\n");
+		printf("Error: failed to delete shader program.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
 #endif
 	}
 #endif
+#endif
+	shader->program_gl_id = 0;
+	/* Stages are still attached while an asynchronous link is pending */
+	if (shader->vertex_shader_gl_id) {
+		glDeleteShader(shader->vertex_shader_gl_id);
+	}
+	if (shader->geometry_shader_gl_id) {
+		glDeleteShader(shader->geometry_shader_gl_id);
+	}
+	if (shader->fragment_shader_gl_id) {
+		glDeleteShader(shader->fragment_shader_gl_id);
+	}
+	shader->vertex_shader_gl_id = 0;
+	shader->geometry_shader_gl_id = 0;
+	shader->fragment_shader_gl_id = 0;
+	shader->program_hash = 0;
+	shader->status = GFW_SHADER_STATUS_FAILED;
+	gfw_free_shader_variables(shader);
+	gfw_free_uniform_shadow(shader);
+	if (gfw_current_shader == shader) {
+		gfw_current_shader = NULL;
+	}
+	gfw_update_handle(GFW_HANDLE_TYPE_SHADER, shader, 0, 0);
 }
 
-void gfw_set_depth_test_function(enum gfw_depth_test_function depth_test_function)
+static void gfw_detach_shader(GLuint program_gl_id, GLuint shader_gl_id)
 {
-	glDepthFunc(depth_test_function);
+	glDetachShader(program_gl_id, shader_gl_id);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to set depth function.\n");
+		printf("Error: failed to detach shader.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
@@ -1769,13 +2854,13 @@ void gfw_set_depth_test_function(enum gfw_depth_test_function depth_test_functio
 #endif
 }
 
-void gfw_set_depth_range(gfw_float_t near, gfw_float_t far)
+static void gfw_delete_shader(GLuint shader_gl_id)
 {
-	glDepthRange(near, far);
+	glDeleteShader(shader_gl_id);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to set depth range.\n");
+		printf("Error: failed to delete shader.\n");
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
@@ -1784,32 +2869,5611 @@ void gfw_set_depth_range(gfw_float_t near, gfw_float_t far)
 #endif
 }
 
-void gfw_set_point_size(gfw_float_t size)
+static bool gfw_compile_shader(GLuint *shader_gl_id, GLenum shader_type, char *source)
 {
-	glPointSize(size);
+	bool success = true;
+	GLint param = 0;
+	char log_string[GFW_SHADER_LOG_MAX_LENGTH] = {0};
+	*shader_gl_id = glCreateShader(shader_type);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
+		success = false;
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to set point size.\n");
+		if (shader_type == GL_VERTEX_SHADER) {
+			printf("Error: failed to create vertex shader.\n");
+		} else if (shader_type == GL_FRAGMENT_SHADER) {
+			printf("Error: failed to create fragment shader.\n");
+		} else if (shader_type == GL_GEOMETRY_SHADER) {
+			printf("Error: failed to create geometry shader.\n");
+		} else if (shader_type == GL_COMPUTE_SHADER) {
+			printf("Error: failed to create compute shader.\n");
+		}
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
+#else
+		goto done;
 #endif
 	}
 #endif
-}
-
-void gfw_set_line_width(gfw_float_t width)
-{
-	glLineWidth(width);
+	glShaderSource(*shader_gl_id, 1, (const char **)&source, NULL);
 #ifdef GFW_CHECK_BACKEND_ERROR
 	if (glGetError() != GL_NO_ERROR) {
+		success = false;
 #ifdef GFW_PRINT_BACKEND_ERROR
-		printf("Error: failed to set line width.\n");
+		if (shader_type == GL_VERTEX_SHADER) {
+			printf("Error: failed to set vertex shader source.\n");
+		} else if (shader_type == GL_FRAGMENT_SHADER) {
+			printf("Error: failed to set fragment shader source.\n");
+		} else if (shader_type == GL_GEOMETRY_SHADER) {
+			printf("Error: failed to set geometry shader source.\n");
+		} else if (shader_type == GL_COMPUTE_SHADER) {
+			printf("Error: failed to set compute shader source.\n");
+		}
 #endif
 #ifdef GFW_ABORT_ON_BACKEND_ERROR
 		abort();
-#endif
+#else
+		goto done;
+#endif
+	}
+#endif
+	glCompileShader(*shader_gl_id);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		if (shader_type == GL_VERTEX_SHADER) {
+			printf("Error: failed to compile vertex shader.\n");
+		} else if (shader_type == GL_FRAGMENT_SHADER) {
+			printf("Error: failed to compile fragment shader.\n");
+		} else if (shader_type == GL_GEOMETRY_SHADER) {
+			printf("Error: failed to compile geometry shader.\n");
+		} else if (shader_type == GL_COMPUTE_SHADER) {
+			printf("Error: failed to compile compute shader.\n");
+		}
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#else
+		goto done;
+#endif
+	}
+#endif
+	glGetShaderiv(*shader_gl_id, GL_COMPILE_STATUS, &param);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		if (shader_type == GL_VERTEX_SHADER) {
+			printf("Error: failed to get vertex shader status.\n");
+		} else if (shader_type == GL_FRAGMENT_SHADER) {
+			printf("Error: failed to get fragment shader status.\n");
+		} else if (shader_type == GL_GEOMETRY_SHADER) {
+			printf("Error: failed to get geometry shader status.\n");
+		} else if (shader_type == GL_COMPUTE_SHADER) {
+			printf("Error: failed to get compute shader status.\n");
+		}
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#else
+		goto done;
+#endif
+	}
+#endif
+	if (!param) {
+		GLsizei length;
+		glGetShaderInfoLog(*shader_gl_id,
+			GFW_SHADER_LOG_MAX_LENGTH,
+			&length,
+			log_string);
+#ifdef GFW_CHECK_BACKEND_ERROR
+		if (glGetError() != GL_NO_ERROR) {
+			success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+			if (shader_type == GL_VERTEX_SHADER) {
+				printf("Error: failed to get vertex shader info log.\n");
+			} else if (shader_type == GL_FRAGMENT_SHADER) {
+				printf("Error: failed to get fragment shader info log.\n");
+			} else if (shader_type == GL_GEOMETRY_SHADER) {
+				printf("Error: failed to get geometry shader info log.\n");
+			} else if (shader_type == GL_COMPUTE_SHADER) {
+				printf("Error: failed to get compute shader info log.\n");
+			}
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+			abort();
+#else
+			goto done;
+#endif
+		}
+#endif
+#ifdef GFW_PRINT_BACKEND_ERROR
+		if (shader_type == GL_VERTEX_SHADER) {
+			printf("Vertex shader error:\n %s", log_string);
+		} else if (shader_type == GL_FRAGMENT_SHADER) {
+			printf("Fragment shader error:\n %s", log_string);
+		} else if (shader_type == GL_GEOMETRY_SHADER) {
+			printf("Geometry shader error:\n %s", log_string);
+		} else if (shader_type == GL_COMPUTE_SHADER) {
+			printf("Compute shader error:\n %s", log_string);
+		}
+#endif
+		success = false;
+		goto done;
+	}
+done:
+	return success;
+}
+
+/* Program cache */
+struct gfw_program_cache_header {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t source_hash;
+	char vendor[GFW_PROGRAM_CACHE_DRIVER_MAX_LENGTH];
+	char renderer[GFW_PROGRAM_CACHE_DRIVER_MAX_LENGTH];
+	char driver_version[GFW_PROGRAM_CACHE_DRIVER_MAX_LENGTH];
+	uint32_t binary_format;
+	uint32_t length;
+};
+
+/* Room is left in cache paths for the hash file name */
+static char gfw_program_cache_directory[GFW_PROGRAM_CACHE_PATH_MAX_LENGTH - 32] = {0};
+static struct gfw_program_cache_statistics gfw_program_cache_statistics = {0};
+
+static uint64_t gfw_hash_program_string(uint64_t hash, const char *string)
+{
+	/* The terminator is hashed so that moving text between stages changes the hash */
+	if (string) {
+		hash = gfw_hash64(hash, string, strlen(string) + 1);
+	} else {
+		hash = gfw_hash64(hash, "", 1);
+	}
+	return hash;
+}
+
+static uint64_t gfw_hash_program_sources(char *vertex_source, char *geometry_source, char *fragment_source)
+{
+	uint64_t hash = GFW_HASH64_BASIS;
+	hash = gfw_hash_program_string(hash, vertex_source);
+	hash = gfw_hash_program_string(hash, geometry_source);
+	hash = gfw_hash_program_string(hash, fragment_source);
+	return hash;
+}
+
+/* The file name also depends on the driver, so an update never finds old binaries */
+static uint64_t gfw_hash_program(uint64_t source_hash)
+{
+	uint64_t hash = source_hash;
+	hash = gfw_hash_program_string(hash, (const char *)glGetString(GL_VENDOR));
+	hash = gfw_hash_program_string(hash, (const char *)glGetString(GL_RENDERER));
+	hash = gfw_hash_program_string(hash, (const char *)glGetString(GL_VERSION));
+	return hash;
+}
+
+static void gfw_copy_program_cache_string(char *destination, const GLubyte *string)
+{
+	memset(destination, 0, GFW_PROGRAM_CACHE_DRIVER_MAX_LENGTH);
+	if (string) {
+		strncpy(destination, (const char *)string, GFW_PROGRAM_CACHE_DRIVER_MAX_LENGTH - 1);
+	}
+}
+
+/* The header repeats the source hash and driver strings, so a file name collision is still rejected */
+static void gfw_init_program_cache_header(struct gfw_program_cache_header *header, uint64_t source_hash)
+{
+	memset(header, 0, sizeof(*header));
+	header->magic = GFW_PROGRAM_CACHE_MAGIC;
+	header->version = GFW_PROGRAM_CACHE_VERSION;
+	header->source_hash = source_hash;
+	gfw_copy_program_cache_string(header->vendor, glGetString(GL_VENDOR));
+	gfw_copy_program_cache_string(header->renderer, glGetString(GL_RENDERER));
+	gfw_copy_program_cache_string(header->driver_version, glGetString(GL_VERSION));
+}
+
+static void gfw_get_program_cache_path(char *path, uint64_t hash, char *extension)
+{
+	snprintf(path,
+		GFW_PROGRAM_CACHE_PATH_MAX_LENGTH,
+		"%s/%016llx.%s",
+		gfw_program_cache_directory,
+		(unsigned long long)hash,
+		extension);
+}
+
+static bool gfw_load_program_binary(struct gfw_shader *shader, uint64_t source_hash)
+{
+	bool success = false;
+	char path[GFW_PROGRAM_CACHE_PATH_MAX_LENGTH] = {0};
+	struct gfw_program_cache_header expected_header = {0};
+	struct gfw_program_cache_header header = {0};
+	uint8_t *binary = NULL;
+	GLint param = 0;
+	FILE *file = NULL;
+	gfw_get_program_cache_path(path, gfw_hash_program(source_hash), "bin");
+	file = fopen(path, "rb");
+	if (!file) {
+		goto done;
+	}
+	gfw_init_program_cache_header(&expected_header, source_hash);
+	if (fread(&header, sizeof(header), 1, file) != 1
+		|| header.magic != expected_header.magic
+		|| header.version != expected_header.version
+		|| header.source_hash != expected_header.source_hash
+		|| memcmp(header.vendor, expected_header.vendor, sizeof(header.vendor)) != 0
+		|| memcmp(header.renderer, expected_header.renderer, sizeof(header.renderer)) != 0
+		|| memcmp(header.driver_version, expected_header.driver_version, sizeof(header.driver_version)) != 0) {
+		goto done;
+	}
+	binary = malloc(header.length);
+	if (!binary || fread(binary, header.length, 1, file) != 1) {
+		goto done;
+	}
+	shader->program_gl_id = glCreateProgram();
+	glProgramBinary(shader->program_gl_id, header.binary_format, binary, header.length);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Warning: failed to load program binary.\n");
+#endif
+	}
+#endif
+	/* A driver update can reject the binary, which is reported as a link failure */
+	glGetProgramiv(shader->program_gl_id, GL_LINK_STATUS, &param);
+	if (!param) {
+		glDeleteProgram(shader->program_gl_id);
+		shader->program_gl_id = 0;
+		goto done;
+	}
+	success = true;
+done:
+	if (file) {
+		fclose(file);
+	}
+	free(binary);
+	return success;
+}
+
+static void gfw_store_program_binary(struct gfw_shader *shader, uint64_t source_hash)
+{
+	char path[GFW_PROGRAM_CACHE_PATH_MAX_LENGTH] = {0};
+	char temporary_path[GFW_PROGRAM_CACHE_PATH_MAX_LENGTH] = {0};
+	struct gfw_program_cache_header header = {0};
+	uint8_t *binary = NULL;
+	uint64_t hash = 0;
+	GLint length = 0;
+	GLenum binary_format = 0;
+	FILE *file = NULL;
+	glGetProgramiv(shader->program_gl_id, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) {
+		goto done;
+	}
+	binary = malloc(length);
+	if (!binary) {
+		goto done;
+	}
+	glGetProgramBinary(shader->program_gl_id, length, &length, &binary_format, binary);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Warning: failed to get program binary.\n");
+#endif
+		goto done;
+	}
+#endif
+	if (length <= 0) {
+		goto done;
+	}
+	gfw_init_program_cache_header(&header, source_hash);
+	header.binary_format = binary_format;
+	header.length = length;
+	/* Written under a temporary name so that readers never see a partial file */
+	hash = gfw_hash_program(source_hash);
+	gfw_get_program_cache_path(path, hash, "bin");
+	gfw_get_program_cache_path(temporary_path, hash, "tmp");
+	file = fopen(temporary_path, "wb");
+	if (!file) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Warning: failed to open program cache file for writing.\n");
+#endif
+		goto done;
+	}
+	if (fwrite(&header, sizeof(header), 1, file) != 1 || fwrite(binary, length, 1, file) != 1) {
+		fclose(file);
+		file = NULL;
+		remove(temporary_path);
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Warning: failed to write program cache file.\n");
+#endif
+		goto done;
+	}
+	fclose(file);
+	file = NULL;
+	if (rename(temporary_path, path) != 0) {
+		remove(temporary_path);
+		goto done;
+	}
+	gfw_program_cache_statistics.stores = gfw_program_cache_statistics.stores + 1;
+done:
+	free(binary);
+}
+
+void gfw_get_program_cache_statistics(struct gfw_program_cache_statistics *statistics)
+{
+	*statistics = gfw_program_cache_statistics;
+}
+
+bool gfw_set_program_cache_directory(char *directory)
+{
+	bool success = true;
+	if (!directory) {
+		gfw_program_cache_directory[0] = 0;
+		goto done;
+	}
+	if (strlen(directory) >= sizeof(gfw_program_cache_directory)) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to set program cache directory with path too long.\n");
+#endif
+		goto done;
+	}
+	strcpy(gfw_program_cache_directory, directory);
+done:
+	return success;
+}
+
+/* Asynchronous shader */
+static bool gfw_has_extension(const char *name)
+{
+	GLint extensions_count = 0;
+	GLint i = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extensions_count);
+	while (i < extensions_count) {
+		const char *extension = (const char *)glGetStringi(GL_EXTENSIONS, i);
+		if (extension && strcmp(extension, name) == 0) {
+			return true;
+		}
+		i++;
+	}
+	return false;
+}
+
+static bool gfw_has_parallel_shader_compile(void)
+{
+	static int has_extension = -1;
+	if (has_extension < 0) {
+		has_extension = gfw_has_extension("GL_KHR_parallel_shader_compile") ? 1 : 0;
+#ifdef GL_KHR_parallel_shader_compile
+		/* Let the driver compile on as many threads as it has */
+		if (has_extension) {
+			glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+#ifdef GFW_CHECK_BACKEND_ERROR
+			if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+				printf("Error: failed to set maximum shader compiler threads.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+				abort();
+#endif
+			}
+#endif
+		}
+#endif
+	}
+	return has_extension == 1;
+}
+
+static bool gfw_has_program_uniforms(void)
+{
+	static int has_program_uniforms = -1;
+	GLint major_version = 0;
+	GLint minor_version = 0;
+	if (has_program_uniforms < 0) {
+		glGetIntegerv(GL_MAJOR_VERSION, &major_version);
+		glGetIntegerv(GL_MINOR_VERSION, &minor_version);
+		has_program_uniforms = major_version * 10 + minor_version >= 41 || gfw_has_extension("GL_ARB_separate_shader_objects") ? 1 : 0;
+	}
+	return has_program_uniforms == 1;
+}
+
+static GLuint gfw_submit_shader_stage(GLenum shader_type, char *source)
+{
+	GLuint shader_gl_id = glCreateShader(shader_type);
+	glShaderSource(shader_gl_id, 1, (const char **)&source, NULL);
+	glCompileShader(shader_gl_id);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to submit shader stage.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+		glDeleteShader(shader_gl_id);
+		shader_gl_id = 0;
+	}
+#endif
+	return shader_gl_id;
+}
+
+static void gfw_print_shader_stage_log(GLuint shader_gl_id, char *name)
+{
+	GLint param = 0;
+	char log_string[GFW_SHADER_LOG_MAX_LENGTH] = {0};
+	GLsizei length = 0;
+	if (!shader_gl_id) {
+		return;
+	}
+	glGetShaderiv(shader_gl_id, GL_COMPILE_STATUS, &param);
+	if (!param) {
+		glGetShaderInfoLog(shader_gl_id, GFW_SHADER_LOG_MAX_LENGTH, &length, log_string);
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("%s shader error:\n %s", name, log_string);
+#else
+		(void)name;
+#endif
+	}
+}
+
+static void gfw_release_shader_stages(struct gfw_shader *shader)
+{
+	/* Stages are detached only once the program exists, a submit may fail before */
+	if (shader->vertex_shader_gl_id) {
+		if (shader->program_gl_id) {
+			glDetachShader(shader->program_gl_id, shader->vertex_shader_gl_id);
+		}
+		glDeleteShader(shader->vertex_shader_gl_id);
+	}
+	if (shader->geometry_shader_gl_id) {
+		if (shader->program_gl_id) {
+			glDetachShader(shader->program_gl_id, shader->geometry_shader_gl_id);
+		}
+		glDeleteShader(shader->geometry_shader_gl_id);
+	}
+	if (shader->fragment_shader_gl_id) {
+		if (shader->program_gl_id) {
+			glDetachShader(shader->program_gl_id, shader->fragment_shader_gl_id);
+		}
+		glDeleteShader(shader->fragment_shader_gl_id);
+	}
+	shader->vertex_shader_gl_id = 0;
+	shader->geometry_shader_gl_id = 0;
+	shader->fragment_shader_gl_id = 0;
+}
+
+static enum gfw_shader_status gfw_resolve_shader(struct gfw_shader *shader, bool wait)
+{
+	GLint param = 0;
+	char log_string[GFW_SHADER_LOG_MAX_LENGTH] = {0};
+	GLsizei length = 0;
+	if (shader->status != GFW_SHADER_STATUS_PENDING) {
+		goto done;
+	}
+	/* Without the extension, querying the link status waits for the driver */
+	if (!wait && gfw_has_parallel_shader_compile()) {
+		glGetProgramiv(shader->program_gl_id, GL_COMPLETION_STATUS_KHR, &param);
+		if (!param) {
+			goto done;
+		}
+	}
+	glGetProgramiv(shader->program_gl_id, GL_LINK_STATUS, &param);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+		param = 0;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to get shader program status.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+	if (!param) {
+		/* Logs are only fetched for programs that failed */
+		gfw_print_shader_stage_log(shader->vertex_shader_gl_id, "Vertex");
+		gfw_print_shader_stage_log(shader->geometry_shader_gl_id, "Geometry");
+		gfw_print_shader_stage_log(shader->fragment_shader_gl_id, "Fragment");
+		glGetProgramInfoLog(shader->program_gl_id, GFW_SHADER_LOG_MAX_LENGTH, &length, log_string);
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Program shader error:\n %s", log_string);
+#endif
+		gfw_release_shader_stages(shader);
+		glDeleteProgram(shader->program_gl_id);
+		shader->program_gl_id = 0;
+		shader->status = GFW_SHADER_STATUS_FAILED;
+		goto done;
+	}
+	gfw_release_shader_stages(shader);
+	if (gfw_program_cache_directory[0]) {
+		gfw_store_program_binary(shader, shader->program_hash);
+	}
+	gfw_reflect_shader(shader);
+	shader->status = GFW_SHADER_STATUS_READY;
+done:
+	gfw_update_handle(GFW_HANDLE_TYPE_SHADER, shader, shader->program_gl_id, 0);
+	return shader->status;
+}
+
+enum gfw_shader_status gfw_shader_poll(struct gfw_shader *shader)
+{
+	return gfw_resolve_shader(shader, false);
+}
+
+bool gfw_init_shader_async(struct gfw_shader *shader, char *vertex_source, char *geometry_source, char *fragment_source)
+{
+	bool success = true;
+	shader->program_gl_id = 0;
+	shader->vertex_shader_gl_id = 0;
+	shader->geometry_shader_gl_id = 0;
+	shader->fragment_shader_gl_id = 0;
+	shader->program_hash = 0;
+	shader->status = GFW_SHADER_STATUS_PENDING;
+	shader->variables = NULL;
+	shader->variable_names = NULL;
+	shader->variables_capacity = 0;
+	shader->variables_count = 0;
+	gfw_reset_uniform_shadow(shader);
+	if (gfw_program_cache_directory[0]) {
+		shader->program_hash = gfw_hash_program_sources(vertex_source, geometry_source, fragment_source);
+		if (gfw_load_program_binary(shader, shader->program_hash)) {
+			gfw_program_cache_statistics.hits = gfw_program_cache_statistics.hits + 1;
+			shader->status = GFW_SHADER_STATUS_READY;
+			gfw_reflect_shader(shader);
+			goto done;
+		}
+		gfw_program_cache_statistics.misses = gfw_program_cache_statistics.misses + 1;
+	}
+	/* Detecting the extension first also raises the compiler thread count */
+	gfw_has_parallel_shader_compile();
+	/* Compile and link without querying any status, so the driver can work in the background */
+	shader->vertex_shader_gl_id = gfw_submit_shader_stage(GL_VERTEX_SHADER, vertex_source);
+	if (geometry_source) {
+		shader->geometry_shader_gl_id = gfw_submit_shader_stage(GL_GEOMETRY_SHADER, geometry_source);
+	}
+	shader->fragment_shader_gl_id = gfw_submit_shader_stage(GL_FRAGMENT_SHADER, fragment_source);
+	if (!shader->vertex_shader_gl_id || (geometry_source && !shader->geometry_shader_gl_id) || !shader->fragment_shader_gl_id) {
+		success = false;
+		goto done;
+	}
+	shader->program_gl_id = glCreateProgram();
+	if (gfw_program_cache_directory[0]) {
+		glProgramParameteri(shader->program_gl_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	glAttachShader(shader->program_gl_id, shader->vertex_shader_gl_id);
+	if (geometry_source) {
+		glAttachShader(shader->program_gl_id, shader->geometry_shader_gl_id);
+	}
+	glAttachShader(shader->program_gl_id, shader->fragment_shader_gl_id);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to attach shader stages.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#else
+		goto done;
+#endif
+	}
+#endif
+	glLinkProgram(shader->program_gl_id);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to submit shader program.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#else
+		goto done;
+#endif
+	}
+#endif
+done:
+	if (!success) {
+		gfw_release_shader_stages(shader);
+		if (shader->program_gl_id) {
+			glDeleteProgram(shader->program_gl_id);
+		}
+		shader->program_gl_id = 0;
+		shader->status = GFW_SHADER_STATUS_FAILED;
+	}
+	gfw_update_handle(GFW_HANDLE_TYPE_SHADER, shader, shader->program_gl_id, 0);
+	return success;
+}
+
+bool gfw_init_shader_with_feedback(struct gfw_shader *shader,
+	char *vertex_source,
+	char *geometry_source,
+	char *fragment_source,
+	char **varyings,
+	size_t varyings_count,
+	bool interleaved)
+{
+	bool success = true;
+	GLuint vertex_shader_gl_id = 0;
+	GLuint geometry_shader_gl_id = 0;
+	GLuint fragment_shader_gl_id = 0;
+	GLint param = 0;
+	uint64_t hash = 0;
+	size_t i = 0;
+	char log_string[GFW_SHADER_LOG_MAX_LENGTH] = {0};
+	shader->vertex_shader_gl_id = 0;
+	shader->geometry_shader_gl_id = 0;
+	shader->fragment_shader_gl_id = 0;
+	shader->program_hash = 0;
+	shader->status = GFW_SHADER_STATUS_FAILED;
+	shader->variables = NULL;
+	shader->variable_names = NULL;
+	shader->variables_capacity = 0;
+	shader->variables_count = 0;
+	gfw_reset_uniform_shadow(shader);
+	if (gfw_program_cache_directory[0]) {
+		hash = gfw_hash_program_sources(vertex_source, geometry_source, fragment_source);
+		/* Programs without varyings keep the hash of the asynchronous path */
+		while (i < varyings_count) {
+			hash = gfw_hash_program_string(hash, varyings[i]);
+			i++;
+		}
+		if (varyings_count > 0) {
+			hash = gfw_hash64(hash, &interleaved, sizeof(interleaved));
+		}
+		if (gfw_load_program_binary(shader, hash)) {
+			gfw_program_cache_statistics.hits = gfw_program_cache_statistics.hits + 1;
+			goto done;
+		}
+		gfw_program_cache_statistics.misses = gfw_program_cache_statistics.misses + 1;
+	}
+	/* Vertex shader */
+	if (!gfw_compile_shader(&vertex_shader_gl_id, GL_VERTEX_SHADER, vertex_source)) {
+		success = false;
+		goto done;
+	}
+	if (geometry_source) {
+		if (!gfw_compile_shader(&geometry_shader_gl_id, GL_GEOMETRY_SHADER, geometry_source)) {
+			success = false;
+			goto done;
+		}
+	}
+	/* Capturing programs may have no fragment shader */
+	if (fragment_source) {
+		if (!gfw_compile_shader(&fragment_shader_gl_id, GL_FRAGMENT_SHADER, fragment_source)) {
+			success = false;
+			goto done;
+		}
+	}
+	/* Create program and attach shaders */
+	shader->program_gl_id = glCreateProgram();
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to create shader program.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#else
+		goto done;
+#endif
+	}
+#endif
+	if (gfw_program_cache_directory[0]) {
+		glProgramParameteri(shader->program_gl_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#ifdef GFW_CHECK_BACKEND_ERROR
+		if (glGetError() != GL_NO_ERROR) {
+			success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+			printf("Error: failed to set shader program binary retrievable hint.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+			abort();
+#else
+			goto done;
+#endif
+		}
+#endif
+	}
+	glAttachShader(shader->program_gl_id, vertex_shader_gl_id);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to attach vertex shader.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#else
+		goto done;
+#endif
+	}
+#endif
+	if (geometry_source) {
+		glAttachShader(shader->program_gl_id, geometry_shader_gl_id);
+#ifdef GFW_CHECK_BACKEND_ERROR
+		if (glGetError() != GL_NO_ERROR) {
+			success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+			printf("Error: failed to attach geometry shader.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+			abort();
+#else
+			goto done;
+#endif
+		}
+#endif
+	}
+	if (fragment_source) {
+		glAttachShader(shader->program_gl_id, fragment_shader_gl_id);
+#ifdef GFW_CHECK_BACKEND_ERROR
+		if (glGetError() != GL_NO_ERROR) {
+			success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+			printf("Error: failed to attach fragment shader.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+			abort();
+#else
+			goto done;
+#endif
+		}
+#endif
+	}
+	if (varyings_count > 0) {
+		glTransformFeedbackVaryings(shader->program_gl_id,
+			varyings_count,
+			(const char **)varyings,
+			interleaved ? GL_INTERLEAVED_ATTRIBS : GL_SEPARATE_ATTRIBS);
+#ifdef GFW_CHECK_BACKEND_ERROR
+		if (glGetError() != GL_NO_ERROR) {
+			success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+			printf("Error: failed to set shader transform feedback varyings.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+			abort();
+#else
+			goto done;
+#endif
+		}
+#endif
+	}
+	glLinkProgram(shader->program_gl_id);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to link shader program.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#else
+		goto done;
+#endif
+	}
+#endif
+	/* Check status */
+	glGetProgramiv(shader->program_gl_id, GL_LINK_STATUS, &param);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to get shader program status.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#else
+		goto done;
+#endif
+	}
+#endif
+	if (!param) {
+		GLsizei length;
+		glGetProgramInfoLog(shader->program_gl_id,
+			GFW_SHADER_LOG_MAX_LENGTH,
+			&length,
+			log_string);
+#ifdef GFW_CHECK_BACKEND_ERROR
+		if (glGetError() != GL_NO_ERROR) {
+			success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+			printf("Error: failed to get program info log.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+			abort();
+#else
+			goto done;
+#endif
+		}
+#endif
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Program shader error:\n %s", log_string);
+#endif
+		gfw_delete_shader(vertex_shader_gl_id);
+		if (geometry_source) {
+			gfw_delete_shader(geometry_shader_gl_id);
+		}
+		if (fragment_source) {
+			gfw_delete_shader(fragment_shader_gl_id);
+		}
+		success = false;
+		goto done;
+	}
+	/* Detach and delete unneeded shaders */
+	gfw_detach_shader(shader->program_gl_id, vertex_shader_gl_id);
+	gfw_delete_shader(vertex_shader_gl_id);
+	if (geometry_source) {
+		gfw_detach_shader(shader->program_gl_id, geometry_shader_gl_id);
+		gfw_delete_shader(geometry_shader_gl_id);
+	}
+	if (fragment_source) {
+		gfw_detach_shader(shader->program_gl_id, fragment_shader_gl_id);
+		gfw_delete_shader(fragment_shader_gl_id);
+	}
+	if (gfw_program_cache_directory[0]) {
+		gfw_store_program_binary(shader, hash);
+	}
+done:
+	shader->program_hash = hash;
+	if (success) {
+		gfw_reflect_shader(shader);
+		shader->status = GFW_SHADER_STATUS_READY;
+	}
+#ifdef GFW_TRACE
+	if (success && gfw_trace_file) {
+		gfw_trace_shader(shader, vertex_source, geometry_source, fragment_source, varyings, varyings_count, interleaved);
+	}
+#endif
+	gfw_update_handle(GFW_HANDLE_TYPE_SHADER, shader, shader->program_gl_id, 0);
+	return success;
+}
+
+bool gfw_init_shader(struct gfw_shader *shader, char *vertex_source, char *geometry_source, char *fragment_source)
+{
+	return gfw_init_shader_with_feedback(shader, vertex_source, geometry_source, fragment_source, NULL, 0, false);
+}
+
+/* Feedback */
+static GLenum gfw_get_feedback_primitive(enum gfw_primitive primitive)
+{
+	GLenum mode = GL_TRIANGLES;
+	if (primitive == GFW_PRIMITIVE_POINTS) {
+		mode = GL_POINTS;
+	} else if (primitive == GFW_PRIMITIVE_LINES || primitive == GFW_PRIMITIVE_LINE_STRIPS) {
+		mode = GL_LINES;
+	}
+	return mode;
+}
+
+void gfw_feedback_draw(struct gfw_feedback *feedback, struct gfw_vertex_state *vertex_state, enum gfw_primitive primitive)
+{
+	gfw_prepare_draw();
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_DRAWS, 1);
+	glBindVertexArray(vertex_state->vao_gl_id);
+	gfw_bound_vertex_state = vertex_state;
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to bind vertex state.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+	/* The vertex count stays on the GPU */
+	glDrawTransformFeedback(primitive, feedback->feedback_gl_id);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to draw feedback.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+}
+
+bool gfw_feedback_poll(struct gfw_feedback *feedback, size_t *primitives_written)
+{
+	bool available = !feedback->query_pending;
+	GLuint param = 0;
+	if (feedback->query_pending) {
+		glGetQueryObjectuiv(feedback->query_gl_id, GL_QUERY_RESULT_AVAILABLE, &param);
+#ifdef GFW_CHECK_BACKEND_ERROR
+		if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+			printf("Error: failed to get feedback query status.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+			abort();
+#endif
+		}
+#endif
+		if (param) {
+			glGetQueryObjectuiv(feedback->query_gl_id, GL_QUERY_RESULT, &param);
+#ifdef GFW_CHECK_BACKEND_ERROR
+			if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+				printf("Error: failed to get feedback query result.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+				abort();
+#endif
+			}
+#endif
+			feedback->primitives_written = param;
+			feedback->query_pending = false;
+			available = true;
+		}
+	}
+	if (primitives_written) {
+		*primitives_written = feedback->primitives_written;
+	}
+	return available;
+}
+
+void gfw_feedback_end(struct gfw_feedback *feedback)
+{
+	glEndTransformFeedback();
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to end feedback.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+	glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to end feedback query.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+	/* Clears are discarded too, so the state is restored right away */
+	if (feedback->discard) {
+		gfw_disable_rasterizer_discard();
+		gfw_flush_state();
+	}
+	glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to unbind feedback.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+	feedback->query_pending = true;
+}
+
+void gfw_feedback_begin(struct gfw_feedback *feedback, enum gfw_primitive primitive, bool discard)
+{
+	feedback->discard = discard;
+	if (discard) {
+		gfw_enable_rasterizer_discard();
+	}
+	gfw_prepare_draw();
+	glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, feedback->feedback_gl_id);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to bind feedback.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+	/* A query still pending is replaced, its result is lost */
+	glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, feedback->query_gl_id);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to begin feedback query.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+	glBeginTransformFeedback(gfw_get_feedback_primitive(primitive));
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to begin feedback.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+}
+
+bool gfw_feedback_set_vertex_data(struct gfw_feedback *feedback, uint32_t index, struct gfw_vertex_data *vertex_data)
+{
+	bool success = true;
+	glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, feedback->feedback_gl_id);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to bind feedback.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#else
+		goto done;
+#endif
+	}
+#endif
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, index, vertex_data->vbo_gl_id);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to set feedback vertex data.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#else
+		goto done;
+#endif
+	}
+#endif
+	glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to unbind feedback.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#else
+		goto done;
+#endif
+	}
+#endif
+#if defined(GFW_CHECK_BACKEND_ERROR) && !defined(GFW_ABORT_ON_BACKEND_ERROR)
+done:
+#endif
+	return success;
+}
+
+void gfw_free_feedback(struct gfw_feedback *feedback)
+{
+	glDeleteQueries(1, &feedback->query_gl_id);
+	glDeleteTransformFeedbacks(1, &feedback->feedback_gl_id);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to delete feedback.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+	feedback->feedback_gl_id = 0;
+	feedback->query_gl_id = 0;
+	feedback->primitives_written = 0;
+	feedback->query_pending = false;
+}
+
+bool gfw_init_feedback(struct gfw_feedback *feedback, struct gfw_vertex_data *vertex_data)
+{
+	bool success = true;
+	feedback->feedback_gl_id = 0;
+	feedback->query_gl_id = 0;
+	feedback->primitives_written = 0;
+	feedback->query_pending = false;
+	feedback->discard = false;
+	glGenTransformFeedbacks(1, &feedback->feedback_gl_id);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to generate feedback.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#else
+		goto done;
+#endif
+	}
+#endif
+	glGenQueries(1, &feedback->query_gl_id);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to generate feedback query.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#else
+		goto done;
+#endif
+	}
+#endif
+	if (!gfw_feedback_set_vertex_data(feedback, 0, vertex_data)) {
+		success = false;
+		goto done;
+	}
+done:
+	return success;
+}
+
+/* Compute */
+static const GLbitfield gfw_barrier_gl_bits[] = {
+	GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT,
+	GL_ELEMENT_ARRAY_BARRIER_BIT,
+	GL_UNIFORM_BARRIER_BIT,
+	GL_TEXTURE_FETCH_BARRIER_BIT,
+	GL_SHADER_IMAGE_ACCESS_BARRIER_BIT,
+	GL_COMMAND_BARRIER_BIT,
+	GL_TEXTURE_UPDATE_BARRIER_BIT,
+	GL_BUFFER_UPDATE_BARRIER_BIT,
+	GL_FRAMEBUFFER_BARRIER_BIT,
+	GL_TRANSFORM_FEEDBACK_BARRIER_BIT,
+	GL_SHADER_STORAGE_BARRIER_BIT
+};
+
+void gfw_memory_barrier(enum gfw_barrier_bits barriers)
+{
+	GLbitfield gl_barriers = 0;
+	uint32_t i = 0;
+	if ((barriers & GFW_MEMORY_BARRIER_ALL) == GFW_MEMORY_BARRIER_ALL) {
+		gl_barriers = GL_ALL_BARRIER_BITS;
+	} else {
+		while (i < sizeof(gfw_barrier_gl_bits) / sizeof(*gfw_barrier_gl_bits)) {
+			if (barriers & (1u << i)) {
+				gl_barriers = gl_barriers | gfw_barrier_gl_bits[i];
+			}
+			i++;
+		}
+	}
+	if (barriers & ~(uint32_t)GFW_MEMORY_BARRIER_ALL) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to set memory barrier with unknown bits.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+	glMemoryBarrier(gl_barriers);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to set memory barrier.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+}
+
+void gfw_compute_dispatch_indirect(struct gfw_vertex_data *indirect_data, size_t offset)
+{
+	gfw_prepare_draw();
+	glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, indirect_data->vbo_gl_id);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to bind indirect data.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+	glDispatchComputeIndirect((GLintptr)offset);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to dispatch indirect compute.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+	glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+}
+
+void gfw_compute_dispatch(uint32_t x, uint32_t y, uint32_t z)
+{
+	gfw_prepare_draw();
+	glDispatchCompute(x, y, z);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to dispatch compute.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+}
+
+bool gfw_init_compute_shader(struct gfw_shader *shader, char *compute_source)
+{
+	bool success = true;
+	GLuint compute_shader_gl_id = 0;
+	GLint param = 0;
+	uint64_t hash = 0;
+	char log_string[GFW_SHADER_LOG_MAX_LENGTH] = {0};
+	shader->program_gl_id = 0;
+	shader->vertex_shader_gl_id = 0;
+	shader->geometry_shader_gl_id = 0;
+	shader->fragment_shader_gl_id = 0;
+	shader->program_hash = 0;
+	shader->status = GFW_SHADER_STATUS_FAILED;
+	shader->variables = NULL;
+	shader->variable_names = NULL;
+	shader->variables_capacity = 0;
+	shader->variables_count = 0;
+	gfw_reset_uniform_shadow(shader);
+	/* Graphic programs always have a vertex source, so hashes do not collide */
+	if (gfw_program_cache_directory[0]) {
+		hash = gfw_hash_program_sources(NULL, NULL, compute_source);
+		if (gfw_load_program_binary(shader, hash)) {
+			gfw_program_cache_statistics.hits = gfw_program_cache_statistics.hits + 1;
+			goto done;
+		}
+		gfw_program_cache_statistics.misses = gfw_program_cache_statistics.misses + 1;
+	}
+	if (!gfw_compile_shader(&compute_shader_gl_id, GL_COMPUTE_SHADER, compute_source)) {
+		success = false;
+		goto done;
+	}
+	shader->program_gl_id = glCreateProgram();
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to create compute shader program.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#else
+		goto done;
+#endif
+	}
+#endif
+	if (gfw_program_cache_directory[0]) {
+		glProgramParameteri(shader->program_gl_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#ifdef GFW_CHECK_BACKEND_ERROR
+		if (glGetError() != GL_NO_ERROR) {
+			success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+			printf("Error: failed to set shader program binary retrievable hint.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+			abort();
+#else
+			goto done;
+#endif
+		}
+#endif
+	}
+	glAttachShader(shader->program_gl_id, compute_shader_gl_id);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to attach compute shader.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#else
+		goto done;
+#endif
+	}
+#endif
+	glLinkProgram(shader->program_gl_id);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to link compute shader program.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#else
+		goto done;
+#endif
+	}
+#endif
+	glGetProgramiv(shader->program_gl_id, GL_LINK_STATUS, &param);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to get compute shader program status.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#else
+		goto done;
+#endif
+	}
+#endif
+	if (!param) {
+		GLsizei length;
+		glGetProgramInfoLog(shader->program_gl_id,
+			GFW_SHADER_LOG_MAX_LENGTH,
+			&length,
+			log_string);
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Program shader error:\n %s", log_string);
+#endif
+		success = false;
+		goto done;
+	}
+	gfw_detach_shader(shader->program_gl_id, compute_shader_gl_id);
+	if (gfw_program_cache_directory[0]) {
+		gfw_store_program_binary(shader, hash);
+	}
+done:
+	if (compute_shader_gl_id) {
+		gfw_delete_shader(compute_shader_gl_id);
+	}
+	/* A program that failed to link is not kept around */
+	if (!success && shader->program_gl_id) {
+		glDeleteProgram(shader->program_gl_id);
+		shader->program_gl_id = 0;
+	}
+	shader->program_hash = hash;
+	if (success) {
+		gfw_reflect_shader(shader);
+		shader->status = GFW_SHADER_STATUS_READY;
+	}
+	gfw_update_handle(GFW_HANDLE_TYPE_SHADER, shader, shader->program_gl_id, 0);
+	return success;
+}
+
+/* Shader stage */
+struct gfw_shader_pipeline {
+	gfw_uint_t stage_gl_ids[3];
+	gfw_uint_t pipeline_gl_id;
+};
+
+static struct gfw_shader_pipeline *gfw_shader_pipelines = NULL;
+static uint32_t gfw_shader_pipelines_capacity = 0;
+static uint32_t gfw_shader_pipelines_count = 0;
+static gfw_uint_t gfw_bound_pipeline_gl_id = 0;
+
+void gfw_shader_stage_set_uniform_mat4(struct gfw_shader_stage *stage, gfw_int_t location, bool normalize, gfw_float_t *matrix)
+{
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_UNIFORM_UPDATES, 1);
+	glProgramUniformMatrix4fv(stage->program_gl_id, location, 1, normalize, matrix);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to set shader stage 4x4 matrix uniform variable.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+}
+
+void gfw_shader_stage_set_uniform_mat3(struct gfw_shader_stage *stage, gfw_int_t location, bool normalize, gfw_float_t *matrix)
+{
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_UNIFORM_UPDATES, 1);
+	glProgramUniformMatrix3fv(stage->program_gl_id, location, 1, normalize, matrix);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to set shader stage 3x3 matrix uniform variable.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+}
+
+void gfw_shader_stage_set_uniform_float(struct gfw_shader_stage *stage, gfw_int_t location, gfw_float_t f)
+{
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_UNIFORM_UPDATES, 1);
+	glProgramUniform1f(stage->program_gl_id, location, f);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to set shader stage floating-point uniform variable.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+}
+
+void gfw_shader_stage_set_uniform_floatv(struct gfw_shader_stage *stage, gfw_int_t location, gfw_float_t *f, uint32_t count)
+{
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_UNIFORM_UPDATES, 1);
+	glProgramUniform1fv(stage->program_gl_id, location, count, f);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to set shader stage floating-point uniform array.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+}
+
+void gfw_shader_stage_set_uniform_int(struct gfw_shader_stage *stage, gfw_int_t location, gfw_int_t i)
+{
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_UNIFORM_UPDATES, 1);
+	glProgramUniform1i(stage->program_gl_id, location, i);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to set shader stage integer uniform variable.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+}
+
+void gfw_shader_stage_set_uniform_intv(struct gfw_shader_stage *stage, gfw_int_t location, gfw_int_t *i, uint32_t count)
+{
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_UNIFORM_UPDATES, 1);
+	glProgramUniform1iv(stage->program_gl_id, location, count, i);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to set shader stage integer uniform array.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+}
+
+void gfw_shader_stage_set_uniform_uint(struct gfw_shader_stage *stage, gfw_int_t location, gfw_uint_t i)
+{
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_UNIFORM_UPDATES, 1);
+	glProgramUniform1ui(stage->program_gl_id, location, i);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to set shader stage unsigned integer uniform variable.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+}
+
+void gfw_shader_stage_set_uniform_uintv(struct gfw_shader_stage *stage, gfw_int_t location, gfw_uint_t *i, uint32_t count)
+{
+	GFW_COUNT_STATISTIC(GFW_STATISTIC_UNIFORM_UPDATES, 1);
+	glProgramUniform1uiv(stage->program_gl_id, location, count, i);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to set shader stage unsigned integer uniform array.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+}
+
+gfw_int_t gfw_shader_stage_get_uniform_location(struct gfw_shader_stage *stage, char *name)
+{
+	gfw_int_t location = glGetUniformLocation(stage->program_gl_id, name);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to get shader stage uniform location.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+	return location;
+}
+
+static uint32_t gfw_hash_shader_pipeline(gfw_uint_t *stage_gl_ids)
+{
+	return gfw_hash(GFW_HASH_BASIS, stage_gl_ids, 3 * sizeof(*stage_gl_ids));
+}
+
+static bool gfw_insert_shader_pipeline(struct gfw_shader_pipeline pipeline)
+{
+	struct gfw_shader_pipeline *old_pipelines = gfw_shader_pipelines;
+	uint32_t old_capacity = gfw_shader_pipelines_capacity;
+	uint32_t capacity = old_capacity > 0 ? old_capacity : 16;
+	uint32_t mask = 0;
+	uint32_t i = 0;
+	if (2 * (gfw_shader_pipelines_count + 1) > old_capacity) {
+		while (2 * (gfw_shader_pipelines_count + 1) > capacity) {
+			capacity = capacity * 2;
+		}
+		gfw_shader_pipelines = calloc(capacity, sizeof(*gfw_shader_pipelines));
+		if (!gfw_shader_pipelines) {
+			gfw_shader_pipelines = old_pipelines;
+			return false;
+		}
+		gfw_shader_pipelines_capacity = capacity;
+		gfw_shader_pipelines_count = 0;
+		while (i < old_capacity) {
+			if (old_pipelines[i].pipeline_gl_id) {
+				gfw_insert_shader_pipeline(old_pipelines[i]);
+			}
+			i++;
+		}
+		free(old_pipelines);
+	}
+	mask = gfw_shader_pipelines_capacity - 1;
+	i = gfw_hash_shader_pipeline(pipeline.stage_gl_ids) & mask;
+	while (gfw_shader_pipelines[i].pipeline_gl_id) {
+		i = (i + 1) & mask;
+	}
+	gfw_shader_pipelines[i] = pipeline;
+	gfw_shader_pipelines_count = gfw_shader_pipelines_count + 1;
+	return true;
+}
+
+static gfw_uint_t gfw_get_shader_pipeline(gfw_uint_t *stage_gl_ids)
+{
+	struct gfw_shader_pipeline pipeline = {{0}, 0};
+	uint32_t mask = gfw_shader_pipelines_capacity - 1;
+	uint32_t i = gfw_hash_shader_pipeline(stage_gl_ids) & mask;
+	while (gfw_shader_pipelines && gfw_shader_pipelines[i].pipeline_gl_id) {
+		if (memcmp(gfw_shader_pipelines[i].stage_gl_ids, stage_gl_ids, sizeof(pipeline.stage_gl_ids)) == 0) {
+			return gfw_shader_pipelines[i].pipeline_gl_id;
+		}
+		i = (i + 1) & mask;
+	}
+	memcpy(pipeline.stage_gl_ids, stage_gl_ids, sizeof(pipeline.stage_gl_ids));
+	glGenProgramPipelines(1, &pipeline.pipeline_gl_id);
+	glUseProgramStages(pipeline.pipeline_gl_id, GL_VERTEX_SHADER_BIT, stage_gl_ids[0]);
+	if (stage_gl_ids[1]) {
+		glUseProgramStages(pipeline.pipeline_gl_id, GL_GEOMETRY_SHADER_BIT, stage_gl_ids[1]);
+	}
+	glUseProgramStages(pipeline.pipeline_gl_id, GL_FRAGMENT_SHADER_BIT, stage_gl_ids[2]);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to create shader pipeline.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+		glDeleteProgramPipelines(1, &pipeline.pipeline_gl_id);
+		return 0;
+	}
+#endif
+	if (!gfw_insert_shader_pipeline(pipeline)) {
+		glDeleteProgramPipelines(1, &pipeline.pipeline_gl_id);
+		return 0;
+	}
+	return pipeline.pipeline_gl_id;
+}
+
+bool gfw_shader_stages_use(struct gfw_shader_stage *vertex_stage, struct gfw_shader_stage *geometry_stage, struct gfw_shader_stage *fragment_stage)
+{
+	bool success = true;
+	gfw_uint_t stage_gl_ids[3] = {0};
+	gfw_uint_t pipeline_gl_id = 0;
+	stage_gl_ids[0] = vertex_stage->program_gl_id;
+	stage_gl_ids[1] = geometry_stage ? geometry_stage->program_gl_id : 0;
+	stage_gl_ids[2] = fragment_stage->program_gl_id;
+	pipeline_gl_id = gfw_get_shader_pipeline(stage_gl_ids);
+	if (!pipeline_gl_id) {
+		success = false;
+		goto done;
+	}
+	/* A program in use takes precedence over the bound pipeline */
+	if (gfw_program_in_use) {
+		glUseProgram(0);
+		gfw_current_shader = NULL;
+		gfw_program_in_use = false;
+	}
+	if (pipeline_gl_id != gfw_bound_pipeline_gl_id) {
+		glBindProgramPipeline(pipeline_gl_id);
+		GFW_COUNT_STATISTIC(GFW_STATISTIC_BINDS, 1);
+#ifdef GFW_CHECK_BACKEND_ERROR
+		if (glGetError() != GL_NO_ERROR) {
+			success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+			printf("Error: failed to bind shader pipeline.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+			abort();
+#else
+			goto done;
+#endif
+		}
+#endif
+		gfw_bound_pipeline_gl_id = pipeline_gl_id;
+	}
+done:
+	return success;
+}
+
+void gfw_free_shader_pipelines(void)
+{
+	uint32_t i = 0;
+	while (i < gfw_shader_pipelines_capacity) {
+		if (gfw_shader_pipelines[i].pipeline_gl_id) {
+			glDeleteProgramPipelines(1, &gfw_shader_pipelines[i].pipeline_gl_id);
+		}
+		i++;
+	}
+	free(gfw_shader_pipelines);
+	gfw_shader_pipelines = NULL;
+	gfw_shader_pipelines_capacity = 0;
+	gfw_shader_pipelines_count = 0;
+	gfw_bound_pipeline_gl_id = 0;
+}
+
+void gfw_free_shader_stage(struct gfw_shader_stage *stage)
+{
+	struct gfw_shader_pipeline *old_pipelines = gfw_shader_pipelines;
+	uint32_t old_capacity = gfw_shader_pipelines_capacity;
+	uint32_t i = 0;
+	/* Pipelines using the stage are dropped and the others are inserted again */
+	gfw_shader_pipelines = NULL;
+	gfw_shader_pipelines_capacity = 0;
+	gfw_shader_pipelines_count = 0;
+	while (i < old_capacity) {
+		if (old_pipelines[i].pipeline_gl_id) {
+			if (old_pipelines[i].stage_gl_ids[0] == stage->program_gl_id
+				|| old_pipelines[i].stage_gl_ids[1] == stage->program_gl_id
+				|| old_pipelines[i].stage_gl_ids[2] == stage->program_gl_id
+				|| !gfw_insert_shader_pipeline(old_pipelines[i])) {
+				if (old_pipelines[i].pipeline_gl_id == gfw_bound_pipeline_gl_id) {
+					gfw_bound_pipeline_gl_id = 0;
+				}
+				glDeleteProgramPipelines(1, &old_pipelines[i].pipeline_gl_id);
+			}
+		}
+		i++;
+	}
+	free(old_pipelines);
+	glDeleteProgram(stage->program_gl_id);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to delete shader stage.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+	stage->program_gl_id = 0;
+}
+
+bool gfw_init_shader_stage(struct gfw_shader_stage *stage, enum gfw_shader_stage_type type, char *source)
+{
+	bool success = true;
+	GLint param = 0;
+	char log_string[GFW_SHADER_LOG_MAX_LENGTH] = {0};
+	stage->type = type;
+	/* Programs created from a single stage are separable */
+	stage->program_gl_id = glCreateShaderProgramv(type, 1, (const char **)&source);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to create shader stage.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#else
+		goto done;
+#endif
+	}
+#endif
+	glGetProgramiv(stage->program_gl_id, GL_LINK_STATUS, &param);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+		param = 0;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to get shader stage status.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+	if (!param) {
+		GLsizei length;
+		glGetProgramInfoLog(stage->program_gl_id,
+			GFW_SHADER_LOG_MAX_LENGTH,
+			&length,
+			log_string);
+#ifdef GFW_PRINT_BACKEND_ERROR
+		if (type == GFW_SHADER_STAGE_VERTEX) {
+			printf("Vertex shader stage error:\n %s", log_string);
+		} else if (type == GFW_SHADER_STAGE_FRAGMENT) {
+			printf("Fragment shader stage error:\n %s", log_string);
+		} else if (type == GFW_SHADER_STAGE_GEOMETRY) {
+			printf("Geometry shader stage error:\n %s", log_string);
+		}
+#endif
+		glDeleteProgram(stage->program_gl_id);
+		stage->program_gl_id = 0;
+		success = false;
+		goto done;
+	}
+done:
+	return success;
+}
+
+/* Shader variants */
+struct gfw_text {
+	char *data;
+	size_t length;
+	size_t capacity;
+};
+
+static bool gfw_text_append(struct gfw_text *text, const char *data, size_t length)
+{
+	char *new_data = NULL;
+	size_t capacity = text->capacity > 0 ? text->capacity : 256;
+	while (text->length + length + 1 > capacity) {
+		capacity = capacity * 2;
+	}
+	if (capacity != text->capacity) {
+		new_data = realloc(text->data, capacity);
+		if (!new_data) {
+			return false;
+		}
+		text->data = new_data;
+		text->capacity = capacity;
+	}
+	memcpy(text->data + text->length, data, length);
+	text->length = text->length + length;
+	text->data[text->length] = 0;
+	return true;
+}
+
+static char *gfw_read_file(char *path)
+{
+	char *data = NULL;
+	long size = 0;
+	FILE *file = fopen(path, "rb");
+	if (!file) {
+		goto done;
+	}
+	if (fseek(file, 0, SEEK_END) != 0 || (size = ftell(file)) < 0 || fseek(file, 0, SEEK_SET) != 0) {
+		goto done;
+	}
+	data = malloc(size + 1);
+	if (!data) {
+		goto done;
+	}
+	if (size > 0 && fread(data, size, 1, file) != 1) {
+		free(data);
+		data = NULL;
+		goto done;
+	}
+	data[size] = 0;
+done:
+	if (file) {
+		fclose(file);
+	}
+	return data;
+}
+
+static bool gfw_shader_skip_comments(char *line, char *end, bool in_comment)
+{
+	while (line < end) {
+		if (in_comment && line + 1 < end && line[0] == '*' && line[1] == '/') {
+			in_comment = false;
+			line++;
+		} else if (!in_comment && line + 1 < end && line[0] == '/' && line[1] == '/') {
+			break;
+		} else if (!in_comment && line + 1 < end && line[0] == '/' && line[1] == '*') {
+			in_comment = true;
+			line++;
+		}
+		line++;
+	}
+	return in_comment;
+}
+
+static bool gfw_shader_preprocess_text(struct gfw_text *text,
+	char *source,
+	char *include_directory,
+	uint32_t depth,
+	uint32_t source_index,
+	uint32_t *sources_count)
+{
+	bool success = true;
+	bool in_comment = false;
+	char path[GFW_SHADER_PATH_MAX_LENGTH] = {0};
+	char line_directive[64] = {0};
+	char *line = source;
+	char *end = NULL;
+	char *name = NULL;
+	char *name_end = NULL;
+	char *included = NULL;
+	uint32_t line_number = 1;
+	if (depth > GFW_SHADER_INCLUDE_MAX_DEPTH) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to preprocess shader with includes nested too deep.\n");
+#endif
+		return false;
+	}
+	while (success && *line) {
+		end = strchr(line, '\n');
+		if (!end) {
+			end = line + strlen(line);
+		}
+		name = line;
+		while (name < end && (*name == ' ' || *name == '\t')) {
+			name++;
+		}
+		/* Includes are recognized at the start of lines outside block comments only */
+		if (!in_comment && end - name > 8 && strncmp(name, "#include", 8) == 0) {
+			name = name + 8;
+			while (name < end && (*name == ' ' || *name == '\t')) {
+				name++;
+			}
+			name_end = name + 1;
+			while (name_end < end && *name_end != '"' && *name_end != '>') {
+				name_end++;
+			}
+			if ((*name != '"' && *name != '<') || name_end >= end) {
+				success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+				printf("Error: failed to preprocess shader with malformed include in line %u.\n", line_number);
+#endif
+				break;
+			}
+			name++;
+			snprintf(path, sizeof(path), "%s/%.*s", include_directory ? include_directory : ".", (int)(name_end - name), name);
+			included = gfw_read_file(path);
+			if (!included) {
+				success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+				printf("Error: failed to read shader include %s.\n", path);
+#endif
+				break;
+			}
+			/* Every include gets its own source number, so compiler messages name the right file */
+			*sources_count = *sources_count + 1;
+			snprintf(line_directive, sizeof(line_directive), "#line 1 %u\n", *sources_count);
+			success = gfw_text_append(text, line_directive, strlen(line_directive))
+				&& gfw_shader_preprocess_text(text, included, include_directory, depth + 1, *sources_count, sources_count);
+			snprintf(line_directive, sizeof(line_directive), "\n#line %u %u\n", line_number + 1, source_index);
+			success = success && gfw_text_append(text, line_directive, strlen(line_directive));
+			free(included);
+		} else {
+			in_comment = gfw_shader_skip_comments(line, end, in_comment);
+			success = gfw_text_append(text, line, end - line) && gfw_text_append(text, "\n", 1);
+		}
+		line = *end ? end + 1 : end;
+		line_number++;
+	}
+	return success;
+}
+
+char *gfw_shader_preprocess(char *source, char *include_directory)
+{
+	struct gfw_text text = {0};
+	uint32_t sources_count = 0;
+	if (!gfw_text_append(&text, "", 0) || !gfw_shader_preprocess_text(&text, source, include_directory, 0, 0, &sources_count)) {
+		free(text.data);
+		text.data = NULL;
+	}
+	return text.data;
+}
+
+char *gfw_shader_load(char *path, char *include_directory)
+{
+	char *source = gfw_read_file(path);
+	char *preprocessed = NULL;
+	if (!source) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to read shader %s.\n", path);
+#endif
+		return NULL;
+	}
+	preprocessed = gfw_shader_preprocess(source, include_directory);
+	free(source);
+	return preprocessed;
+}
+
+static char *gfw_shader_variants_source(struct gfw_shader_variants *variants, char *source, uint64_t key)
+{
+	struct gfw_text text = {0};
+	char *body = source;
+	char *line_directive = "#line 1 0\n";
+	uint32_t i = 0;
+	bool success = gfw_text_append(&text, "", 0);
+	if (!source) {
+		free(text.data);
+		return NULL;
+	}
+	/* Defines go after the version directive, which has to come first */
+	while (*body == ' ' || *body == '\t' || *body == '\r' || *body == '\n') {
+		body++;
+	}
+	if (strncmp(body, "#version", 8) == 0) {
+		body = strchr(body, '\n');
+		body = body ? body + 1 : source + strlen(source);
+		success = success && gfw_text_append(&text, source, body - source);
+		line_directive = "#line 2 0\n";
+	} else {
+		body = source;
+	}
+	while (success && i < variants->defines_count) {
+		if (key & ((uint64_t)1 << i)) {
+			success = gfw_text_append(&text, "#define ", 8)
+				&& gfw_text_append(&text, variants->defines[i], strlen(variants->defines[i]))
+				&& gfw_text_append(&text, " 1\n", 3);
+		}
+		i++;
+	}
+	success = success
+		&& gfw_text_append(&text, line_directive, strlen(line_directive))
+		&& gfw_text_append(&text, body, strlen(body));
+	if (!success) {
+		free(text.data);
+		text.data = NULL;
+	}
+	return text.data;
+}
+
+static uint32_t gfw_hash_variant_key(uint64_t key)
+{
+	return gfw_hash(GFW_HASH_BASIS, &key, sizeof(key));
+}
+
+static struct gfw_shader_variant *gfw_find_shader_variant(struct gfw_shader_variants *variants, uint64_t key)
+{
+	uint32_t mask = variants->variants_capacity - 1;
+	uint32_t i = gfw_hash_variant_key(key) & mask;
+	while (variants->variants[i]) {
+		if (variants->variants[i]->key == key) {
+			return variants->variants[i];
+		}
+		i = (i + 1) & mask;
+	}
+	return NULL;
+}
+
+static bool gfw_insert_shader_variant(struct gfw_shader_variants *variants, struct gfw_shader_variant *variant)
+{
+	struct gfw_shader_variant **old_variants = variants->variants;
+	uint32_t old_capacity = variants->variants_capacity;
+	uint32_t mask = 0;
+	uint32_t i = 0;
+	/* Variants live in their own allocations, so growing the table never moves a shader */
+	if (2 * (variants->variants_count + 1) > variants->variants_capacity) {
+		variants->variants = calloc(old_capacity * 2, sizeof(*variants->variants));
+		if (!variants->variants) {
+			variants->variants = old_variants;
+			return false;
+		}
+		variants->variants_capacity = old_capacity * 2;
+		variants->variants_count = 0;
+		while (i < old_capacity) {
+			if (old_variants[i]) {
+				gfw_insert_shader_variant(variants, old_variants[i]);
+			}
+			i++;
+		}
+		free(old_variants);
+	}
+	mask = variants->variants_capacity - 1;
+	i = gfw_hash_variant_key(variant->key) & mask;
+	while (variants->variants[i]) {
+		i = (i + 1) & mask;
+	}
+	variants->variants[i] = variant;
+	variants->variants_count = variants->variants_count + 1;
+	return true;
+}
+
+static struct gfw_shader_variant *gfw_submit_shader_variant(struct gfw_shader_variants *variants, uint64_t key, bool async)
+{
+	struct gfw_shader_variant *variant = calloc(1, sizeof(*variant));
+	char *vertex_source = gfw_shader_variants_source(variants, variants->vertex_source, key);
+	char *geometry_source = gfw_shader_variants_source(variants, variants->geometry_source, key);
+	char *fragment_source = gfw_shader_variants_source(variants, variants->fragment_source, key);
+	char label[32] = {0};
+	if (!variant || !vertex_source || !fragment_source || (variants->geometry_source && !geometry_source)) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to allocate shader variant.\n");
+#endif
+		free(variant);
+		variant = NULL;
+		goto done;
+	}
+	variant->key = key;
+	/* Failed variants stay in the cache, so they are not compiled again every frame */
+	if (async) {
+		gfw_init_shader_async(&variant->shader, vertex_source, geometry_source, fragment_source);
+	} else {
+		gfw_init_shader(&variant->shader, vertex_source, geometry_source, fragment_source);
+	}
+	snprintf(label, sizeof(label), "variant %016llx", (unsigned long long)key);
+	gfw_set_debug_label(GFW_DEBUG_OBJECT_PROGRAM, variant->shader.program_gl_id, label);
+	if (!gfw_insert_shader_variant(variants, variant)) {
+		gfw_free_shader(&variant->shader);
+		free(variant);
+		variant = NULL;
+	}
+done:
+	free(vertex_source);
+	free(geometry_source);
+	free(fragment_source);
+	return variant;
+}
+
+size_t gfw_shader_variants_update(struct gfw_shader_variants *variants)
+{
+	size_t pending = 0;
+	uint32_t i = 0;
+	while (i < variants->variants_capacity) {
+		if (variants->variants[i] && gfw_shader_poll(&variants->variants[i]->shader) == GFW_SHADER_STATUS_PENDING) {
+			pending++;
+		}
+		i++;
+	}
+	return pending;
+}
+
+bool gfw_shader_variants_precompile(struct gfw_shader_variants *variants, uint64_t *keys, size_t keys_count)
+{
+	bool success = true;
+	size_t i = 0;
+	while (i < keys_count) {
+		if (!gfw_find_shader_variant(variants, keys[i])) {
+			if (!gfw_submit_shader_variant(variants, keys[i], true)) {
+				success = false;
+			}
+		}
+		i++;
+	}
+	return success;
+}
+
+struct gfw_shader *gfw_shader_variants_get(struct gfw_shader_variants *variants, uint64_t key)
+{
+	struct gfw_shader_variant *variant = gfw_find_shader_variant(variants, key);
+	if (!variant) {
+		variant = gfw_submit_shader_variant(variants, key, false);
+		if (!variant) {
+			return NULL;
+		}
+	}
+	/* A variant still compiling in the background is needed now, the link status query waits for it */
+	gfw_resolve_shader(&variant->shader, true);
+	return variant->shader.status == GFW_SHADER_STATUS_READY ? &variant->shader : NULL;
+}
+
+void gfw_free_shader_variants(struct gfw_shader_variants *variants)
+{
+	uint32_t i = 0;
+	while (i < variants->variants_capacity) {
+		if (variants->variants[i]) {
+			gfw_free_shader(&variants->variants[i]->shader);
+			free(variants->variants[i]);
+		}
+		i++;
+	}
+	i = 0;
+	while (i < variants->defines_count) {
+		free(variants->defines[i]);
+		variants->defines[i] = NULL;
+		i++;
+	}
+	free(variants->variants);
+	free(variants->vertex_source);
+	free(variants->geometry_source);
+	free(variants->fragment_source);
+	variants->variants = NULL;
+	variants->variants_capacity = 0;
+	variants->variants_count = 0;
+	variants->vertex_source = NULL;
+	variants->geometry_source = NULL;
+	variants->fragment_source = NULL;
+	variants->defines_count = 0;
+}
+
+bool gfw_init_shader_variants(struct gfw_shader_variants *variants,
+	char *vertex_source,
+	char *geometry_source,
+	char *fragment_source,
+	char *include_directory,
+	char **defines,
+	size_t defines_count)
+{
+	bool success = true;
+	uint32_t i = 0;
+	variants->geometry_source = NULL;
+	variants->defines_count = 0;
+	variants->variants_count = 0;
+	variants->variants_capacity = 16;
+	variants->variants = calloc(variants->variants_capacity, sizeof(*variants->variants));
+	if (!variants->variants) {
+		variants->variants_capacity = 0;
+	}
+	/* Includes are resolved once, defines are added per variant */
+	variants->vertex_source = gfw_shader_preprocess(vertex_source, include_directory);
+	if (geometry_source) {
+		variants->geometry_source = gfw_shader_preprocess(geometry_source, include_directory);
+	}
+	variants->fragment_source = gfw_shader_preprocess(fragment_source, include_directory);
+	if (!variants->variants || !variants->vertex_source || !variants->fragment_source
+		|| (geometry_source && !variants->geometry_source)) {
+		success = false;
+		goto done;
+	}
+	if (defines_count > GFW_SHADER_VARIANTS_MAX_DEFINES) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to initialize shader variants with too many defines.\n");
+#endif
+		goto done;
+	}
+	while (i < defines_count) {
+		variants->defines[i] = malloc(strlen(defines[i]) + 1);
+		if (!variants->defines[i]) {
+			success = false;
+			goto done;
+		}
+		strcpy(variants->defines[i], defines[i]);
+		variants->defines_count = variants->defines_count + 1;
+		i++;
+	}
+done:
+	if (!success) {
+		gfw_free_shader_variants(variants);
+	}
+	return success;
+}
+
+/* Shader watcher */
+static char *gfw_copy_string(char *string)
+{
+	char *copy = NULL;
+	if (string) {
+		copy = malloc(strlen(string) + 1);
+		if (copy) {
+			strcpy(copy, string);
+		}
+	}
+	return copy;
+}
+
+#ifdef __linux__
+static bool gfw_shader_watcher_watch_directory(struct gfw_shader_watcher *watcher, char *path, size_t length)
+{
+	char directory[GFW_SHADER_PATH_MAX_LENGTH] = {0};
+	uint32_t i = 0;
+	if (length == 0) {
+		strcpy(directory, ".");
+	} else if (length < sizeof(directory)) {
+		memcpy(directory, path, length);
+	} else {
+		return false;
+	}
+	while (i < watcher->directories_count) {
+		if (strcmp(watcher->directories[i], directory) == 0) {
+			return true;
+		}
+		i++;
+	}
+	if (watcher->directories_count >= GFW_SHADER_WATCHER_MAX_DIRECTORIES) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to watch shader directory, too many directories.\n");
+#endif
+		return false;
+	}
+	/* Directories are watched, since editors often replace files instead of writing them */
+	watcher->directory_descriptors[i] = inotify_add_watch(watcher->inotify_fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+	if (watcher->directory_descriptors[i] < 0) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to watch shader directory %s.\n", directory);
+#endif
+		return false;
+	}
+	watcher->directories[i] = gfw_copy_string(directory);
+	watcher->directories_count = watcher->directories_count + 1;
+	return watcher->directories[i] != NULL;
+}
+
+static void gfw_shader_watcher_mark(struct gfw_shader_watcher *watcher, char *directory, char *name)
+{
+	size_t directory_length = strlen(directory);
+	bool include = watcher->include_directory && strcmp(directory, watcher->include_directory) == 0;
+	uint32_t i = 0;
+	uint32_t j = 0;
+	char *path = NULL;
+	while (i < watcher->watches_count) {
+		/* A changed include can affect every program */
+		if (include) {
+			watcher->watches[i].changed = true;
+		}
+		j = 0;
+		while (j < 3) {
+			path = watcher->watches[i].paths[j];
+			if (path) {
+				if (strchr(path, '/')) {
+					if (strncmp(path, directory, directory_length) == 0 && path[directory_length] == '/'
+						&& strcmp(path + directory_length + 1, name) == 0) {
+						watcher->watches[i].changed = true;
+					}
+				} else if (strcmp(directory, ".") == 0 && strcmp(path, name) == 0) {
+					watcher->watches[i].changed = true;
+				}
+			}
+			j++;
+		}
+		i++;
+	}
+}
+
+static void gfw_shader_watcher_read_events(struct gfw_shader_watcher *watcher)
+{
+	/* The union keeps the buffer aligned for the events read into it */
+	union {
+		struct inotify_event event;
+		char buffer[4096];
+	} events;
+	struct inotify_event *event = NULL;
+	ssize_t length = 0;
+	ssize_t offset = 0;
+	uint32_t i = 0;
+	while ((length = read(watcher->inotify_fd, events.buffer, sizeof(events.buffer))) > 0) {
+		offset = 0;
+		while (offset < length) {
+			event = (struct inotify_event *)(events.buffer + offset);
+			i = 0;
+			while (event->len > 0 && i < watcher->directories_count) {
+				if (watcher->directory_descriptors[i] == event->wd) {
+					gfw_shader_watcher_mark(watcher, watcher->directories[i], event->name);
+				}
+				i++;
+			}
+			offset = offset + sizeof(struct inotify_event) + event->len;
+		}
+	}
+}
+
+struct gfw_shader_watcher_loader {
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t condition;
+	bool stopping;
+};
+
+/* Reads and preprocesses changed files on its own thread, so the frame loop only compiles */
+static void *gfw_shader_watcher_load(void *argument)
+{
+	struct gfw_shader_watcher *watcher = argument;
+	struct gfw_shader_watcher_loader *loader = watcher->loader;
+	char *paths[3] = {NULL};
+	char *sources[3] = {NULL};
+	uint32_t i = 0;
+	uint32_t j = 0;
+	pthread_mutex_lock(&loader->mutex);
+	while (true) {
+		i = 0;
+		while (i < watcher->watches_count && !(watcher->watches[i].changed && !watcher->watches[i].loaded)) {
+			i++;
+		}
+		if (i == watcher->watches_count) {
+			if (loader->stopping) {
+				break;
+			}
+			pthread_cond_wait(&loader->condition, &loader->mutex);
+			continue;
+		}
+		/* Paths are never freed while the watcher runs, only the array holding them can move */
+		watcher->watches[i].changed = false;
+		memcpy(paths, watcher->watches[i].paths, sizeof(paths));
+		pthread_mutex_unlock(&loader->mutex);
+		j = 0;
+		while (j < 3) {
+			sources[j] = paths[j] ? gfw_shader_load(paths[j], watcher->include_directory) : NULL;
+			j++;
+		}
+		pthread_mutex_lock(&loader->mutex);
+		/* A file caught in the middle of being saved shows up again with the next event */
+		if (sources[0] && sources[2] && (!paths[1] || sources[1])) {
+			memcpy(watcher->watches[i].sources, sources, sizeof(sources));
+			watcher->watches[i].loaded = true;
+		} else {
+			free(sources[0]);
+			free(sources[1]);
+			free(sources[2]);
+		}
+	}
+	pthread_mutex_unlock(&loader->mutex);
+	return NULL;
+}
+
+/* Takes the sources, the loader may already fill the watch with newer ones */
+static void gfw_shader_watcher_submit(struct gfw_shader_watch *watch, char **sources)
+{
+	gfw_init_shader_async(&watch->pending, sources[0], sources[1], sources[2]);
+	gfw_set_debug_label(GFW_DEBUG_OBJECT_PROGRAM, watch->pending.program_gl_id, watch->paths[2]);
+	watch->reloading = true;
+	free(sources[0]);
+	free(sources[1]);
+	free(sources[2]);
+}
+
+static void gfw_shader_watcher_swap(struct gfw_shader_watch *watch)
+{
+	struct gfw_shader previous = *watch->shader;
+	struct gfw_shader_variable *variable = NULL;
+	struct gfw_shader_variable *previous_variable = NULL;
+	struct gfw_shader_uniform *uniform = NULL;
+	struct gfw_shader_uniform *previous_uniform = NULL;
+	uint32_t count = 0;
+	uint32_t i = 0;
+	/* The program and its tables change in place, so pointers to the shader stay valid */
+	*watch->shader = watch->pending;
+	watch->pending = previous;
+	/* Uniform values set on the old program carry over to matching uniforms of the new one */
+	while (watch->shader->uniform_slots && previous.uniform_slots && i < watch->shader->variables_capacity) {
+		variable = &watch->shader->variables[i];
+		if (variable->kind == GFW_SHADER_VARIABLE_UNIFORM && (uint32_t)variable->location < watch->shader->uniform_slots_count
+			&& watch->shader->uniform_slots[variable->location] >= 0) {
+			previous_variable = gfw_shader_find_named_variable(&previous, GFW_SHADER_VARIABLE_UNIFORM, variable->name);
+		} else {
+			previous_variable = NULL;
+		}
+		if (previous_variable && previous_variable->type == variable->type
+			&& (uint32_t)previous_variable->location < previous.uniform_slots_count
+			&& previous.uniform_slots[previous_variable->location] >= 0) {
+			uniform = &watch->shader->uniforms[watch->shader->uniform_slots[variable->location]];
+			previous_uniform = &previous.uniforms[previous.uniform_slots[previous_variable->location]];
+			count = uniform->size < previous_uniform->size ? uniform->size : previous_uniform->size;
+			memcpy(watch->shader->uniform_storage + uniform->offset,
+				previous.uniform_storage + previous_uniform->offset,
+				count * uniform->element_size);
+			uniform->transpose = previous_uniform->transpose;
+			if (!uniform->dirty) {
+				uniform->dirty = true;
+				watch->shader->dirty_uniforms[watch->shader->dirty_uniforms_count] = watch->shader->uniform_slots[variable->location];
+				watch->shader->dirty_uniforms_count = watch->shader->dirty_uniforms_count + 1;
+			}
+			uniform->dirty_first = 0;
+			uniform->dirty_last = count;
+		}
+		i++;
+	}
+	/* The new program is used first, so the carried values reach it through the plain setters */
+	if (gfw_current_shader == watch->shader && gfw_program_in_use) {
+		glUseProgram(watch->shader->program_gl_id);
+	}
+	gfw_shader_flush_uniforms(watch->shader);
+	gfw_update_handle(GFW_HANDLE_TYPE_SHADER, watch->shader, watch->shader->program_gl_id, 0);
+	/* The old program now lives in the pending slot and is released from there */
+	gfw_free_shader(&watch->pending);
+}
+
+size_t gfw_shader_watcher_poll(struct gfw_shader_watcher *watcher)
+{
+	struct gfw_shader_watch *watch = NULL;
+	enum gfw_shader_status status = GFW_SHADER_STATUS_PENDING;
+	char *sources[3] = {NULL};
+	bool loaded = false;
+	size_t swapped = 0;
+	uint32_t i = 0;
+	if (!watcher->loader) {
+		return 0;
+	}
+	pthread_mutex_lock(&watcher->loader->mutex);
+	gfw_shader_watcher_read_events(watcher);
+	pthread_cond_signal(&watcher->loader->condition);
+	pthread_mutex_unlock(&watcher->loader->mutex);
+	/* The loader only touches the sources, so GL work runs without holding it up */
+	while (i < watcher->watches_count) {
+		watch = &watcher->watches[i];
+		if (watch->reloading) {
+			status = gfw_shader_poll(&watch->pending);
+			if (status == GFW_SHADER_STATUS_READY) {
+				/* The old program is only replaced once the new one linked */
+				gfw_shader_watcher_swap(watch);
+				watch->reloading = false;
+				watcher->reloads = watcher->reloads + 1;
+				swapped++;
+			} else if (status == GFW_SHADER_STATUS_FAILED) {
+				gfw_free_shader(&watch->pending);
+				watch->reloading = false;
+				watcher->failures = watcher->failures + 1;
+			}
+		}
+		if (!watch->reloading) {
+			pthread_mutex_lock(&watcher->loader->mutex);
+			loaded = watch->loaded;
+			if (loaded) {
+				memcpy(sources, watch->sources, sizeof(sources));
+				memset(watch->sources, 0, sizeof(watch->sources));
+				watch->loaded = false;
+			}
+			pthread_mutex_unlock(&watcher->loader->mutex);
+			if (loaded) {
+				gfw_shader_watcher_submit(watch, sources);
+			}
+		}
+		i++;
+	}
+	return swapped;
+}
+#else
+size_t gfw_shader_watcher_poll(struct gfw_shader_watcher *watcher)
+{
+	(void)watcher;
+	return 0;
+}
+#endif
+
+bool gfw_shader_watcher_add(struct gfw_shader_watcher *watcher, struct gfw_shader *shader, char *vertex_path, char *geometry_path, char *fragment_path)
+{
+	bool success = true;
+#ifdef __linux__
+	struct gfw_shader_watch *watches = NULL;
+	struct gfw_shader_watch *watch = NULL;
+	char *paths[3] = {vertex_path, geometry_path, fragment_path};
+	char *separator = NULL;
+	uint32_t i = 0;
+	if (!watcher->loader) {
+		success = false;
+		goto done;
+	}
+	/* The loader walks the watches, so the array only grows under the lock */
+	pthread_mutex_lock(&watcher->loader->mutex);
+	if (watcher->watches_count >= watcher->watches_capacity) {
+		watches = realloc(watcher->watches, (watcher->watches_capacity * 2 + 4) * sizeof(*watches));
+		if (!watches) {
+			success = false;
+			goto unlock;
+		}
+		watcher->watches = watches;
+		watcher->watches_capacity = watcher->watches_capacity * 2 + 4;
+	}
+	watch = &watcher->watches[watcher->watches_count];
+	memset(watch, 0, sizeof(*watch));
+	watch->shader = shader;
+	while (i < 3) {
+		if (paths[i]) {
+			separator = strrchr(paths[i], '/');
+			watch->paths[i] = gfw_copy_string(paths[i]);
+			if (!watch->paths[i]
+				|| !gfw_shader_watcher_watch_directory(watcher, paths[i], separator ? (size_t)(separator - paths[i]) : 0)) {
+				success = false;
+			}
+		}
+		i++;
+	}
+	if (!success) {
+		free(watch->paths[0]);
+		free(watch->paths[1]);
+		free(watch->paths[2]);
+		goto unlock;
+	}
+	watcher->watches_count = watcher->watches_count + 1;
+unlock:
+	pthread_mutex_unlock(&watcher->loader->mutex);
+done:
+#else
+	(void)watcher;
+	(void)shader;
+	(void)vertex_path;
+	(void)geometry_path;
+	(void)fragment_path;
+	success = false;
+#endif
+	return success;
+}
+
+void gfw_free_shader_watcher(struct gfw_shader_watcher *watcher)
+{
+	uint32_t i = 0;
+#ifdef __linux__
+	if (watcher->loader) {
+		pthread_mutex_lock(&watcher->loader->mutex);
+		watcher->loader->stopping = true;
+		pthread_cond_signal(&watcher->loader->condition);
+		pthread_mutex_unlock(&watcher->loader->mutex);
+		pthread_join(watcher->loader->thread, NULL);
+		pthread_mutex_destroy(&watcher->loader->mutex);
+		pthread_cond_destroy(&watcher->loader->condition);
+		free(watcher->loader);
+		watcher->loader = NULL;
+	}
+#endif
+	while (i < watcher->watches_count) {
+		if (watcher->watches[i].reloading) {
+			gfw_free_shader(&watcher->watches[i].pending);
+		}
+		free(watcher->watches[i].sources[0]);
+		free(watcher->watches[i].sources[1]);
+		free(watcher->watches[i].sources[2]);
+		free(watcher->watches[i].paths[0]);
+		free(watcher->watches[i].paths[1]);
+		free(watcher->watches[i].paths[2]);
+		i++;
+	}
+	i = 0;
+	while (i < watcher->directories_count) {
+		free(watcher->directories[i]);
+		watcher->directories[i] = NULL;
+		i++;
+	}
+#ifdef __linux__
+	if (watcher->inotify_fd >= 0) {
+		close(watcher->inotify_fd);
+	}
+#endif
+	free(watcher->watches);
+	free(watcher->include_directory);
+	watcher->inotify_fd = -1;
+	watcher->directories_count = 0;
+	watcher->include_directory = NULL;
+	watcher->watches = NULL;
+	watcher->watches_count = 0;
+	watcher->watches_capacity = 0;
+}
+
+bool gfw_init_shader_watcher(struct gfw_shader_watcher *watcher, char *include_directory)
+{
+	bool success = true;
+	watcher->inotify_fd = -1;
+	watcher->directories_count = 0;
+	watcher->include_directory = NULL;
+	watcher->watches = NULL;
+	watcher->watches_count = 0;
+	watcher->watches_capacity = 0;
+	watcher->reloads = 0;
+	watcher->failures = 0;
+	watcher->loader = NULL;
+#ifdef __linux__
+	/* Events are read without blocking from the frame loop */
+	watcher->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (watcher->inotify_fd < 0) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to initialize shader watcher.\n");
+#endif
+		goto done;
+	}
+	if (include_directory) {
+		watcher->include_directory = gfw_copy_string(include_directory);
+		if (!watcher->include_directory
+			|| !gfw_shader_watcher_watch_directory(watcher, include_directory, strlen(include_directory))) {
+			success = false;
+			gfw_free_shader_watcher(watcher);
+			goto done;
+		}
+	}
+	watcher->loader = calloc(1, sizeof(*watcher->loader));
+	if (!watcher->loader) {
+		success = false;
+		gfw_free_shader_watcher(watcher);
+		goto done;
+	}
+	pthread_mutex_init(&watcher->loader->mutex, NULL);
+	pthread_cond_init(&watcher->loader->condition, NULL);
+	if (pthread_create(&watcher->loader->thread, NULL, gfw_shader_watcher_load, watcher) != 0) {
+		success = false;
+		pthread_mutex_destroy(&watcher->loader->mutex);
+		pthread_cond_destroy(&watcher->loader->condition);
+		free(watcher->loader);
+		watcher->loader = NULL;
+		gfw_free_shader_watcher(watcher);
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to start shader watcher loader.\n");
+#endif
+		goto done;
+	}
+done:
+#else
+	(void)include_directory;
+	success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+	printf("Error: failed to initialize shader watcher, not supported on this platform.\n");
+#endif
+#endif
+	return success;
+}
+
+/* Graphic state */
+#define GFW_STATE_VIEWPORT (1u << 0)
+#define GFW_STATE_BLEND (1u << 1)
+#define GFW_STATE_CLIP_DISTANCE (1u << 2)
+#define GFW_STATE_COLOR_LOGIC_OPERATION (1u << 3)
+#define GFW_STATE_CULL_FACE (1u << 4)
+#define GFW_STATE_DEPTH_CLAMP (1u << 5)
+#define GFW_STATE_DEPTH_TEST (1u << 6)
+#define GFW_STATE_DITHER (1u << 7)
+#define GFW_STATE_LINE_SMOOTH (1u << 8)
+#define GFW_STATE_BLEND_EQUATION (1u << 9)
+#define GFW_STATE_BLEND_FUNCTION (1u << 10)
+#define GFW_STATE_BLEND_COLOR (1u << 11)
+#define GFW_STATE_COLOR_LOGIC_OPERATION_MODE (1u << 12)
+#define GFW_STATE_CULL_FACE_MODE (1u << 13)
+#define GFW_STATE_FRONT_FACE (1u << 14)
+#define GFW_STATE_DEPTH_TEST_FUNCTION (1u << 15)
+#define GFW_STATE_DEPTH_RANGE (1u << 16)
+#define GFW_STATE_POINT_SIZE (1u << 17)
+#define GFW_STATE_LINE_WIDTH (1u << 18)
+#define GFW_STATE_RASTERIZER_DISCARD (1u << 19)
+#define GFW_STATE_ALL ((1u << 20) - 1)
+#define GFW_STATE_MAX_CLIP_DISTANCES 32
+
+struct gfw_render_state {
+	int32_t viewport[4];
+	bool blend;
+	uint32_t clip_distances;
+	bool color_logic_operation;
+	bool cull_face;
+	bool depth_clamp;
+	bool depth_test;
+	bool dither;
+	bool line_smooth;
+	enum gfw_blend_equation blend_equation_rgb;
+	enum gfw_blend_equation blend_equation_alpha;
+	enum gfw_blend_factor blend_factor_source_rgb;
+	enum gfw_blend_factor blend_factor_destination_rgb;
+	enum gfw_blend_factor blend_factor_source_alpha;
+	enum gfw_blend_factor blend_factor_destination_alpha;
+	gfw_float_t blend_color[4];
+	enum gfw_color_logic_operation color_logic_operation_mode;
+	enum gfw_cull_face_mode cull_face_mode;
+	enum gfw_cull_face_front front_face;
+	enum gfw_depth_test_function depth_test_function;
+	gfw_float_t depth_range[2];
+	gfw_float_t point_size;
+	gfw_float_t line_width;
+	bool rasterizer_discard;
+};
+
+/* Initial values of a new context, the viewport depends on the surface */
+static struct gfw_render_state gfw_requested_state = {
+	{0, 0, 0, 0},
+	false,
+	0,
+	false,
+	false,
+	false,
+	false,
+	true,
+	false,
+	GFW_BLEND_EQUATION_ADD,
+	GFW_BLEND_EQUATION_ADD,
+	GFW_BLEND_FACTOR_ONE,
+	GFW_BLEND_FACTOR_ZERO,
+	GFW_BLEND_FACTOR_ONE,
+	GFW_BLEND_FACTOR_ZERO,
+	{0.0f, 0.0f, 0.0f, 0.0f},
+	GFW_COLOR_LOGIC_OPERATION_COPY,
+	GFW_CULL_FACE_BACK,
+	GFW_CULL_FACE_FRONT_CCW,
+	GFW_DEPTH_TEST_FUNCTION_LESS,
+	{0.0f, 1.0f},
+	1.0f,
+	1.0f,
+	false
+};
+static struct gfw_render_state gfw_applied_state = {
+	{0, 0, 0, 0},
+	false,
+	0,
+	false,
+	false,
+	false,
+	false,
+	true,
+	false,
+	GFW_BLEND_EQUATION_ADD,
+	GFW_BLEND_EQUATION_ADD,
+	GFW_BLEND_FACTOR_ONE,
+	GFW_BLEND_FACTOR_ZERO,
+	GFW_BLEND_FACTOR_ONE,
+	GFW_BLEND_FACTOR_ZERO,
+	{0.0f, 0.0f, 0.0f, 0.0f},
+	GFW_COLOR_LOGIC_OPERATION_COPY,
+	GFW_CULL_FACE_BACK,
+	GFW_CULL_FACE_FRONT_CCW,
+	GFW_DEPTH_TEST_FUNCTION_LESS,
+	{0.0f, 1.0f},
+	1.0f,
+	1.0f,
+	false
+};
+static uint32_t gfw_state_dirty = 0;
+/* States whose applied value is not known and have to be emitted */
+static uint32_t gfw_state_unknown = GFW_STATE_VIEWPORT;
+static bool gfw_viewport_requested = false;
+
+static struct gfw_pipeline_state *gfw_current_pipeline_state = NULL;
+
+/* Individual changes mean the current pipeline state no longer describes the state */
+static void gfw_mark_state(uint32_t state)
+{
+	gfw_state_dirty = gfw_state_dirty | state;
+	gfw_current_pipeline_state = NULL;
+}
+
+static void gfw_apply_capability(GLenum capability, bool enabled)
+{
+	if (enabled) {
+		glEnable(capability);
+	} else {
+		glDisable(capability);
+	}
+}
+
+static void gfw_check_state_error(char *state)
+{
+	(void)state;
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to set %s state.\n", state);
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+}
+
+/* The limit is queried once, the mask holds at most 32 clip distances */
+static uint32_t gfw_get_max_clip_distances(void)
+{
+	static uint32_t max_clip_distances = 0;
+	GLint value = 0;
+	if (max_clip_distances == 0) {
+		glGetIntegerv(GL_MAX_CLIP_DISTANCES, &value);
+		max_clip_distances = value > 0 ? (uint32_t)value : 8;
+		if (max_clip_distances > GFW_STATE_MAX_CLIP_DISTANCES) {
+			max_clip_distances = GFW_STATE_MAX_CLIP_DISTANCES;
+		}
+	}
+	return max_clip_distances;
+}
+
+static bool gfw_state_differs(uint32_t state, bool differs)
+{
+	return (gfw_state_unknown & state) || differs;
+}
+
+void gfw_flush_state(void)
+{
+	struct gfw_render_state *requested = &gfw_requested_state;
+	struct gfw_render_state *applied = &gfw_applied_state;
+	uint32_t dirty = gfw_state_dirty;
+	uint32_t i = 0;
+	if (!dirty) {
+		return;
+	}
+#ifdef GFW_TRACE
+	if (gfw_trace_file) {
+		gfw_trace_state();
+	}
+#endif
+	if ((dirty & GFW_STATE_VIEWPORT) && gfw_viewport_requested
+		&& gfw_state_differs(GFW_STATE_VIEWPORT, memcmp(requested->viewport, applied->viewport, sizeof(requested->viewport)) != 0)) {
+		glViewport(requested->viewport[0], requested->viewport[1], requested->viewport[2], requested->viewport[3]);
+		GFW_COUNT_STATISTIC(GFW_STATISTIC_STATE_CHANGES, 1);
+		gfw_check_state_error("viewport");
+	}
+	if ((dirty & GFW_STATE_BLEND) && gfw_state_differs(GFW_STATE_BLEND, requested->blend != applied->blend)) {
+		gfw_apply_capability(GL_BLEND, requested->blend);
+		GFW_COUNT_STATISTIC(GFW_STATISTIC_STATE_CHANGES, 1);
+		gfw_check_state_error("blend");
+	}
+	if ((dirty & GFW_STATE_CLIP_DISTANCE)
+		&& gfw_state_differs(GFW_STATE_CLIP_DISTANCE, requested->clip_distances != applied->clip_distances)) {
+		while (i < gfw_get_max_clip_distances()) {
+			if ((gfw_state_unknown & GFW_STATE_CLIP_DISTANCE)
+				|| ((requested->clip_distances ^ applied->clip_distances) & (1u << i))) {
+				gfw_apply_capability(GL_CLIP_DISTANCE0 + i, (requested->clip_distances & (1u << i)) != 0);
+				GFW_COUNT_STATISTIC(GFW_STATISTIC_STATE_CHANGES, 1);
+				gfw_check_state_error("clip distance");
+			}
+			i++;
+		}
+	}
+	if ((dirty & GFW_STATE_COLOR_LOGIC_OPERATION)
+		&& gfw_state_differs(GFW_STATE_COLOR_LOGIC_OPERATION, requested->color_logic_operation != applied->color_logic_operation)) {
+		gfw_apply_capability(GL_COLOR_LOGIC_OP, requested->color_logic_operation);
+		GFW_COUNT_STATISTIC(GFW_STATISTIC_STATE_CHANGES, 1);
+		gfw_check_state_error("color logic operation");
+	}
+	if ((dirty & GFW_STATE_CULL_FACE) && gfw_state_differs(GFW_STATE_CULL_FACE, requested->cull_face != applied->cull_face)) {
+		gfw_apply_capability(GL_CULL_FACE, requested->cull_face);
+		GFW_COUNT_STATISTIC(GFW_STATISTIC_STATE_CHANGES, 1);
+		gfw_check_state_error("cull face");
+	}
+	if ((dirty & GFW_STATE_DEPTH_CLAMP) && gfw_state_differs(GFW_STATE_DEPTH_CLAMP, requested->depth_clamp != applied->depth_clamp)) {
+		gfw_apply_capability(GL_DEPTH_CLAMP, requested->depth_clamp);
+		GFW_COUNT_STATISTIC(GFW_STATISTIC_STATE_CHANGES, 1);
+		gfw_check_state_error("depth clamp");
+	}
+	if ((dirty & GFW_STATE_DEPTH_TEST) && gfw_state_differs(GFW_STATE_DEPTH_TEST, requested->depth_test != applied->depth_test)) {
+		gfw_apply_capability(GL_DEPTH_TEST, requested->depth_test);
+		GFW_COUNT_STATISTIC(GFW_STATISTIC_STATE_CHANGES, 1);
+		gfw_check_state_error("depth test");
+	}
+	if ((dirty & GFW_STATE_DITHER) && gfw_state_differs(GFW_STATE_DITHER, requested->dither != applied->dither)) {
+		gfw_apply_capability(GL_DITHER, requested->dither);
+		GFW_COUNT_STATISTIC(GFW_STATISTIC_STATE_CHANGES, 1);
+		gfw_check_state_error("dither");
+	}
+	if ((dirty & GFW_STATE_LINE_SMOOTH) && gfw_state_differs(GFW_STATE_LINE_SMOOTH, requested->line_smooth != applied->line_smooth)) {
+		gfw_apply_capability(GL_LINE_SMOOTH, requested->line_smooth);
+		GFW_COUNT_STATISTIC(GFW_STATISTIC_STATE_CHANGES, 1);
+		gfw_check_state_error("line smooth");
+	}
+	if ((dirty & GFW_STATE_BLEND_EQUATION)
+		&& gfw_state_differs(GFW_STATE_BLEND_EQUATION,
+			requested->blend_equation_rgb != applied->blend_equation_rgb
+			|| requested->blend_equation_alpha != applied->blend_equation_alpha)) {
+		glBlendEquationSeparate(requested->blend_equation_rgb, requested->blend_equation_alpha);
+		GFW_COUNT_STATISTIC(GFW_STATISTIC_STATE_CHANGES, 1);
+		gfw_check_state_error("blend equation");
+	}
+	if ((dirty & GFW_STATE_BLEND_FUNCTION)
+		&& gfw_state_differs(GFW_STATE_BLEND_FUNCTION,
+			requested->blend_factor_source_rgb != applied->blend_factor_source_rgb
+			|| requested->blend_factor_destination_rgb != applied->blend_factor_destination_rgb
+			|| requested->blend_factor_source_alpha != applied->blend_factor_source_alpha
+			|| requested->blend_factor_destination_alpha != applied->blend_factor_destination_alpha)) {
+		glBlendFuncSeparate(requested->blend_factor_source_rgb,
+			requested->blend_factor_destination_rgb,
+			requested->blend_factor_source_alpha,
+			requested->blend_factor_destination_alpha);
+		GFW_COUNT_STATISTIC(GFW_STATISTIC_STATE_CHANGES, 1);
+		gfw_check_state_error("blend function");
+	}
+	if ((dirty & GFW_STATE_BLEND_COLOR)
+		&& gfw_state_differs(GFW_STATE_BLEND_COLOR, memcmp(requested->blend_color, applied->blend_color, sizeof(requested->blend_color)) != 0)) {
+		glBlendColor(requested->blend_color[0], requested->blend_color[1], requested->blend_color[2], requested->blend_color[3]);
+		GFW_COUNT_STATISTIC(GFW_STATISTIC_STATE_CHANGES, 1);
+		gfw_check_state_error("blend color");
+	}
+	if ((dirty & GFW_STATE_COLOR_LOGIC_OPERATION_MODE)
+		&& gfw_state_differs(GFW_STATE_COLOR_LOGIC_OPERATION_MODE,
+			requested->color_logic_operation_mode != applied->color_logic_operation_mode)) {
+		glLogicOp(requested->color_logic_operation_mode);
+		GFW_COUNT_STATISTIC(GFW_STATISTIC_STATE_CHANGES, 1);
+		gfw_check_state_error("color logic operation mode");
+	}
+	if ((dirty & GFW_STATE_CULL_FACE_MODE)
+		&& gfw_state_differs(GFW_STATE_CULL_FACE_MODE, requested->cull_face_mode != applied->cull_face_mode)) {
+		glCullFace(requested->cull_face_mode);
+		GFW_COUNT_STATISTIC(GFW_STATISTIC_STATE_CHANGES, 1);
+		gfw_check_state_error("cull face mode");
+	}
+	if ((dirty & GFW_STATE_FRONT_FACE) && gfw_state_differs(GFW_STATE_FRONT_FACE, requested->front_face != applied->front_face)) {
+		glFrontFace(requested->front_face);
+		GFW_COUNT_STATISTIC(GFW_STATISTIC_STATE_CHANGES, 1);
+		gfw_check_state_error("front face");
+	}
+	if ((dirty & GFW_STATE_DEPTH_TEST_FUNCTION)
+		&& gfw_state_differs(GFW_STATE_DEPTH_TEST_FUNCTION, requested->depth_test_function != applied->depth_test_function)) {
+		glDepthFunc(requested->depth_test_function);
+		GFW_COUNT_STATISTIC(GFW_STATISTIC_STATE_CHANGES, 1);
+		gfw_check_state_error("depth test function");
+	}
+	if ((dirty & GFW_STATE_DEPTH_RANGE)
+		&& gfw_state_differs(GFW_STATE_DEPTH_RANGE, memcmp(requested->depth_range, applied->depth_range, sizeof(requested->depth_range)) != 0)) {
+		glDepthRange(requested->depth_range[0], requested->depth_range[1]);
+		GFW_COUNT_STATISTIC(GFW_STATISTIC_STATE_CHANGES, 1);
+		gfw_check_state_error("depth range");
+	}
+	if ((dirty & GFW_STATE_POINT_SIZE) && gfw_state_differs(GFW_STATE_POINT_SIZE, requested->point_size != applied->point_size)) {
+		glPointSize(requested->point_size);
+		GFW_COUNT_STATISTIC(GFW_STATISTIC_STATE_CHANGES, 1);
+		gfw_check_state_error("point size");
+	}
+	if ((dirty & GFW_STATE_LINE_WIDTH) && gfw_state_differs(GFW_STATE_LINE_WIDTH, requested->line_width != applied->line_width)) {
+		glLineWidth(requested->line_width);
+		GFW_COUNT_STATISTIC(GFW_STATISTIC_STATE_CHANGES, 1);
+		gfw_check_state_error("line width");
+	}
+	if ((dirty & GFW_STATE_RASTERIZER_DISCARD)
+		&& gfw_state_differs(GFW_STATE_RASTERIZER_DISCARD, requested->rasterizer_discard != applied->rasterizer_discard)) {
+		gfw_apply_capability(GL_RASTERIZER_DISCARD, requested->rasterizer_discard);
+		GFW_COUNT_STATISTIC(GFW_STATISTIC_STATE_CHANGES, 1);
+		gfw_check_state_error("rasterizer discard");
+	}
+	*applied = *requested;
+	if (!gfw_viewport_requested) {
+		dirty = dirty & ~GFW_STATE_VIEWPORT;
+	}
+	gfw_state_unknown = gfw_state_unknown & ~dirty;
+	gfw_state_dirty = 0;
+}
+
+void gfw_invalidate_state(void)
+{
+	gfw_current_pipeline_state = NULL;
+	gfw_state_unknown = GFW_STATE_ALL;
+	gfw_state_dirty = GFW_STATE_ALL;
+}
+
+void gfw_resync_state(void)
+{
+	struct gfw_render_state *applied = &gfw_applied_state;
+	GLint values[4] = {0};
+	uint32_t i = 0;
+	glGetIntegerv(GL_VIEWPORT, values);
+	applied->viewport[0] = values[0];
+	applied->viewport[1] = values[1];
+	applied->viewport[2] = values[2];
+	applied->viewport[3] = values[3];
+	applied->blend = glIsEnabled(GL_BLEND);
+	applied->clip_distances = 0;
+	while (i < gfw_get_max_clip_distances()) {
+		if (glIsEnabled(GL_CLIP_DISTANCE0 + i)) {
+			applied->clip_distances = applied->clip_distances | (1u << i);
+		}
+		i++;
+	}
+	applied->color_logic_operation = glIsEnabled(GL_COLOR_LOGIC_OP);
+	applied->cull_face = glIsEnabled(GL_CULL_FACE);
+	applied->depth_clamp = glIsEnabled(GL_DEPTH_CLAMP);
+	applied->depth_test = glIsEnabled(GL_DEPTH_TEST);
+	applied->dither = glIsEnabled(GL_DITHER);
+	applied->line_smooth = glIsEnabled(GL_LINE_SMOOTH);
+	glGetIntegerv(GL_BLEND_EQUATION_RGB, values);
+	applied->blend_equation_rgb = values[0];
+	glGetIntegerv(GL_BLEND_EQUATION_ALPHA, values);
+	applied->blend_equation_alpha = values[0];
+	glGetIntegerv(GL_BLEND_SRC_RGB, values);
+	applied->blend_factor_source_rgb = values[0];
+	glGetIntegerv(GL_BLEND_DST_RGB, values);
+	applied->blend_factor_destination_rgb = values[0];
+	glGetIntegerv(GL_BLEND_SRC_ALPHA, values);
+	applied->blend_factor_source_alpha = values[0];
+	glGetIntegerv(GL_BLEND_DST_ALPHA, values);
+	applied->blend_factor_destination_alpha = values[0];
+	glGetFloatv(GL_BLEND_COLOR, applied->blend_color);
+	glGetIntegerv(GL_LOGIC_OP_MODE, values);
+	applied->color_logic_operation_mode = values[0];
+	glGetIntegerv(GL_CULL_FACE_MODE, values);
+	applied->cull_face_mode = values[0];
+	glGetIntegerv(GL_FRONT_FACE, values);
+	applied->front_face = values[0];
+	glGetIntegerv(GL_DEPTH_FUNC, values);
+	applied->depth_test_function = values[0];
+	glGetFloatv(GL_DEPTH_RANGE, applied->depth_range);
+	glGetFloatv(GL_POINT_SIZE, &applied->point_size);
+	glGetFloatv(GL_LINE_WIDTH, &applied->line_width);
+	applied->rasterizer_discard = glIsEnabled(GL_RASTERIZER_DISCARD);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to read graphic state.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+	/* Requested values are kept and emitted again where they differ */
+	gfw_current_pipeline_state = NULL;
+	gfw_state_unknown = 0;
+	gfw_state_dirty = GFW_STATE_ALL;
+}
+
+void gfw_set_viewport(int32_t x, int32_t y, uint32_t width, uint32_t height)
+{
+	gfw_requested_state.viewport[0] = x;
+	gfw_requested_state.viewport[1] = y;
+	gfw_requested_state.viewport[2] = width;
+	gfw_requested_state.viewport[3] = height;
+	gfw_viewport_requested = true;
+	gfw_mark_state(GFW_STATE_VIEWPORT);
+}
+
+void gfw_enable_blend(void)
+{
+	gfw_requested_state.blend = true;
+	gfw_mark_state(GFW_STATE_BLEND);
+}
+
+void gfw_disable_blend(void)
+{
+	gfw_requested_state.blend = false;
+	gfw_mark_state(GFW_STATE_BLEND);
+}
+
+void gfw_enable_clip_distance(uint32_t i)
+{
+	if (i >= gfw_get_max_clip_distances()) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to enable clip distance in space %u.\n", i);
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+		return;
+	}
+	gfw_requested_state.clip_distances = gfw_requested_state.clip_distances | (1u << i);
+	gfw_mark_state(GFW_STATE_CLIP_DISTANCE);
+}
+
+void gfw_disable_clip_distance(uint32_t i)
+{
+	if (i >= gfw_get_max_clip_distances()) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to disable clip distance in space %u.\n", i);
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+		return;
+	}
+	gfw_requested_state.clip_distances = gfw_requested_state.clip_distances & ~(1u << i);
+	gfw_mark_state(GFW_STATE_CLIP_DISTANCE);
+}
+
+void gfw_enable_color_logic_operation(void)
+{
+	gfw_requested_state.color_logic_operation = true;
+	gfw_mark_state(GFW_STATE_COLOR_LOGIC_OPERATION);
+}
+
+void gfw_disable_color_logic_operation(void)
+{
+	gfw_requested_state.color_logic_operation = false;
+	gfw_mark_state(GFW_STATE_COLOR_LOGIC_OPERATION);
+}
+
+void gfw_enable_cull_face(void)
+{
+	gfw_requested_state.cull_face = true;
+	gfw_mark_state(GFW_STATE_CULL_FACE);
+}
+
+void gfw_disable_cull_face(void)
+{
+	gfw_requested_state.cull_face = false;
+	gfw_mark_state(GFW_STATE_CULL_FACE);
+}
+
+void gfw_enable_depth_clamp(void)
+{
+	gfw_requested_state.depth_clamp = true;
+	gfw_mark_state(GFW_STATE_DEPTH_CLAMP);
+}
+
+void gfw_disable_depth_clamp(void)
+{
+	gfw_requested_state.depth_clamp = false;
+	gfw_mark_state(GFW_STATE_DEPTH_CLAMP);
+}
+
+void gfw_enable_depth_test(void)
+{
+	gfw_requested_state.depth_test = true;
+	gfw_mark_state(GFW_STATE_DEPTH_TEST);
+}
+
+void gfw_disable_depth_test(void)
+{
+	gfw_requested_state.depth_test = false;
+	gfw_mark_state(GFW_STATE_DEPTH_TEST);
+}
+
+void gfw_enable_dither(void)
+{
+	gfw_requested_state.dither = true;
+	gfw_mark_state(GFW_STATE_DITHER);
+}
+
+void gfw_disable_dither(void)
+{
+	gfw_requested_state.dither = false;
+	gfw_mark_state(GFW_STATE_DITHER);
+}
+
+void gfw_enable_line_smooth(void)
+{
+	gfw_requested_state.line_smooth = true;
+	gfw_mark_state(GFW_STATE_LINE_SMOOTH);
+}
+
+void gfw_disable_line_smooth(void)
+{
+	gfw_requested_state.line_smooth = false;
+	gfw_mark_state(GFW_STATE_LINE_SMOOTH);
+}
+
+void gfw_enable_rasterizer_discard(void)
+{
+	gfw_requested_state.rasterizer_discard = true;
+	gfw_mark_state(GFW_STATE_RASTERIZER_DISCARD);
+}
+
+void gfw_disable_rasterizer_discard(void)
+{
+	gfw_requested_state.rasterizer_discard = false;
+	gfw_mark_state(GFW_STATE_RASTERIZER_DISCARD);
+}
+
+void gfw_set_blend_equation(enum gfw_blend_equation blend_equation_rgb, enum gfw_blend_equation blend_equation_alpha)
+{
+	gfw_requested_state.blend_equation_rgb = blend_equation_rgb;
+	gfw_requested_state.blend_equation_alpha = blend_equation_alpha;
+	gfw_mark_state(GFW_STATE_BLEND_EQUATION);
+}
+
+void gfw_set_blend_function(enum gfw_blend_factor blend_factor_source, enum gfw_blend_factor blend_factor_destination)
+{
+	gfw_set_blend_function_separate(blend_factor_source, blend_factor_destination, blend_factor_source, blend_factor_destination);
+}
+
+void gfw_set_blend_function_separate(enum gfw_blend_factor blend_factor_source_rgb, enum gfw_blend_factor blend_factor_destination_rgb, enum gfw_blend_factor blend_factor_source_alpha, enum gfw_blend_factor blend_factor_destination_alpha)
+{
+	gfw_requested_state.blend_factor_source_rgb = blend_factor_source_rgb;
+	gfw_requested_state.blend_factor_destination_rgb = blend_factor_destination_rgb;
+	gfw_requested_state.blend_factor_source_alpha = blend_factor_source_alpha;
+	gfw_requested_state.blend_factor_destination_alpha = blend_factor_destination_alpha;
+	gfw_mark_state(GFW_STATE_BLEND_FUNCTION);
+}
+
+void gfw_set_blend_color(gfw_float_t r, gfw_float_t g, gfw_float_t b, gfw_float_t a)
+{
+	gfw_requested_state.blend_color[0] = r;
+	gfw_requested_state.blend_color[1] = g;
+	gfw_requested_state.blend_color[2] = b;
+	gfw_requested_state.blend_color[3] = a;
+	gfw_mark_state(GFW_STATE_BLEND_COLOR);
+}
+
+void gfw_set_color_logic_operation(enum gfw_color_logic_operation color_logic_operation)
+{
+	gfw_requested_state.color_logic_operation_mode = color_logic_operation;
+	gfw_mark_state(GFW_STATE_COLOR_LOGIC_OPERATION_MODE);
+}
+
+void gfw_set_cull_face_mode(enum gfw_cull_face_mode cull_face_mode)
+{
+	gfw_requested_state.cull_face_mode = cull_face_mode;
+	gfw_mark_state(GFW_STATE_CULL_FACE_MODE);
+}
+
+void gfw_set_front_face(enum gfw_cull_face_front front_face)
+{
+	gfw_requested_state.front_face = front_face;
+	gfw_mark_state(GFW_STATE_FRONT_FACE);
+}
+
+void gfw_set_depth_test_function(enum gfw_depth_test_function depth_test_function)
+{
+	gfw_requested_state.depth_test_function = depth_test_function;
+	gfw_mark_state(GFW_STATE_DEPTH_TEST_FUNCTION);
+}
+
+void gfw_set_depth_range(gfw_float_t near, gfw_float_t far)
+{
+	gfw_requested_state.depth_range[0] = near;
+	gfw_requested_state.depth_range[1] = far;
+	gfw_mark_state(GFW_STATE_DEPTH_RANGE);
+}
+
+void gfw_set_point_size(gfw_float_t size)
+{
+	gfw_requested_state.point_size = size;
+	gfw_mark_state(GFW_STATE_POINT_SIZE);
+}
+
+void gfw_set_line_width(gfw_float_t width)
+{
+	gfw_requested_state.line_width = width;
+	gfw_mark_state(GFW_STATE_LINE_WIDTH);
+}
+
+/* Pipeline state */
+#define GFW_PIPELINE_STATE_VALUES 24
+
+static struct gfw_pipeline_state **gfw_pipeline_states = NULL;
+static uint32_t gfw_pipeline_states_capacity = 0;
+static uint32_t gfw_pipeline_states_count = 0;
+
+/* Fields are copied one by one so that padding never reaches the hash */
+static void gfw_pack_pipeline_state(struct gfw_pipeline_state_descriptor *descriptor, uint32_t *values)
+{
+	uint32_t i = 0;
+	uint32_t j = 0;
+	values[i] = descriptor->blend;
+	i++;
+	values[i] = descriptor->blend_equation_rgb;
+	i++;
+	values[i] = descriptor->blend_equation_alpha;
+	i++;
+	values[i] = descriptor->blend_factor_source_rgb;
+	i++;
+	values[i] = descriptor->blend_factor_destination_rgb;
+	i++;
+	values[i] = descriptor->blend_factor_source_alpha;
+	i++;
+	values[i] = descriptor->blend_factor_destination_alpha;
+	i++;
+	values[i] = descriptor->color_logic_operation;
+	i++;
+	values[i] = descriptor->color_logic_operation_mode;
+	i++;
+	values[i] = descriptor->cull_face;
+	i++;
+	values[i] = descriptor->cull_face_mode;
+	i++;
+	values[i] = descriptor->front_face;
+	i++;
+	values[i] = descriptor->depth_clamp;
+	i++;
+	values[i] = descriptor->depth_test;
+	i++;
+	values[i] = descriptor->depth_test_function;
+	i++;
+	values[i] = descriptor->dither;
+	i++;
+	values[i] = descriptor->line_smooth;
+	i++;
+	values[i] = descriptor->clip_distances;
+	i++;
+	memcpy(&values[i], &descriptor->point_size, sizeof(values[i]));
+	i++;
+	memcpy(&values[i], &descriptor->line_width, sizeof(values[i]));
+	i++;
+	while (j < 4) {
+		memcpy(&values[i], &descriptor->blend_color[j], sizeof(values[i]));
+		i++;
+		j++;
+	}
+}
+
+void gfw_pipeline_state_apply(struct gfw_pipeline_state *pipeline_state)
+{
+	struct gfw_pipeline_state_descriptor *descriptor = &pipeline_state->descriptor;
+	struct gfw_render_state *requested = &gfw_requested_state;
+	uint32_t dirty = 0;
+	if (pipeline_state == gfw_current_pipeline_state) {
+		return;
+	}
+	if (requested->blend != descriptor->blend) {
+		requested->blend = descriptor->blend;
+		dirty = dirty | GFW_STATE_BLEND;
+	}
+	if (requested->blend_equation_rgb != descriptor->blend_equation_rgb) {
+		requested->blend_equation_rgb = descriptor->blend_equation_rgb;
+		dirty = dirty | GFW_STATE_BLEND_EQUATION;
+	}
+	if (requested->blend_equation_alpha != descriptor->blend_equation_alpha) {
+		requested->blend_equation_alpha = descriptor->blend_equation_alpha;
+		dirty = dirty | GFW_STATE_BLEND_EQUATION;
+	}
+	if (requested->blend_factor_source_rgb != descriptor->blend_factor_source_rgb) {
+		requested->blend_factor_source_rgb = descriptor->blend_factor_source_rgb;
+		dirty = dirty | GFW_STATE_BLEND_FUNCTION;
+	}
+	if (requested->blend_factor_destination_rgb != descriptor->blend_factor_destination_rgb) {
+		requested->blend_factor_destination_rgb = descriptor->blend_factor_destination_rgb;
+		dirty = dirty | GFW_STATE_BLEND_FUNCTION;
+	}
+	if (requested->blend_factor_source_alpha != descriptor->blend_factor_source_alpha) {
+		requested->blend_factor_source_alpha = descriptor->blend_factor_source_alpha;
+		dirty = dirty | GFW_STATE_BLEND_FUNCTION;
+	}
+	if (requested->blend_factor_destination_alpha != descriptor->blend_factor_destination_alpha) {
+		requested->blend_factor_destination_alpha = descriptor->blend_factor_destination_alpha;
+		dirty = dirty | GFW_STATE_BLEND_FUNCTION;
+	}
+	if (requested->color_logic_operation != descriptor->color_logic_operation) {
+		requested->color_logic_operation = descriptor->color_logic_operation;
+		dirty = dirty | GFW_STATE_COLOR_LOGIC_OPERATION;
+	}
+	if (requested->color_logic_operation_mode != descriptor->color_logic_operation_mode) {
+		requested->color_logic_operation_mode = descriptor->color_logic_operation_mode;
+		dirty = dirty | GFW_STATE_COLOR_LOGIC_OPERATION_MODE;
+	}
+	if (requested->cull_face != descriptor->cull_face) {
+		requested->cull_face = descriptor->cull_face;
+		dirty = dirty | GFW_STATE_CULL_FACE;
+	}
+	if (requested->cull_face_mode != descriptor->cull_face_mode) {
+		requested->cull_face_mode = descriptor->cull_face_mode;
+		dirty = dirty | GFW_STATE_CULL_FACE_MODE;
+	}
+	if (requested->front_face != descriptor->front_face) {
+		requested->front_face = descriptor->front_face;
+		dirty = dirty | GFW_STATE_FRONT_FACE;
+	}
+	if (requested->depth_clamp != descriptor->depth_clamp) {
+		requested->depth_clamp = descriptor->depth_clamp;
+		dirty = dirty | GFW_STATE_DEPTH_CLAMP;
+	}
+	if (requested->depth_test != descriptor->depth_test) {
+		requested->depth_test = descriptor->depth_test;
+		dirty = dirty | GFW_STATE_DEPTH_TEST;
+	}
+	if (requested->depth_test_function != descriptor->depth_test_function) {
+		requested->depth_test_function = descriptor->depth_test_function;
+		dirty = dirty | GFW_STATE_DEPTH_TEST_FUNCTION;
+	}
+	if (requested->dither != descriptor->dither) {
+		requested->dither = descriptor->dither;
+		dirty = dirty | GFW_STATE_DITHER;
+	}
+	if (requested->line_smooth != descriptor->line_smooth) {
+		requested->line_smooth = descriptor->line_smooth;
+		dirty = dirty | GFW_STATE_LINE_SMOOTH;
+	}
+	if (requested->clip_distances != descriptor->clip_distances) {
+		requested->clip_distances = descriptor->clip_distances;
+		dirty = dirty | GFW_STATE_CLIP_DISTANCE;
+	}
+	if (requested->point_size != descriptor->point_size) {
+		requested->point_size = descriptor->point_size;
+		dirty = dirty | GFW_STATE_POINT_SIZE;
+	}
+	if (requested->line_width != descriptor->line_width) {
+		requested->line_width = descriptor->line_width;
+		dirty = dirty | GFW_STATE_LINE_WIDTH;
+	}
+	if (memcmp(requested->blend_color, descriptor->blend_color, sizeof(requested->blend_color)) != 0) {
+		memcpy(requested->blend_color, descriptor->blend_color, sizeof(requested->blend_color));
+		dirty = dirty | GFW_STATE_BLEND_COLOR;
+	}
+	gfw_state_dirty = gfw_state_dirty | dirty;
+	gfw_current_pipeline_state = pipeline_state;
+}
+
+static bool gfw_insert_pipeline_state(struct gfw_pipeline_state *pipeline_state)
+{
+	struct gfw_pipeline_state **old_states = gfw_pipeline_states;
+	uint32_t old_capacity = gfw_pipeline_states_capacity;
+	uint32_t capacity = old_capacity > 0 ? old_capacity : 16;
+	uint32_t mask = 0;
+	uint32_t i = 0;
+	if (2 * (gfw_pipeline_states_count + 1) > old_capacity) {
+		while (2 * (gfw_pipeline_states_count + 1) > capacity) {
+			capacity = capacity * 2;
+		}
+		gfw_pipeline_states = calloc(capacity, sizeof(*gfw_pipeline_states));
+		if (!gfw_pipeline_states) {
+			gfw_pipeline_states = old_states;
+			return false;
+		}
+		gfw_pipeline_states_capacity = capacity;
+		gfw_pipeline_states_count = 0;
+		while (i < old_capacity) {
+			if (old_states[i]) {
+				gfw_insert_pipeline_state(old_states[i]);
+			}
+			i++;
+		}
+		free(old_states);
+	}
+	mask = gfw_pipeline_states_capacity - 1;
+	i = pipeline_state->hash & mask;
+	while (gfw_pipeline_states[i]) {
+		i = (i + 1) & mask;
+	}
+	gfw_pipeline_states[i] = pipeline_state;
+	gfw_pipeline_states_count = gfw_pipeline_states_count + 1;
+	return true;
+}
+
+struct gfw_pipeline_state *gfw_get_pipeline_state(struct gfw_pipeline_state_descriptor descriptor)
+{
+	struct gfw_pipeline_state *pipeline_state = NULL;
+	uint32_t values[GFW_PIPELINE_STATE_VALUES] = {0};
+	uint32_t other_values[GFW_PIPELINE_STATE_VALUES] = {0};
+	uint32_t hash = 0;
+	uint32_t mask = gfw_pipeline_states_capacity - 1;
+	uint32_t i = 0;
+	gfw_pack_pipeline_state(&descriptor, values);
+	hash = gfw_hash(GFW_HASH_BASIS, values, sizeof(values));
+	i = hash & mask;
+	while (gfw_pipeline_states && gfw_pipeline_states[i]) {
+		if (gfw_pipeline_states[i]->hash == hash) {
+			gfw_pack_pipeline_state(&gfw_pipeline_states[i]->descriptor, other_values);
+			if (memcmp(values, other_values, sizeof(values)) == 0) {
+				return gfw_pipeline_states[i];
+			}
+		}
+		i = (i + 1) & mask;
+	}
+	pipeline_state = malloc(sizeof(*pipeline_state));
+	if (!pipeline_state) {
+		return NULL;
+	}
+	pipeline_state->descriptor = descriptor;
+	pipeline_state->hash = hash;
+	if (!gfw_insert_pipeline_state(pipeline_state)) {
+		free(pipeline_state);
+		return NULL;
+	}
+	return pipeline_state;
+}
+
+void gfw_get_default_pipeline_state_descriptor(struct gfw_pipeline_state_descriptor *descriptor)
+{
+	memset(descriptor, 0, sizeof(*descriptor));
+	descriptor->blend_equation_rgb = GFW_BLEND_EQUATION_ADD;
+	descriptor->blend_equation_alpha = GFW_BLEND_EQUATION_ADD;
+	descriptor->blend_factor_source_rgb = GFW_BLEND_FACTOR_ONE;
+	descriptor->blend_factor_destination_rgb = GFW_BLEND_FACTOR_ZERO;
+	descriptor->blend_factor_source_alpha = GFW_BLEND_FACTOR_ONE;
+	descriptor->blend_factor_destination_alpha = GFW_BLEND_FACTOR_ZERO;
+	descriptor->color_logic_operation_mode = GFW_COLOR_LOGIC_OPERATION_COPY;
+	descriptor->cull_face_mode = GFW_CULL_FACE_BACK;
+	descriptor->front_face = GFW_CULL_FACE_FRONT_CCW;
+	descriptor->depth_test_function = GFW_DEPTH_TEST_FUNCTION_LESS;
+	descriptor->dither = true;
+	descriptor->point_size = 1.0f;
+	descriptor->line_width = 1.0f;
+}
+
+void gfw_free_pipeline_states(void)
+{
+	uint32_t i = 0;
+	while (i < gfw_pipeline_states_capacity) {
+		free(gfw_pipeline_states[i]);
+		i++;
+	}
+	free(gfw_pipeline_states);
+	gfw_pipeline_states = NULL;
+	gfw_pipeline_states_capacity = 0;
+	gfw_pipeline_states_count = 0;
+	gfw_current_pipeline_state = NULL;
+}
+
+/* Command bucket */
+static uint64_t gfw_command_key_field(uint32_t value, uint32_t bits)
+{
+	return (uint64_t)value & ((UINT64_C(1) << bits) - 1);
+}
+
+/* Translucent draws sort back to front before their shader, opaque draws front to back after it */
+uint64_t gfw_command_key(uint32_t layer, uint32_t pass, bool translucent, uint32_t shader, uint32_t material, uint32_t depth)
+{
+	uint64_t key = gfw_command_key_field(layer, GFW_COMMAND_KEY_LAYER_BITS);
+	key = (key << GFW_COMMAND_KEY_PASS_BITS) | gfw_command_key_field(pass, GFW_COMMAND_KEY_PASS_BITS);
+	key = (key << 1) | (translucent ? 1 : 0);
+	if (translucent) {
+		key = (key << GFW_COMMAND_KEY_DEPTH_BITS) | gfw_command_key_field(~depth, GFW_COMMAND_KEY_DEPTH_BITS);
+		key = (key << GFW_COMMAND_KEY_SHADER_BITS) | gfw_command_key_field(shader, GFW_COMMAND_KEY_SHADER_BITS);
+		key = (key << GFW_COMMAND_KEY_MATERIAL_BITS) | gfw_command_key_field(material, GFW_COMMAND_KEY_MATERIAL_BITS);
+	} else {
+		key = (key << GFW_COMMAND_KEY_SHADER_BITS) | gfw_command_key_field(shader, GFW_COMMAND_KEY_SHADER_BITS);
+		key = (key << GFW_COMMAND_KEY_MATERIAL_BITS) | gfw_command_key_field(material, GFW_COMMAND_KEY_MATERIAL_BITS);
+		key = (key << GFW_COMMAND_KEY_DEPTH_BITS) | gfw_command_key_field(depth, GFW_COMMAND_KEY_DEPTH_BITS);
+	}
+	return key;
+}
+
+/* Null framebuffers, pipeline states and textures keep the current binding */
+static uint32_t gfw_count_command_state_changes(struct gfw_command *previous, struct gfw_command *command)
+{
+	uint32_t changes = 0;
+	if (command->framebuffer && (!previous || previous->framebuffer != command->framebuffer)) {
+		changes++;
+	}
+	if (!previous || previous->shader != command->shader) {
+		changes++;
+	}
+	if (command->pipeline_state && (!previous || previous->pipeline_state != command->pipeline_state)) {
+		changes++;
+	}
+	if (command->texture && (!previous || previous->texture != command->texture)) {
+		changes++;
+	}
+	if (!previous || previous->vertex_state != command->vertex_state) {
+		changes++;
+	}
+	return changes;
+}
+
+void gfw_command_bucket_submit(struct gfw_command_bucket *command_bucket)
+{
+	struct gfw_command *previous = NULL;
+	struct gfw_command *command = NULL;
+	size_t i = 0;
+	if (!command_bucket->sorted) {
+		gfw_command_bucket_sort(command_bucket);
+	}
+	command_bucket->statistics.state_changes = 0;
+	while (i < command_bucket->count) {
+		command = &command_bucket->commands[command_bucket->order[i]];
+		command_bucket->statistics.state_changes = command_bucket->statistics.state_changes
+			+ gfw_count_command_state_changes(previous, command);
+		if (command->framebuffer && (!previous || previous->framebuffer != command->framebuffer)) {
+			gfw_framebuffer_bind(command->framebuffer);
+		}
+		if (!previous || previous->shader != command->shader) {
+			gfw_shader_use(command->shader);
+		}
+		if (command->pipeline_state && (!previous || previous->pipeline_state != command->pipeline_state)) {
+			gfw_pipeline_state_apply(command->pipeline_state);
+		}
+		if (command->texture && (!previous || previous->texture != command->texture)) {
+			gfw_texture_bind(command->texture);
+		}
+		if (command->prepare) {
+			command->prepare(command, command->user_data);
+		}
+		if (command->indexed) {
+			gfw_vertex_state_draw_elements(command->vertex_state, command->primitive, command->index_type, command->first, command->count);
+		} else {
+			gfw_vertex_state_draw_range(command->vertex_state, command->primitive, command->first, command->count);
+		}
+		previous = command;
+		i++;
+	}
+}
+
+/* Least significant digit radix sort of the keys, one byte per pass */
+void gfw_command_bucket_sort(struct gfw_command_bucket *command_bucket)
+{
+	size_t histograms[8][256];
+	uint64_t *keys = command_bucket->keys;
+	uint32_t *order = command_bucket->order;
+	uint64_t *sort_keys = command_bucket->sort_keys;
+	uint32_t *sort_order = command_bucket->sort_order;
+	uint64_t *swap_keys = NULL;
+	uint32_t *swap_order = NULL;
+	size_t offset = 0;
+	size_t count = 0;
+	size_t i = 0;
+	uint32_t pass = 0;
+	uint32_t digit = 0;
+	command_bucket->sorted = true;
+	if (command_bucket->count == 0) {
+		return;
+	}
+	memset(histograms, 0, sizeof(histograms));
+	while (i < command_bucket->count) {
+		keys[i] = command_bucket->commands[i].key;
+		order[i] = i;
+		pass = 0;
+		while (pass < 8) {
+			histograms[pass][(keys[i] >> (pass * 8)) & 0xff]++;
+			pass++;
+		}
+		i++;
+	}
+	pass = 0;
+	while (pass < 8) {
+		/* A byte shared by every key does not change the order */
+		if (histograms[pass][(keys[0] >> (pass * 8)) & 0xff] == command_bucket->count) {
+			pass++;
+			continue;
+		}
+		offset = 0;
+		digit = 0;
+		while (digit < 256) {
+			count = histograms[pass][digit];
+			histograms[pass][digit] = offset;
+			offset = offset + count;
+			digit++;
+		}
+		i = 0;
+		while (i < command_bucket->count) {
+			digit = (keys[i] >> (pass * 8)) & 0xff;
+			sort_keys[histograms[pass][digit]] = keys[i];
+			sort_order[histograms[pass][digit]] = order[i];
+			histograms[pass][digit]++;
+			i++;
+		}
+		swap_keys = keys;
+		keys = sort_keys;
+		sort_keys = swap_keys;
+		swap_order = order;
+		order = sort_order;
+		sort_order = swap_order;
+		pass++;
+	}
+	command_bucket->keys = keys;
+	command_bucket->order = order;
+	command_bucket->sort_keys = sort_keys;
+	command_bucket->sort_order = sort_order;
+}
+
+static bool gfw_command_bucket_reserve(struct gfw_command_bucket *command_bucket, size_t capacity)
+{
+	struct gfw_command *commands = NULL;
+	uint64_t *keys = NULL;
+	uint32_t *order = NULL;
+	uint64_t *sort_keys = NULL;
+	uint32_t *sort_order = NULL;
+	commands = realloc(command_bucket->commands, capacity * sizeof(*commands));
+	if (!commands) {
+		return false;
+	}
+	command_bucket->commands = commands;
+	keys = realloc(command_bucket->keys, capacity * sizeof(*keys));
+	if (!keys) {
+		return false;
+	}
+	command_bucket->keys = keys;
+	order = realloc(command_bucket->order, capacity * sizeof(*order));
+	if (!order) {
+		return false;
+	}
+	command_bucket->order = order;
+	sort_keys = realloc(command_bucket->sort_keys, capacity * sizeof(*sort_keys));
+	if (!sort_keys) {
+		return false;
+	}
+	command_bucket->sort_keys = sort_keys;
+	sort_order = realloc(command_bucket->sort_order, capacity * sizeof(*sort_order));
+	if (!sort_order) {
+		return false;
+	}
+	command_bucket->sort_order = sort_order;
+	command_bucket->capacity = capacity;
+	return true;
+}
+
+bool gfw_command_bucket_push(struct gfw_command_bucket *command_bucket, struct gfw_command *command)
+{
+	struct gfw_command *previous = NULL;
+	if (command_bucket->count >= command_bucket->capacity) {
+		if (!gfw_command_bucket_reserve(command_bucket, command_bucket->capacity > 0 ? command_bucket->capacity * 2 : 64)) {
+			return false;
+		}
+	}
+	if (command_bucket->count > 0) {
+		previous = &command_bucket->commands[command_bucket->count - 1];
+	}
+	/* State changes of the recorded order, to compare with the sorted one */
+	command_bucket->statistics.unsorted_state_changes = command_bucket->statistics.unsorted_state_changes
+		+ gfw_count_command_state_changes(previous, command);
+	command_bucket->commands[command_bucket->count] = *command;
+	command_bucket->count = command_bucket->count + 1;
+	command_bucket->statistics.commands = command_bucket->count;
+	command_bucket->sorted = false;
+	return true;
+}
+
+void gfw_command_bucket_clear(struct gfw_command_bucket *command_bucket)
+{
+	command_bucket->count = 0;
+	command_bucket->sorted = false;
+	command_bucket->statistics.commands = 0;
+	command_bucket->statistics.unsorted_state_changes = 0;
+	command_bucket->statistics.state_changes = 0;
+}
+
+void gfw_free_command_bucket(struct gfw_command_bucket *command_bucket)
+{
+	free(command_bucket->commands);
+	free(command_bucket->keys);
+	free(command_bucket->order);
+	free(command_bucket->sort_keys);
+	free(command_bucket->sort_order);
+	command_bucket->commands = NULL;
+	command_bucket->keys = NULL;
+	command_bucket->order = NULL;
+	command_bucket->sort_keys = NULL;
+	command_bucket->sort_order = NULL;
+	command_bucket->capacity = 0;
+	gfw_command_bucket_clear(command_bucket);
+}
+
+bool gfw_init_command_bucket(struct gfw_command_bucket *command_bucket, size_t capacity)
+{
+	bool success = true;
+	command_bucket->commands = NULL;
+	command_bucket->keys = NULL;
+	command_bucket->order = NULL;
+	command_bucket->sort_keys = NULL;
+	command_bucket->sort_order = NULL;
+	command_bucket->capacity = 0;
+	gfw_command_bucket_clear(command_bucket);
+	if (capacity > 0 && !gfw_command_bucket_reserve(command_bucket, capacity)) {
+		gfw_free_command_bucket(command_bucket);
+		success = false;
+	}
+	return success;
+}
+
+/* Command list */
+enum gfw_command_list_opcode {
+	GFW_COMMAND_LIST_BIND_FRAMEBUFFER,
+	GFW_COMMAND_LIST_USE_SHADER,
+	GFW_COMMAND_LIST_BIND_TEXTURE,
+	GFW_COMMAND_LIST_APPLY_PIPELINE_STATE,
+	GFW_COMMAND_LIST_SET_VIEWPORT,
+	GFW_COMMAND_LIST_SET_UNIFORM_MAT4,
+	GFW_COMMAND_LIST_SET_UNIFORM_FLOAT,
+	GFW_COMMAND_LIST_SET_UNIFORM_INT,
+	GFW_COMMAND_LIST_SET_UNIFORM_UINT,
+	GFW_COMMAND_LIST_DRAW_RANGE,
+	GFW_COMMAND_LIST_DRAW_ELEMENTS,
+	GFW_COMMAND_LIST_CLEAR_COLOR,
+	GFW_COMMAND_LIST_CLEAR
+};
+
+/* Every command is a header followed by its payload, padded to 8 bytes */
+struct gfw_command_list_header {
+	uint32_t opcode;
+	uint32_t size;
+};
+
+struct gfw_command_list_bind {
+	void *object;
+	uint32_t index;
+};
+
+struct gfw_command_list_viewport {
+	int32_t x;
+	int32_t y;
+	uint32_t width;
+	uint32_t height;
+};
+
+struct gfw_command_list_uniform {
+	gfw_int_t location;
+	uint32_t count;
+	bool normalize;
+};
+
+struct gfw_command_list_draw {
+	struct gfw_vertex_state *vertex_state;
+	enum gfw_primitive primitive;
+	enum gfw_index_type index_type;
+	size_t first;
+	size_t count;
+};
+
+struct gfw_command_list_clear {
+	gfw_float_t color[4];
+	bool clear_color;
+	bool clear_depth;
+};
+
+#define GFW_COMMAND_LIST_ALIGN(size) (((size) + 7) & ~(size_t)7)
+
+static bool gfw_command_list_write(struct gfw_command_list *command_list,
+	enum gfw_command_list_opcode opcode,
+	void *payload,
+	size_t payload_size,
+	void *data,
+	size_t data_size)
+{
+	struct gfw_command_list_header header = {0, 0};
+	size_t size = sizeof(header) + GFW_COMMAND_LIST_ALIGN(payload_size) + GFW_COMMAND_LIST_ALIGN(data_size);
+	size_t capacity = command_list->capacity > 0 ? command_list->capacity : 1024;
+	uint8_t *buffer = NULL;
+	if (command_list->size + size > command_list->capacity) {
+		while (command_list->size + size > capacity) {
+			capacity = capacity * 2;
+		}
+		buffer = realloc(command_list->data, capacity);
+		if (!buffer) {
+			return false;
+		}
+		command_list->data = buffer;
+		command_list->capacity = capacity;
+	}
+	header.opcode = opcode;
+	header.size = size;
+	buffer = command_list->data + command_list->size;
+	memcpy(buffer, &header, sizeof(header));
+	buffer = buffer + sizeof(header);
+	memcpy(buffer, payload, payload_size);
+	buffer = buffer + GFW_COMMAND_LIST_ALIGN(payload_size);
+	if (data_size > 0) {
+		memcpy(buffer, data, data_size);
+	}
+	command_list->size = command_list->size + size;
+	command_list->commands_count = command_list->commands_count + 1;
+	return true;
+}
+
+void gfw_command_list_submit(struct gfw_command_list *command_list)
+{
+	struct gfw_command_list_header header = {0, 0};
+	struct gfw_command_list_bind bind = {NULL, 0};
+	struct gfw_command_list_viewport viewport = {0, 0, 0, 0};
+	struct gfw_command_list_uniform uniform = {0, 0, false};
+	struct gfw_command_list_draw draw = {NULL, GFW_PRIMITIVE_TRIANGLES, GFW_INDEX_UINT, 0, 0};
+	struct gfw_command_list_clear clear = {{0.0f, 0.0f, 0.0f, 0.0f}, false, false};
+	uint8_t *payload = NULL;
+	size_t offset = 0;
+	gfw_push_debug_group("gfw command list");
+	while (offset < command_list->size) {
+		memcpy(&header, command_list->data + offset, sizeof(header));
+		payload = command_list->data + offset + sizeof(header);
+		switch (header.opcode) {
+		case GFW_COMMAND_LIST_BIND_FRAMEBUFFER:
+			memcpy(&bind, payload, sizeof(bind));
+			if (bind.object) {
+				gfw_framebuffer_bind(bind.object);
+			} else {
+				gfw_framebuffer_unbind();
+			}
+			break;
+		case GFW_COMMAND_LIST_USE_SHADER:
+			memcpy(&bind, payload, sizeof(bind));
+			gfw_shader_use(bind.object);
+			break;
+		case GFW_COMMAND_LIST_BIND_TEXTURE:
+			memcpy(&bind, payload, sizeof(bind));
+			gfw_texture_activate(bind.index);
+			if (bind.object) {
+				gfw_texture_bind(bind.object);
+			} else {
+				gfw_texture_unbind();
+			}
+			break;
+		case GFW_COMMAND_LIST_APPLY_PIPELINE_STATE:
+			memcpy(&bind, payload, sizeof(bind));
+			gfw_pipeline_state_apply(bind.object);
+			break;
+		case GFW_COMMAND_LIST_SET_VIEWPORT:
+			memcpy(&viewport, payload, sizeof(viewport));
+			gfw_set_viewport(viewport.x, viewport.y, viewport.width, viewport.height);
+			break;
+		case GFW_COMMAND_LIST_SET_UNIFORM_MAT4:
+		case GFW_COMMAND_LIST_SET_UNIFORM_FLOAT:
+		case GFW_COMMAND_LIST_SET_UNIFORM_INT:
+		case GFW_COMMAND_LIST_SET_UNIFORM_UINT:
+			memcpy(&uniform, payload, sizeof(uniform));
+			payload = payload + GFW_COMMAND_LIST_ALIGN(sizeof(uniform));
+			/* Uniform values are 8 byte aligned inside the list */
+			if (header.opcode == GFW_COMMAND_LIST_SET_UNIFORM_MAT4) {
+				gfw_shader_set_uniform_mat4(uniform.location, uniform.normalize, (gfw_float_t *)payload);
+			} else if (header.opcode == GFW_COMMAND_LIST_SET_UNIFORM_FLOAT) {
+				gfw_shader_set_uniform_floatv(uniform.location, (gfw_float_t *)payload, uniform.count);
+			} else if (header.opcode == GFW_COMMAND_LIST_SET_UNIFORM_INT) {
+				gfw_shader_set_uniform_intv(uniform.location, (gfw_int_t *)payload, uniform.count);
+			} else {
+				gfw_shader_set_uniform_uintv(uniform.location, (gfw_uint_t *)payload, uniform.count);
+			}
+			break;
+		case GFW_COMMAND_LIST_DRAW_RANGE:
+			memcpy(&draw, payload, sizeof(draw));
+			gfw_vertex_state_draw_range(draw.vertex_state, draw.primitive, draw.first, draw.count);
+			break;
+		case GFW_COMMAND_LIST_DRAW_ELEMENTS:
+			memcpy(&draw, payload, sizeof(draw));
+			gfw_vertex_state_draw_elements(draw.vertex_state, draw.primitive, draw.index_type, draw.first, draw.count);
+			break;
+		case GFW_COMMAND_LIST_CLEAR_COLOR:
+			memcpy(&clear, payload, sizeof(clear));
+			gfw_framebuffer_clear_color(clear.color[0], clear.color[1], clear.color[2], clear.color[3]);
+			break;
+		case GFW_COMMAND_LIST_CLEAR:
+			memcpy(&clear, payload, sizeof(clear));
+			gfw_framebuffer_clear(clear.clear_color, clear.clear_depth);
+			break;
+		}
+		offset = offset + header.size;
+	}
+	gfw_pop_debug_group();
+}
+
+/* Lists are replayed in array order whatever thread recorded them */
+void gfw_submit_command_lists(struct gfw_command_list **command_lists, size_t command_lists_count)
+{
+	size_t i = 0;
+	while (i < command_lists_count) {
+		gfw_command_list_submit(command_lists[i]);
+		i++;
+	}
+}
+
+bool gfw_command_list_clear(struct gfw_command_list *command_list, bool color, bool depth)
+{
+	struct gfw_command_list_clear clear = {{0.0f, 0.0f, 0.0f, 0.0f}, false, false};
+	clear.clear_color = color;
+	clear.clear_depth = depth;
+	return gfw_command_list_write(command_list, GFW_COMMAND_LIST_CLEAR, &clear, sizeof(clear), NULL, 0);
+}
+
+bool gfw_command_list_clear_color(struct gfw_command_list *command_list, gfw_float_t r, gfw_float_t g, gfw_float_t b, gfw_float_t a)
+{
+	struct gfw_command_list_clear clear = {{0.0f, 0.0f, 0.0f, 0.0f}, false, false};
+	clear.color[0] = r;
+	clear.color[1] = g;
+	clear.color[2] = b;
+	clear.color[3] = a;
+	return gfw_command_list_write(command_list, GFW_COMMAND_LIST_CLEAR_COLOR, &clear, sizeof(clear), NULL, 0);
+}
+
+bool gfw_command_list_draw_elements(struct gfw_command_list *command_list,
+	struct gfw_vertex_state *vertex_state,
+	enum gfw_primitive primitive,
+	enum gfw_index_type index_type,
+	size_t first,
+	size_t count)
+{
+	struct gfw_command_list_draw draw = {NULL, GFW_PRIMITIVE_TRIANGLES, GFW_INDEX_UINT, 0, 0};
+	draw.vertex_state = vertex_state;
+	draw.primitive = primitive;
+	draw.index_type = index_type;
+	draw.first = first;
+	draw.count = count;
+	return gfw_command_list_write(command_list, GFW_COMMAND_LIST_DRAW_ELEMENTS, &draw, sizeof(draw), NULL, 0);
+}
+
+bool gfw_command_list_draw_range(struct gfw_command_list *command_list, struct gfw_vertex_state *vertex_state, enum gfw_primitive primitive, size_t first, size_t count)
+{
+	struct gfw_command_list_draw draw = {NULL, GFW_PRIMITIVE_TRIANGLES, GFW_INDEX_UINT, 0, 0};
+	draw.vertex_state = vertex_state;
+	draw.primitive = primitive;
+	draw.first = first;
+	draw.count = count;
+	return gfw_command_list_write(command_list, GFW_COMMAND_LIST_DRAW_RANGE, &draw, sizeof(draw), NULL, 0);
+}
+
+bool gfw_command_list_set_uniform_mat4(struct gfw_command_list *command_list, gfw_int_t location, bool normalize, gfw_float_t *matrix)
+{
+	struct gfw_command_list_uniform uniform = {0, 0, false};
+	uniform.location = location;
+	uniform.count = 1;
+	uniform.normalize = normalize;
+	return gfw_command_list_write(command_list, GFW_COMMAND_LIST_SET_UNIFORM_MAT4, &uniform, sizeof(uniform), matrix, 16 * sizeof(*matrix));
+}
+
+bool gfw_command_list_set_uniform_floatv(struct gfw_command_list *command_list, gfw_int_t location, gfw_float_t *f, uint32_t count)
+{
+	struct gfw_command_list_uniform uniform = {0, 0, false};
+	uniform.location = location;
+	uniform.count = count;
+	return gfw_command_list_write(command_list, GFW_COMMAND_LIST_SET_UNIFORM_FLOAT, &uniform, sizeof(uniform), f, count * sizeof(*f));
+}
+
+bool gfw_command_list_set_uniform_intv(struct gfw_command_list *command_list, gfw_int_t location, gfw_int_t *i, uint32_t count)
+{
+	struct gfw_command_list_uniform uniform = {0, 0, false};
+	uniform.location = location;
+	uniform.count = count;
+	return gfw_command_list_write(command_list, GFW_COMMAND_LIST_SET_UNIFORM_INT, &uniform, sizeof(uniform), i, count * sizeof(*i));
+}
+
+bool gfw_command_list_set_uniform_uintv(struct gfw_command_list *command_list, gfw_int_t location, gfw_uint_t *i, uint32_t count)
+{
+	struct gfw_command_list_uniform uniform = {0, 0, false};
+	uniform.location = location;
+	uniform.count = count;
+	return gfw_command_list_write(command_list, GFW_COMMAND_LIST_SET_UNIFORM_UINT, &uniform, sizeof(uniform), i, count * sizeof(*i));
+}
+
+bool gfw_command_list_set_viewport(struct gfw_command_list *command_list, int32_t x, int32_t y, uint32_t width, uint32_t height)
+{
+	struct gfw_command_list_viewport viewport = {0, 0, 0, 0};
+	viewport.x = x;
+	viewport.y = y;
+	viewport.width = width;
+	viewport.height = height;
+	return gfw_command_list_write(command_list, GFW_COMMAND_LIST_SET_VIEWPORT, &viewport, sizeof(viewport), NULL, 0);
+}
+
+bool gfw_command_list_apply_pipeline_state(struct gfw_command_list *command_list, struct gfw_pipeline_state *pipeline_state)
+{
+	struct gfw_command_list_bind bind = {NULL, 0};
+	bind.object = pipeline_state;
+	return gfw_command_list_write(command_list, GFW_COMMAND_LIST_APPLY_PIPELINE_STATE, &bind, sizeof(bind), NULL, 0);
+}
+
+bool gfw_command_list_bind_texture(struct gfw_command_list *command_list, uint32_t index, struct gfw_texture *texture)
+{
+	struct gfw_command_list_bind bind = {NULL, 0};
+	bind.object = texture;
+	bind.index = index;
+	return gfw_command_list_write(command_list, GFW_COMMAND_LIST_BIND_TEXTURE, &bind, sizeof(bind), NULL, 0);
+}
+
+bool gfw_command_list_use_shader(struct gfw_command_list *command_list, struct gfw_shader *shader)
+{
+	struct gfw_command_list_bind bind = {NULL, 0};
+	bind.object = shader;
+	return gfw_command_list_write(command_list, GFW_COMMAND_LIST_USE_SHADER, &bind, sizeof(bind), NULL, 0);
+}
+
+bool gfw_command_list_bind_framebuffer(struct gfw_command_list *command_list, struct gfw_framebuffer *framebuffer)
+{
+	struct gfw_command_list_bind bind = {NULL, 0};
+	bind.object = framebuffer;
+	return gfw_command_list_write(command_list, GFW_COMMAND_LIST_BIND_FRAMEBUFFER, &bind, sizeof(bind), NULL, 0);
+}
+
+void gfw_command_list_reset(struct gfw_command_list *command_list)
+{
+	command_list->size = 0;
+	command_list->commands_count = 0;
+}
+
+void gfw_free_command_list(struct gfw_command_list *command_list)
+{
+	free(command_list->data);
+	command_list->data = NULL;
+	command_list->capacity = 0;
+	gfw_command_list_reset(command_list);
+}
+
+/* Recording never touches GL or shared state, so each thread can own a list */
+bool gfw_init_command_list(struct gfw_command_list *command_list, size_t capacity)
+{
+	bool success = true;
+	command_list->data = NULL;
+	command_list->capacity = 0;
+	gfw_command_list_reset(command_list);
+	if (capacity > 0) {
+		command_list->data = malloc(capacity);
+		if (!command_list->data) {
+			success = false;
+		} else {
+			command_list->capacity = capacity;
+		}
+	}
+	return success;
+}
+
+/* Debug */
+#ifdef GFW_ASYNC_BACKEND_ERROR
+static struct gfw_debug_message gfw_debug_messages[GFW_DEBUG_MESSAGES_MAX];
+static uint32_t gfw_debug_messages_first = 0;
+static uint32_t gfw_debug_messages_count = 0;
+static uint32_t gfw_debug_messages_dropped = 0;
+static bool gfw_debug_output_enabled = false;
+#ifdef __unix__
+static pthread_mutex_t gfw_debug_messages_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/* Drivers may call back from their own threads unless output is synchronous */
+static void APIENTRY gfw_debug_callback(GLenum source,
+	GLenum type,
+	GLuint id,
+	GLenum severity,
+	GLsizei length,
+	const GLchar *message,
+	const void *user_data)
+{
+	struct gfw_debug_message *debug_message = NULL;
+	size_t size = length < 0 ? strlen(message) : (size_t)length;
+	(void)user_data;
+	if (size >= GFW_DEBUG_MESSAGE_MAX_LENGTH) {
+		size = GFW_DEBUG_MESSAGE_MAX_LENGTH - 1;
+	}
+#ifdef __unix__
+	pthread_mutex_lock(&gfw_debug_messages_mutex);
+#endif
+	/* The oldest message is replaced when the ring is full */
+	if (gfw_debug_messages_count == GFW_DEBUG_MESSAGES_MAX) {
+		gfw_debug_messages_first = (gfw_debug_messages_first + 1) % GFW_DEBUG_MESSAGES_MAX;
+		gfw_debug_messages_count = gfw_debug_messages_count - 1;
+		gfw_debug_messages_dropped = gfw_debug_messages_dropped + 1;
+	}
+	debug_message = &gfw_debug_messages[(gfw_debug_messages_first + gfw_debug_messages_count) % GFW_DEBUG_MESSAGES_MAX];
+	debug_message->source = source;
+	debug_message->type = type;
+	debug_message->id = id;
+	debug_message->severity = severity;
+	memcpy(debug_message->text, message, size);
+	debug_message->text[size] = 0;
+	gfw_debug_messages_count = gfw_debug_messages_count + 1;
+	/* The slot can be overwritten by another callback once the lock is released */
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+	if (type == GL_DEBUG_TYPE_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: %s\n", debug_message->text);
+#endif
+		abort();
+	}
+#endif
+#ifdef __unix__
+	pthread_mutex_unlock(&gfw_debug_messages_mutex);
+#endif
+}
+#endif
+
+/* Labels and groups are only emitted while debug output is enabled, they are no-ops otherwise */
+void gfw_set_debug_label(enum gfw_debug_object object, gfw_uint_t object_gl_id, char *label)
+{
+#ifdef GFW_ASYNC_BACKEND_ERROR
+	if (gfw_debug_output_enabled && object_gl_id) {
+		glObjectLabel(object, object_gl_id, -1, label);
+	}
+#else
+	(void)object;
+	(void)object_gl_id;
+	(void)label;
+#endif
+}
+
+void gfw_pop_debug_group(void)
+{
+#ifdef GFW_ASYNC_BACKEND_ERROR
+	if (gfw_debug_output_enabled) {
+		glPopDebugGroup();
+	}
+#endif
+}
+
+void gfw_push_debug_group(char *name)
+{
+#ifdef GFW_ASYNC_BACKEND_ERROR
+	if (gfw_debug_output_enabled) {
+		glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+	}
+#else
+	(void)name;
+#endif
+}
+
+/* Meant to be called once per frame, messages may be NULL to only print and discard */
+size_t gfw_debug_poll(struct gfw_debug_message *messages, size_t messages_capacity, uint32_t *dropped)
+{
+	size_t count = 0;
+#ifdef GFW_ASYNC_BACKEND_ERROR
+	struct gfw_debug_message *debug_message = NULL;
+#ifdef __unix__
+	pthread_mutex_lock(&gfw_debug_messages_mutex);
+#endif
+	while (gfw_debug_messages_count > 0 && (!messages || count < messages_capacity)) {
+		debug_message = &gfw_debug_messages[gfw_debug_messages_first];
+#ifdef GFW_PRINT_BACKEND_ERROR
+		if (debug_message->type == GL_DEBUG_TYPE_ERROR) {
+			printf("Error: %s\n", debug_message->text);
+		} else {
+			printf("Warning: %s\n", debug_message->text);
+		}
+#endif
+		if (messages) {
+			messages[count] = *debug_message;
+		}
+		gfw_debug_messages_first = (gfw_debug_messages_first + 1) % GFW_DEBUG_MESSAGES_MAX;
+		gfw_debug_messages_count = gfw_debug_messages_count - 1;
+		count++;
+	}
+	if (dropped) {
+		*dropped = gfw_debug_messages_dropped;
+	}
+	gfw_debug_messages_dropped = 0;
+#ifdef __unix__
+	pthread_mutex_unlock(&gfw_debug_messages_mutex);
+#endif
+#else
+	(void)messages;
+	(void)messages_capacity;
+	if (dropped) {
+		*dropped = 0;
+	}
+#endif
+	return count;
+}
+
+void gfw_free_debug_output(void)
+{
+#ifdef GFW_ASYNC_BACKEND_ERROR
+	gfw_debug_output_enabled = false;
+	glDebugMessageCallback(NULL, NULL);
+	glDisable(GL_DEBUG_OUTPUT);
+	gfw_debug_poll(NULL, 0, NULL);
+#endif
+}
+
+bool gfw_init_debug_output(void)
+{
+	bool success = false;
+#ifdef GFW_ASYNC_BACKEND_ERROR
+	GLint major_version = 0;
+	GLint minor_version = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major_version);
+	glGetIntegerv(GL_MINOR_VERSION, &minor_version);
+	if (major_version * 10 + minor_version < 43 && !gfw_has_extension("GL_KHR_debug")) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to find debug output support.\n");
+#endif
+		goto done;
+	}
+	glEnable(GL_DEBUG_OUTPUT);
+#ifndef __unix__
+	glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+#endif
+	glDebugMessageCallback(gfw_debug_callback, NULL);
+	/* Notifications are frequent and carry no diagnostics */
+	glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, NULL, GL_FALSE);
+	glDebugMessageControl(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_PUSH_GROUP, GL_DONT_CARE, 0, NULL, GL_FALSE);
+	glDebugMessageControl(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_POP_GROUP, GL_DONT_CARE, 0, NULL, GL_FALSE);
+	success = glGetError() == GL_NO_ERROR;
+	gfw_debug_output_enabled = success;
+done:
+#endif
+	return success;
+}
+
+/* Timer */
+#define GFW_TIMER_NO_PARENT UINT32_MAX
+
+/* Queries complete in order, so the last one issued tells whether the frame is done */
+static bool gfw_timer_resolve_frame(struct gfw_timer *timer, struct gfw_timer_frame *frame)
+{
+	GLint available = 0;
+	uint32_t i = 0;
+	if (!frame->pending) {
+		return true;
+	}
+	if (frame->scopes_count > 0) {
+		glGetQueryObjectiv(frame->queries_gl_ids[frame->last_query], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) {
+			return false;
+		}
+	}
+	while (i < frame->scopes_count) {
+		glGetQueryObjectui64v(frame->queries_gl_ids[2 * i], GL_QUERY_RESULT, &frame->scopes[i].begin);
+		glGetQueryObjectui64v(frame->queries_gl_ids[2 * i + 1], GL_QUERY_RESULT, &frame->scopes[i].end);
+		i++;
+	}
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to get timer query results.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+	frame->pending = false;
+	if (!timer->resolved_frame || timer->resolved_frame->index < frame->index) {
+		timer->resolved_frame = frame;
+	}
+	return true;
+}
+
+static void gfw_write_trace_string(FILE *file, char *string)
+{
+	while (*string) {
+		if (*string == '"' || *string == '\\') {
+			fputc('\\', file);
+		}
+		if ((unsigned char)*string >= 0x20) {
+			fputc(*string, file);
+		}
+		string++;
+	}
+}
+
+/* Chrome trace event JSON of the latest resolved frame */
+bool gfw_timer_write_trace(struct gfw_timer *timer, char *path)
+{
+	bool success = true;
+	struct gfw_timer_frame *frame = timer->resolved_frame;
+	struct gfw_timer_scope *scope = NULL;
+	FILE *file = NULL;
+	uint32_t i = 0;
+	if (!frame) {
+		success = false;
+		goto done;
+	}
+	file = fopen(path, "w");
+	if (!file) {
+		success = false;
+		goto done;
+	}
+	fprintf(file, "{\"traceEvents\":[");
+	while (i < frame->scopes_count) {
+		scope = &frame->scopes[i];
+		fprintf(file, "%s\n{\"name\":\"", i > 0 ? "," : "");
+		gfw_write_trace_string(file, scope->name);
+		fprintf(file,
+			"\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%llu,\"depth\":%u}}",
+			scope->begin / 1000.0,
+			(scope->end - scope->begin) / 1000.0,
+			(unsigned long long)frame->index,
+			scope->depth);
+		i++;
+	}
+	fprintf(file, "\n]}\n");
+	if (fclose(file) != 0) {
+		success = false;
+	}
+done:
+	return success;
+}
+
+/* Scopes are stored in begin order and link to their parent, forming the tree */
+struct gfw_timer_frame *gfw_timer_get_frame(struct gfw_timer *timer)
+{
+	return timer->resolved_frame;
+}
+
+void gfw_timer_end(struct gfw_timer *timer)
+{
+	struct gfw_timer_frame *frame = &timer->frames[timer->frame];
+	if (timer->ignored_count > 0) {
+		timer->ignored_count = timer->ignored_count - 1;
+		return;
+	}
+	if (timer->stack_count == 0) {
+		return;
+	}
+	timer->stack_count = timer->stack_count - 1;
+	/* Nested scopes end in reverse order, so the last query issued is not the last one allocated */
+	frame->last_query = 2 * timer->stack[timer->stack_count] + 1;
+	glQueryCounter(frame->queries_gl_ids[frame->last_query], GL_TIMESTAMP);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to end timer scope.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+	gfw_pop_debug_group();
+}
+
+void gfw_timer_begin(struct gfw_timer *timer, char *name)
+{
+	struct gfw_timer_frame *frame = &timer->frames[timer->frame];
+	struct gfw_timer_scope *scope = NULL;
+	/* Scopes past the limits are ignored, and so is their end */
+	if (!timer->recording || timer->ignored_count > 0
+		|| frame->scopes_count == GFW_TIMER_SCOPES_MAX
+		|| timer->stack_count == GFW_TIMER_DEPTH_MAX) {
+		timer->ignored_count = timer->ignored_count + 1;
+		return;
+	}
+	scope = &frame->scopes[frame->scopes_count];
+	strncpy(scope->name, name, GFW_TIMER_NAME_MAX_LENGTH - 1);
+	scope->name[GFW_TIMER_NAME_MAX_LENGTH - 1] = 0;
+	scope->parent = timer->stack_count > 0 ? timer->stack[timer->stack_count - 1] : GFW_TIMER_NO_PARENT;
+	scope->depth = timer->stack_count;
+	scope->begin = 0;
+	scope->end = 0;
+	/* Timed scopes show up as debug groups in frame debuggers */
+	gfw_push_debug_group(scope->name);
+	frame->last_query = 2 * frame->scopes_count;
+	glQueryCounter(frame->queries_gl_ids[frame->last_query], GL_TIMESTAMP);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to begin timer scope.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+	timer->stack[timer->stack_count] = frame->scopes_count;
+	timer->stack_count = timer->stack_count + 1;
+	frame->scopes_count = frame->scopes_count + 1;
+}
+
+void gfw_timer_end_frame(struct gfw_timer *timer)
+{
+	uint32_t i = 0;
+	timer->ignored_count = 0;
+	while (timer->stack_count > 0) {
+		gfw_timer_end(timer);
+	}
+	if (timer->recording) {
+		timer->frames[timer->frame].pending = true;
+	}
+	timer->recording = false;
+	/* Older frames are read back as soon as they are available, never waited on */
+	while (i < GFW_TIMER_FRAMES) {
+		gfw_timer_resolve_frame(timer, &timer->frames[i]);
+		i++;
+	}
+}
+
+void gfw_timer_begin_frame(struct gfw_timer *timer)
+{
+	struct gfw_timer_frame *frame = NULL;
+	timer->frame = (timer->frame + 1) % GFW_TIMER_FRAMES;
+	timer->frame_index = timer->frame_index + 1;
+	frame = &timer->frames[timer->frame];
+	/* Queries still in flight cannot be reused, so the frame is not recorded */
+	timer->recording = gfw_timer_resolve_frame(timer, frame);
+	if (!timer->recording) {
+		timer->dropped_frames = timer->dropped_frames + 1;
+		return;
+	}
+	if (timer->resolved_frame == frame) {
+		timer->resolved_frame = NULL;
+	}
+	frame->scopes_count = 0;
+	frame->last_query = 0;
+	frame->index = timer->frame_index;
+	timer->stack_count = 0;
+	timer->ignored_count = 0;
+}
+
+void gfw_free_timer(struct gfw_timer *timer)
+{
+	uint32_t i = 0;
+	if (timer->frames) {
+		while (i < GFW_TIMER_FRAMES) {
+			glDeleteQueries(2 * GFW_TIMER_SCOPES_MAX, timer->frames[i].queries_gl_ids);
+			i++;
+		}
+	}
+	free(timer->frames);
+	timer->frames = NULL;
+	timer->resolved_frame = NULL;
+}
+
+bool gfw_init_timer(struct gfw_timer *timer)
+{
+	bool success = true;
+	uint32_t i = 0;
+	timer->resolved_frame = NULL;
+	timer->frame = 0;
+	timer->frame_index = 0;
+	timer->stack_count = 0;
+	timer->ignored_count = 0;
+	timer->recording = false;
+	timer->dropped_frames = 0;
+	timer->frames = calloc(GFW_TIMER_FRAMES, sizeof(*timer->frames));
+	if (!timer->frames) {
+		success = false;
+		goto done;
+	}
+	while (i < GFW_TIMER_FRAMES) {
+		glGenQueries(2 * GFW_TIMER_SCOPES_MAX, timer->frames[i].queries_gl_ids);
+		i++;
+	}
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to generate timer queries.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#else
+		gfw_free_timer(timer);
+		goto done;
+#endif
+	}
+#endif
+done:
+	return success;
+}
+
+/* Statistics */
+#ifdef GFW_STATISTICS
+static struct gfw_statistics gfw_statistics = {0};
+
+/* Bucket 0 counts empty frames, bucket n values below 2^n */
+static uint32_t gfw_get_statistics_bucket(uint64_t value)
+{
+	uint32_t bucket = 0;
+	while (value > 0 && bucket < GFW_STATISTICS_HISTOGRAM_BUCKETS - 1) {
+		value = value >> 1;
+		bucket++;
+	}
+	return bucket;
+}
+#endif
+
+void gfw_statistics_end_frame(void)
+{
+#ifdef GFW_STATISTICS
+	struct gfw_statistics *statistics = &gfw_statistics;
+	uint64_t totals[GFW_STATISTICS_COUNT] = {0};
+	uint32_t frames = 0;
+	uint32_t i = 0;
+	uint32_t j = 0;
+	memcpy(statistics->frame, gfw_statistics_counters, sizeof(statistics->frame));
+	memcpy(statistics->history[statistics->frames_count % GFW_STATISTICS_WINDOW], gfw_statistics_counters, sizeof(statistics->frame));
+	memset(gfw_statistics_counters, 0, sizeof(gfw_statistics_counters));
+	statistics->frames_count = statistics->frames_count + 1;
+	frames = statistics->frames_count < GFW_STATISTICS_WINDOW ? statistics->frames_count : GFW_STATISTICS_WINDOW;
+	memset(statistics->histograms, 0, sizeof(statistics->histograms));
+	while (i < frames) {
+		j = 0;
+		while (j < GFW_STATISTICS_COUNT) {
+			totals[j] = totals[j] + statistics->history[i][j];
+			statistics->histograms[j][gfw_get_statistics_bucket(statistics->history[i][j])]++;
+			j++;
+		}
+		i++;
+	}
+	j = 0;
+	while (j < GFW_STATISTICS_COUNT) {
+		statistics->averages[j] = (double)totals[j] / frames;
+		j++;
+	}
+#endif
+}
+
+void gfw_reset_statistics(void)
+{
+#ifdef GFW_STATISTICS
+	memset(&gfw_statistics, 0, sizeof(gfw_statistics));
+	memset(gfw_statistics_counters, 0, sizeof(gfw_statistics_counters));
+#endif
+}
+
+/* Statistics are all zero unless GFW_STATISTICS is defined */
+void gfw_get_statistics(struct gfw_statistics *statistics)
+{
+#ifdef GFW_STATISTICS
+	*statistics = gfw_statistics;
+	memcpy(statistics->current, gfw_statistics_counters, sizeof(statistics->current));
+#else
+	memset(statistics, 0, sizeof(*statistics));
+#endif
+}
+
+/* Trace */
+#ifdef GFW_TRACE
+static uint8_t *gfw_trace_buffers[2] = {NULL, NULL};
+static uint32_t gfw_trace_buffer = 0;
+static size_t gfw_trace_size = 0;
+#ifdef __unix__
+static pthread_t gfw_trace_writer;
+static pthread_mutex_t gfw_trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gfw_trace_condition = PTHREAD_COND_INITIALIZER;
+static uint8_t *gfw_trace_pending = NULL;
+static size_t gfw_trace_pending_size = 0;
+static bool gfw_trace_stopping = false;
+
+/* Writes full buffers on its own thread so the caller only copies into memory */
+static void *gfw_trace_write(void *argument)
+{
+	uint8_t *data = NULL;
+	size_t size = 0;
+	(void)argument;
+	pthread_mutex_lock(&gfw_trace_mutex);
+	while (true) {
+		while (!gfw_trace_pending && !gfw_trace_stopping) {
+			pthread_cond_wait(&gfw_trace_condition, &gfw_trace_mutex);
+		}
+		if (!gfw_trace_pending) {
+			break;
+		}
+		data = gfw_trace_pending;
+		size = gfw_trace_pending_size;
+		pthread_mutex_unlock(&gfw_trace_mutex);
+		fwrite(data, 1, size, gfw_trace_file);
+		pthread_mutex_lock(&gfw_trace_mutex);
+		gfw_trace_pending = NULL;
+		pthread_cond_broadcast(&gfw_trace_condition);
+	}
+	pthread_mutex_unlock(&gfw_trace_mutex);
+	return NULL;
+}
+#endif
+
+static void gfw_trace_submit(void)
+{
+	if (gfw_trace_size == 0) {
+		return;
+	}
+#ifdef __unix__
+	pthread_mutex_lock(&gfw_trace_mutex);
+	while (gfw_trace_pending) {
+		pthread_cond_wait(&gfw_trace_condition, &gfw_trace_mutex);
+	}
+	gfw_trace_pending = gfw_trace_buffers[gfw_trace_buffer];
+	gfw_trace_pending_size = gfw_trace_size;
+	pthread_cond_broadcast(&gfw_trace_condition);
+	pthread_mutex_unlock(&gfw_trace_mutex);
+	gfw_trace_buffer = gfw_trace_buffer ^ 1;
+#else
+	fwrite(gfw_trace_buffers[gfw_trace_buffer], 1, gfw_trace_size, gfw_trace_file);
+#endif
+	gfw_trace_size = 0;
+}
+
+static void gfw_trace_append(const void *data, uint64_t size)
+{
+	if (gfw_trace_size + size > GFW_TRACE_BUFFER_SIZE) {
+		gfw_trace_submit();
+	}
+	if (size > GFW_TRACE_BUFFER_SIZE) {
+		/* Payloads larger than a buffer go straight to the file once the writer is idle */
+#ifdef __unix__
+		pthread_mutex_lock(&gfw_trace_mutex);
+		while (gfw_trace_pending) {
+			pthread_cond_wait(&gfw_trace_condition, &gfw_trace_mutex);
+		}
+		fwrite(data, 1, size, gfw_trace_file);
+		pthread_mutex_unlock(&gfw_trace_mutex);
+#else
+		fwrite(data, 1, size, gfw_trace_file);
+#endif
+		return;
+	}
+	memcpy(gfw_trace_buffers[gfw_trace_buffer] + gfw_trace_size, data, size);
+	gfw_trace_size = gfw_trace_size + size;
+}
+
+static void gfw_trace_call(enum gfw_trace_call call, union gfw_trace_argument *arguments, uint32_t arguments_count, const void *payload, uint64_t payload_size)
+{
+	struct gfw_trace_record record = {0};
+	record.call = call;
+	record.arguments_count = arguments_count;
+	record.payload_size = payload ? payload_size : 0;
+	gfw_trace_append(&record, sizeof(record));
+	gfw_trace_append(arguments, arguments_count * sizeof(*arguments));
+	if (record.payload_size > 0) {
+		gfw_trace_append(payload, record.payload_size);
+	}
+}
+
+/* Pushed bytes are recorded by the push, direct writes are read back from the whole range */
+static void gfw_trace_vertex_data_upload(void)
+{
+	struct gfw_vertex_data *vertex_data = gfw_trace_mapped_vertex_data;
+	if (vertex_data->count == 0) {
+		GFW_TRACE_CALL(GFW_TRACE_CALL_VERTEX_DATA_UPLOAD, vertex_data->buffer, vertex_data->range,
+			GFW_TRACE_UINT(vertex_data->vbo_gl_id),
+			GFW_TRACE_UINT(gfw_trace_mapped_offset));
+	}
+	gfw_trace_mapped_vertex_data = NULL;
+}
+
+static void gfw_trace_shader(struct gfw_shader *shader,
+	char *vertex_source,
+	char *geometry_source,
+	char *fragment_source,
+	char **varyings,
+	size_t varyings_count,
+	bool interleaved)
+{
+	char *sources[3] = {vertex_source, geometry_source, fragment_source};
+	uint64_t sizes[3] = {0, 0, 0};
+	uint64_t varyings_size = 0;
+	uint8_t *payload = NULL;
+	uint64_t offset = 0;
+	uint32_t i = 0;
+	while (i < 3) {
+		if (sources[i]) {
+			sizes[i] = strlen(sources[i]) + 1;
+		}
+		i++;
+	}
+	i = 0;
+	while (i < varyings_count) {
+		varyings_size = varyings_size + strlen(varyings[i]) + 1;
+		i++;
+	}
+	payload = malloc(sizes[0] + sizes[1] + sizes[2] + varyings_size + 1);
+	if (!payload) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to allocate trace of shader.\n");
+#endif
+		return;
+	}
+	i = 0;
+	while (i < 3) {
+		memcpy(payload + offset, sources[i], sizes[i]);
+		offset = offset + sizes[i];
+		i++;
+	}
+	i = 0;
+	while (i < varyings_count) {
+		memcpy(payload + offset, varyings[i], strlen(varyings[i]) + 1);
+		offset = offset + strlen(varyings[i]) + 1;
+		i++;
+	}
+	GFW_TRACE_CALL(GFW_TRACE_CALL_INIT_SHADER, payload, offset,
+		GFW_TRACE_UINT(shader->program_gl_id),
+		GFW_TRACE_UINT(sizes[0]),
+		GFW_TRACE_UINT(sizes[1]),
+		GFW_TRACE_UINT(sizes[2]),
+		GFW_TRACE_UINT(varyings_count),
+		GFW_TRACE_UINT(interleaved));
+	free(payload);
+}
+
+/* The whole requested state is recorded whenever a draw is about to flush changes */
+static void gfw_trace_state(void)
+{
+	struct gfw_render_state *requested = &gfw_requested_state;
+	struct gfw_pipeline_state_descriptor descriptor;
+	memset(&descriptor, 0, sizeof(descriptor));
+	descriptor.blend = requested->blend;
+	descriptor.blend_equation_rgb = requested->blend_equation_rgb;
+	descriptor.blend_equation_alpha = requested->blend_equation_alpha;
+	descriptor.blend_factor_source_rgb = requested->blend_factor_source_rgb;
+	descriptor.blend_factor_destination_rgb = requested->blend_factor_destination_rgb;
+	descriptor.blend_factor_source_alpha = requested->blend_factor_source_alpha;
+	descriptor.blend_factor_destination_alpha = requested->blend_factor_destination_alpha;
+	memcpy(descriptor.blend_color, requested->blend_color, sizeof(descriptor.blend_color));
+	descriptor.color_logic_operation = requested->color_logic_operation;
+	descriptor.color_logic_operation_mode = requested->color_logic_operation_mode;
+	descriptor.cull_face = requested->cull_face;
+	descriptor.cull_face_mode = requested->cull_face_mode;
+	descriptor.front_face = requested->front_face;
+	descriptor.depth_clamp = requested->depth_clamp;
+	descriptor.depth_test = requested->depth_test;
+	descriptor.depth_test_function = requested->depth_test_function;
+	descriptor.dither = requested->dither;
+	descriptor.line_smooth = requested->line_smooth;
+	descriptor.clip_distances = requested->clip_distances;
+	descriptor.point_size = requested->point_size;
+	descriptor.line_width = requested->line_width;
+	GFW_TRACE_CALL(GFW_TRACE_CALL_STATE, &descriptor, sizeof(descriptor),
+		GFW_TRACE_UINT(gfw_viewport_requested),
+		GFW_TRACE_INT(requested->viewport[0]),
+		GFW_TRACE_INT(requested->viewport[1]),
+		GFW_TRACE_INT(requested->viewport[2]),
+		GFW_TRACE_INT(requested->viewport[3]),
+		GFW_TRACE_FLOAT(requested->depth_range[0]),
+		GFW_TRACE_FLOAT(requested->depth_range[1]));
+}
+#endif
+
+void gfw_trace_frame(void)
+{
+	GFW_TRACE_CALL(GFW_TRACE_CALL_FRAME, NULL, 0, GFW_TRACE_UINT(0));
+}
+
+void gfw_free_trace(void)
+{
+#ifdef GFW_TRACE
+	if (!gfw_trace_file) {
+		return;
+	}
+	gfw_trace_submit();
+#ifdef __unix__
+	pthread_mutex_lock(&gfw_trace_mutex);
+	gfw_trace_stopping = true;
+	pthread_cond_broadcast(&gfw_trace_condition);
+	pthread_mutex_unlock(&gfw_trace_mutex);
+	pthread_join(gfw_trace_writer, NULL);
+	gfw_trace_stopping = false;
+#endif
+	fclose(gfw_trace_file);
+	gfw_trace_file = NULL;
+	gfw_trace_mapped_vertex_data = NULL;
+	free(gfw_trace_buffers[0]);
+	free(gfw_trace_buffers[1]);
+	gfw_trace_buffers[0] = NULL;
+	gfw_trace_buffers[1] = NULL;
+	gfw_trace_buffer = 0;
+	gfw_trace_size = 0;
+#endif
+}
+
+/* Objects created before the trace starts are unknown to the replay */
+bool gfw_init_trace(char *path)
+{
+	bool success = true;
+#ifdef GFW_TRACE
+	struct gfw_trace_header header = {GFW_TRACE_MAGIC, GFW_TRACE_VERSION};
+	FILE *file = NULL;
+	if (gfw_trace_file) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: trace already started.\n");
+#endif
+		goto done;
+	}
+	gfw_trace_buffers[0] = malloc(GFW_TRACE_BUFFER_SIZE);
+	gfw_trace_buffers[1] = malloc(GFW_TRACE_BUFFER_SIZE);
+	file = fopen(path, "wb");
+	if (!gfw_trace_buffers[0] || !gfw_trace_buffers[1] || !file || fwrite(&header, sizeof(header), 1, file) != 1) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to open trace file.\n");
+#endif
+		goto done;
+	}
+	gfw_trace_file = file;
+#ifdef __unix__
+	if (pthread_create(&gfw_trace_writer, NULL, gfw_trace_write, NULL) != 0) {
+		success = false;
+		gfw_trace_file = NULL;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to start trace writer.\n");
+#endif
+		goto done;
+	}
+#endif
+	/* The first draw records the full state */
+	gfw_state_dirty = gfw_state_dirty | GFW_STATE_ALL;
+done:
+	if (!success) {
+		if (file) {
+			fclose(file);
+		}
+		free(gfw_trace_buffers[0]);
+		free(gfw_trace_buffers[1]);
+		gfw_trace_buffers[0] = NULL;
+		gfw_trace_buffers[1] = NULL;
+	}
+#else
+	(void)path;
+	success = false;
+#endif
+	return success;
+}
+
+/* Deletion */
+#ifdef GFW_DEFERRED_DELETION
+struct gfw_deletion {
+	enum gfw_deletion_type type;
+	GLuint gl_id;
+	uint64_t frame_index;
+};
+
+static struct gfw_deletion *gfw_deletions = NULL;
+static size_t gfw_deletions_first = 0;
+static size_t gfw_deletions_count = 0;
+static size_t gfw_deletions_capacity = 0;
+
+static void gfw_delete_objects(enum gfw_deletion_type type, GLuint *gl_ids, GLsizei count)
+{
+	GLsizei i = 0;
+	switch (type) {
+	case GFW_DELETION_BUFFER:
+		glDeleteBuffers(count, gl_ids);
+		break;
+	case GFW_DELETION_VERTEX_ARRAY:
+		glDeleteVertexArrays(count, gl_ids);
+		break;
+	case GFW_DELETION_FRAMEBUFFER:
+		glDeleteFramebuffers(count, gl_ids);
+		break;
+	case GFW_DELETION_TEXTURE:
+		glDeleteTextures(count, gl_ids);
+		break;
+	case GFW_DELETION_PROGRAM:
+		/* Programs have no array variant */
+		while (i < count) {
+			glDeleteProgram(gl_ids[i]);
+			i++;
+		}
+		break;
+	}
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to delete objects.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+}
+
+/* Objects are deleted once the frame that last used them is complete */
+static void gfw_defer_deletion(enum gfw_deletion_type type, GLuint gl_id)
+{
+	struct gfw_deletion *deletions = NULL;
+	size_t capacity = 0;
+	if (gl_id == 0) {
+		return;
+	}
+	/* Until the first gfw_end_frame no frame fence would ever retire the entry */
+	if (gfw_get_frame_index() == 1) {
+		gfw_delete_objects(type, &gl_id, 1);
+		return;
+	}
+	if (gfw_deletions_count == gfw_deletions_capacity && gfw_deletions_first > 0) {
+		memmove(gfw_deletions, gfw_deletions + gfw_deletions_first, sizeof(*gfw_deletions) * (gfw_deletions_count - gfw_deletions_first));
+		gfw_deletions_count = gfw_deletions_count - gfw_deletions_first;
+		gfw_deletions_first = 0;
+	}
+	if (gfw_deletions_count == gfw_deletions_capacity) {
+		capacity = gfw_deletions_capacity > 0 ? gfw_deletions_capacity * 2 : 64;
+		deletions = realloc(gfw_deletions, sizeof(*deletions) * capacity);
+		/* Without memory the object is deleted right away */
+		if (!deletions) {
+			gfw_delete_objects(type, &gl_id, 1);
+			return;
+		}
+		gfw_deletions = deletions;
+		gfw_deletions_capacity = capacity;
 	}
+	gfw_deletions[gfw_deletions_count].type = type;
+	gfw_deletions[gfw_deletions_count].gl_id = gl_id;
+	gfw_deletions[gfw_deletions_count].frame_index = gfw_get_frame_index();
+	gfw_deletions_count = gfw_deletions_count + 1;
+}
+
+/* Frame indices only increase, so the queue is drained from the front, names are batched per type */
+static void gfw_process_deletions(size_t budget, bool all)
+{
+	GLuint batches[GFW_DELETION_TYPES][GFW_DELETION_BATCH_SIZE];
+	GLsizei counts[GFW_DELETION_TYPES] = {0};
+	struct gfw_deletion *deletion = NULL;
+	uint32_t i = 0;
+	while (budget > 0 && gfw_deletions_first < gfw_deletions_count) {
+		deletion = &gfw_deletions[gfw_deletions_first];
+		if (!all && !gfw_is_frame_complete(deletion->frame_index)) {
+			break;
+		}
+		if (counts[deletion->type] == GFW_DELETION_BATCH_SIZE) {
+			gfw_delete_objects(deletion->type, batches[deletion->type], counts[deletion->type]);
+			counts[deletion->type] = 0;
+		}
+		batches[deletion->type][counts[deletion->type]] = deletion->gl_id;
+		counts[deletion->type] = counts[deletion->type] + 1;
+		gfw_deletions_first = gfw_deletions_first + 1;
+		budget = budget - 1;
+	}
+	while (i < GFW_DELETION_TYPES) {
+		if (counts[i] > 0) {
+			gfw_delete_objects(i, batches[i], counts[i]);
+		}
+		i++;
+	}
+	if (gfw_deletions_first == gfw_deletions_count) {
+		gfw_deletions_first = 0;
+		gfw_deletions_count = 0;
+	}
+}
+#endif
+
+/* Frame */
+static GLsync gfw_frame_fences[GFW_FRAMES_MAX] = {0};
+static uint32_t gfw_max_frames_in_flight = GFW_FRAMES_IN_FLIGHT;
+static uint64_t gfw_submitted_frame_index = 0;
+static uint64_t gfw_completed_frame_index = 0;
+static uint64_t gfw_frame_wait_time = 0;
+static uint64_t gfw_frame_total_wait_time = 0;
+static uint64_t gfw_waited_frames = 0;
+
+static uint64_t gfw_get_time(void)
+{
+	uint64_t time = 0;
+#ifdef __unix__
+	struct timespec clock_time = {0};
+	clock_gettime(CLOCK_MONOTONIC, &clock_time);
+	time = (uint64_t)clock_time.tv_sec * 1000000000 + clock_time.tv_nsec;
+#endif
+	return time;
+}
+
+/* Fences signal in order, so frames retire from the oldest */
+static bool gfw_retire_frame(bool wait)
+{
+	GLsync *fence = &gfw_frame_fences[(gfw_completed_frame_index + 1) % GFW_FRAMES_MAX];
+	GLenum status = GL_ALREADY_SIGNALED;
+	if (*fence) {
+		status = glClientWaitSync(*fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? GFW_FRAME_WAIT_TIMEOUT : 0);
+		while (wait && status == GL_TIMEOUT_EXPIRED) {
+			status = glClientWaitSync(*fence, 0, GFW_FRAME_WAIT_TIMEOUT);
+		}
+		if (status == GL_TIMEOUT_EXPIRED) {
+			return false;
+		}
+#ifdef GFW_CHECK_BACKEND_ERROR
+		if (status == GL_WAIT_FAILED) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+			printf("Error: failed to wait for frame fence.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+			abort();
+#endif
+		}
+#endif
+		glDeleteSync(*fence);
+		*fence = NULL;
+	}
+	gfw_completed_frame_index = gfw_completed_frame_index + 1;
+	return true;
+}
+
+void gfw_get_frame_statistics(struct gfw_frame_statistics *statistics)
+{
+	statistics->frame_index = gfw_submitted_frame_index + 1;
+	statistics->completed_frame_index = gfw_completed_frame_index;
+	statistics->frames_in_flight = (uint32_t)(gfw_submitted_frame_index - gfw_completed_frame_index);
+	statistics->max_frames_in_flight = gfw_max_frames_in_flight;
+	statistics->wait_time = gfw_frame_wait_time;
+	statistics->total_wait_time = gfw_frame_total_wait_time;
+	statistics->waited_frames = gfw_waited_frames;
+#ifdef GFW_DEFERRED_DELETION
+	statistics->pending_deletions = gfw_deletions_count - gfw_deletions_first;
+#else
+	statistics->pending_deletions = 0;
+#endif
+}
+
+/* Resources used in a frame can be reused once it is complete */
+bool gfw_is_frame_complete(uint64_t frame_index)
+{
+	return frame_index <= gfw_completed_frame_index;
+}
+
+uint64_t gfw_get_completed_frame_index(void)
+{
+	return gfw_completed_frame_index;
+}
+
+/* Commands issued now are covered by the fence of the next gfw_end_frame */
+uint64_t gfw_get_frame_index(void)
+{
+	return gfw_submitted_frame_index + 1;
+}
+
+void gfw_end_frame(void)
+{
+	/* Without gfw_begin_frame the fence ring can still be full */
+	while (gfw_submitted_frame_index - gfw_completed_frame_index >= GFW_FRAMES_MAX) {
+		gfw_retire_frame(true);
+	}
+	gfw_frame_fences[(gfw_submitted_frame_index + 1) % GFW_FRAMES_MAX] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#ifdef GFW_CHECK_BACKEND_ERROR
+	if (glGetError() != GL_NO_ERROR) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: failed to insert frame fence.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+	}
+#endif
+	gfw_submitted_frame_index = gfw_submitted_frame_index + 1;
+}
+
+/* Blocks only while the maximum number of frames is in flight */
+void gfw_begin_frame(void)
+{
+	uint64_t begin = 0;
+	gfw_frame_wait_time = 0;
+	while (gfw_completed_frame_index < gfw_submitted_frame_index) {
+		if (!gfw_retire_frame(false)) {
+			break;
+		}
+	}
+	if (gfw_submitted_frame_index - gfw_completed_frame_index >= gfw_max_frames_in_flight) {
+		begin = gfw_get_time();
+		while (gfw_submitted_frame_index - gfw_completed_frame_index >= gfw_max_frames_in_flight) {
+			gfw_retire_frame(true);
+		}
+		gfw_frame_wait_time = gfw_get_time() - begin;
+		gfw_frame_total_wait_time = gfw_frame_total_wait_time + gfw_frame_wait_time;
+		gfw_waited_frames = gfw_waited_frames + 1;
+	}
+#ifdef GFW_DEFERRED_DELETION
+	gfw_process_deletions(GFW_DELETIONS_PER_FRAME, false);
+#endif
+}
+
+bool gfw_set_max_frames_in_flight(uint32_t count)
+{
+	bool success = true;
+	if (count == 0 || count > GFW_FRAMES_MAX) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: frames in flight must be between 1 and %u.\n", GFW_FRAMES_MAX);
+#endif
+		goto done;
+	}
+	gfw_max_frames_in_flight = count;
+done:
+	return success;
+}
+
+/* Waits for every submitted frame, frame indices keep increasing */
+void gfw_free_frames(void)
+{
+	while (gfw_completed_frame_index < gfw_submitted_frame_index) {
+		gfw_retire_frame(true);
+	}
+#ifdef GFW_DEFERRED_DELETION
+	/* Objects freed after the last frame are covered by no fence */
+	if (gfw_deletions_first < gfw_deletions_count) {
+		glFinish();
+	}
+	gfw_process_deletions(SIZE_MAX, true);
+	free(gfw_deletions);
+	gfw_deletions = NULL;
+	gfw_deletions_first = 0;
+	gfw_deletions_count = 0;
+	gfw_deletions_capacity = 0;
+#endif
+}
+
+/* Handle */
+#if GFW_HANDLE_INDEX_BITS > 24
+#error "GFW_HANDLE_INDEX_BITS must be at most 24"
+#endif
+#define GFW_HANDLE_GENERATION_SHIFT 24
+#define GFW_HANDLE_TYPE_SHIFT 56
+#define GFW_HANDLE_INDEX_MASK ((1u << GFW_HANDLE_INDEX_BITS) - 1)
+#define GFW_HANDLE_NO_FREE UINT32_MAX
+
+/* Hot fields are kept in parallel arrays, the objects themselves never move */
+struct gfw_handle_pool {
+	uint32_t *generations;
+	uint32_t *next_free;
+	bool *alive;
+	gfw_uint_t *gl_ids;
+	uint64_t *sizes;
+	uint32_t first_free;
+	uint32_t capacity;
+	uint32_t count;
+};
+
+static struct gfw_handle_pool gfw_handle_pools[GFW_HANDLE_TYPES_COUNT] = {0};
+static struct gfw_texture *gfw_handle_textures = NULL;
+static struct gfw_vertex_data *gfw_handle_vertex_data = NULL;
+static struct gfw_shader *gfw_handle_shaders = NULL;
+static struct gfw_framebuffer *gfw_handle_framebuffers = NULL;
+static struct gfw_vertex_state *gfw_handle_vertex_states = NULL;
+
+/* Type, 32-bit generation and slot index, so a lookup is a mask and two compares */
+static gfw_handle_t gfw_make_handle(enum gfw_handle_type type, uint32_t index)
+{
+	return ((gfw_handle_t)type << GFW_HANDLE_TYPE_SHIFT)
+		| ((gfw_handle_t)gfw_handle_pools[type].generations[index] << GFW_HANDLE_GENERATION_SHIFT)
+		| index;
+}
+
+static bool gfw_get_handle_index(enum gfw_handle_type type, gfw_handle_t handle, uint32_t *index)
+{
+	struct gfw_handle_pool *pool = &gfw_handle_pools[type];
+	uint32_t i = (uint32_t)handle & GFW_HANDLE_INDEX_MASK;
+	if ((handle >> GFW_HANDLE_TYPE_SHIFT) != (gfw_handle_t)type
+		|| i >= pool->capacity
+		|| !pool->alive[i]
+		|| pool->generations[i] != (uint32_t)(handle >> GFW_HANDLE_GENERATION_SHIFT)) {
+		return false;
+	}
+	*index = i;
+	return true;
+}
+
+static bool gfw_find_handle_object(enum gfw_handle_type type, const void *object, uint32_t *index)
+{
+	uintptr_t objects = 0;
+	size_t object_size = 0;
+	if (type == GFW_HANDLE_TYPE_TEXTURE) {
+		objects = (uintptr_t)gfw_handle_textures;
+		object_size = sizeof(*gfw_handle_textures);
+	} else if (type == GFW_HANDLE_TYPE_VERTEX_DATA) {
+		objects = (uintptr_t)gfw_handle_vertex_data;
+		object_size = sizeof(*gfw_handle_vertex_data);
+	} else if (type == GFW_HANDLE_TYPE_SHADER) {
+		objects = (uintptr_t)gfw_handle_shaders;
+		object_size = sizeof(*gfw_handle_shaders);
+	} else if (type == GFW_HANDLE_TYPE_FRAMEBUFFER) {
+		objects = (uintptr_t)gfw_handle_framebuffers;
+		object_size = sizeof(*gfw_handle_framebuffers);
+	} else {
+		objects = (uintptr_t)gfw_handle_vertex_states;
+		object_size = sizeof(*gfw_handle_vertex_states);
+	}
+	if (objects == 0 || (uintptr_t)object < objects || (uintptr_t)object >= objects + object_size * gfw_handle_pools[type].capacity) {
+		return false;
+	}
+	*index = (uint32_t)(((uintptr_t)object - objects) / object_size);
+	return true;
+}
+
+/* Pooled objects can also be freed and initialized again through the struct API */
+static void gfw_update_handle(enum gfw_handle_type type, const void *object, gfw_uint_t gl_id, uint64_t size)
+{
+	struct gfw_handle_pool *pool = &gfw_handle_pools[type];
+	uint32_t index = 0;
+	if (gfw_find_handle_object(type, object, &index) && pool->alive[index]) {
+		pool->gl_ids[index] = gl_id;
+		pool->sizes[index] = size;
+	}
+}
+
+static bool gfw_allocate_handle_index(enum gfw_handle_type type, uint32_t *index)
+{
+	struct gfw_handle_pool *pool = &gfw_handle_pools[type];
+	/* Also covers pools that were never initialized */
+	if (pool->first_free >= pool->capacity) {
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: no free handle.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+		abort();
+#endif
+		return false;
+	}
+	*index = pool->first_free;
+	pool->first_free = pool->next_free[*index];
+	return true;
+}
+
+static void gfw_release_handle_index(enum gfw_handle_type type, uint32_t index)
+{
+	struct gfw_handle_pool *pool = &gfw_handle_pools[type];
+	pool->next_free[index] = pool->first_free;
+	pool->first_free = index;
+}
+
+static gfw_handle_t gfw_commit_handle(enum gfw_handle_type type, uint32_t index, gfw_uint_t gl_id, uint64_t size)
+{
+	struct gfw_handle_pool *pool = &gfw_handle_pools[type];
+	pool->alive[index] = true;
+	pool->gl_ids[index] = gl_id;
+	pool->sizes[index] = size;
+	pool->count = pool->count + 1;
+	return gfw_make_handle(type, index);
+}
+
+/* Generation 0 is skipped, so GFW_HANDLE_NULL is never valid */
+static void gfw_retire_handle(enum gfw_handle_type type, uint32_t index)
+{
+	struct gfw_handle_pool *pool = &gfw_handle_pools[type];
+	pool->alive[index] = false;
+	pool->gl_ids[index] = 0;
+	pool->sizes[index] = 0;
+	pool->generations[index] = pool->generations[index] + 1;
+	if (pool->generations[index] == 0) {
+		pool->generations[index] = 1;
+	}
+	pool->count = pool->count - 1;
+	gfw_release_handle_index(type, index);
+}
+
+static void gfw_report_stale_handle(void)
+{
+#ifdef GFW_PRINT_BACKEND_ERROR
+	printf("Error: invalid or stale handle.\n");
+#endif
+#ifdef GFW_ABORT_ON_BACKEND_ERROR
+	abort();
 #endif
 }
+
+struct gfw_vertex_state *gfw_get_vertex_state(gfw_handle_t handle)
+{
+	uint32_t index = 0;
+	if (!gfw_get_handle_index(GFW_HANDLE_TYPE_VERTEX_STATE, handle, &index)) {
+		return NULL;
+	}
+	return &gfw_handle_vertex_states[index];
+}
+
+void gfw_destroy_vertex_state(gfw_handle_t handle)
+{
+	uint32_t index = 0;
+	if (!gfw_get_handle_index(GFW_HANDLE_TYPE_VERTEX_STATE, handle, &index)) {
+		gfw_report_stale_handle();
+		return;
+	}
+	gfw_free_vertex_state(&gfw_handle_vertex_states[index]);
+	gfw_retire_handle(GFW_HANDLE_TYPE_VERTEX_STATE, index);
+}
+
+gfw_handle_t gfw_create_vertex_state(void)
+{
+	gfw_handle_t handle = GFW_HANDLE_NULL;
+	uint32_t index = 0;
+	if (!gfw_allocate_handle_index(GFW_HANDLE_TYPE_VERTEX_STATE, &index)) {
+		goto done;
+	}
+	if (!gfw_init_vertex_state(&gfw_handle_vertex_states[index])) {
+		gfw_release_handle_index(GFW_HANDLE_TYPE_VERTEX_STATE, index);
+		goto done;
+	}
+	handle = gfw_commit_handle(GFW_HANDLE_TYPE_VERTEX_STATE, index, gfw_handle_vertex_states[index].vao_gl_id, 0);
+done:
+	return handle;
+}
+
+struct gfw_framebuffer *gfw_get_framebuffer(gfw_handle_t handle)
+{
+	uint32_t index = 0;
+	if (!gfw_get_handle_index(GFW_HANDLE_TYPE_FRAMEBUFFER, handle, &index)) {
+		return NULL;
+	}
+	return &gfw_handle_framebuffers[index];
+}
+
+void gfw_destroy_framebuffer(gfw_handle_t handle)
+{
+	uint32_t index = 0;
+	if (!gfw_get_handle_index(GFW_HANDLE_TYPE_FRAMEBUFFER, handle, &index)) {
+		gfw_report_stale_handle();
+		return;
+	}
+	gfw_free_framebuffer(&gfw_handle_framebuffers[index]);
+	gfw_retire_handle(GFW_HANDLE_TYPE_FRAMEBUFFER, index);
+}
+
+gfw_handle_t gfw_create_framebuffer(gfw_handle_t texture)
+{
+	gfw_handle_t handle = GFW_HANDLE_NULL;
+	uint32_t texture_index = 0;
+	uint32_t index = 0;
+	if (!gfw_get_handle_index(GFW_HANDLE_TYPE_TEXTURE, texture, &texture_index)) {
+		gfw_report_stale_handle();
+		goto done;
+	}
+	if (!gfw_allocate_handle_index(GFW_HANDLE_TYPE_FRAMEBUFFER, &index)) {
+		goto done;
+	}
+	if (!gfw_init_framebuffer(&gfw_handle_framebuffers[index], &gfw_handle_textures[texture_index])) {
+		gfw_release_handle_index(GFW_HANDLE_TYPE_FRAMEBUFFER, index);
+		goto done;
+	}
+	handle = gfw_commit_handle(GFW_HANDLE_TYPE_FRAMEBUFFER, index, gfw_handle_framebuffers[index].framebuffer_gl_id, 0);
+done:
+	return handle;
+}
+
+struct gfw_shader *gfw_get_shader(gfw_handle_t handle)
+{
+	uint32_t index = 0;
+	if (!gfw_get_handle_index(GFW_HANDLE_TYPE_SHADER, handle, &index)) {
+		return NULL;
+	}
+	return &gfw_handle_shaders[index];
+}
+
+void gfw_destroy_shader(gfw_handle_t handle)
+{
+	uint32_t index = 0;
+	if (!gfw_get_handle_index(GFW_HANDLE_TYPE_SHADER, handle, &index)) {
+		gfw_report_stale_handle();
+		return;
+	}
+	gfw_free_shader(&gfw_handle_shaders[index]);
+	gfw_retire_handle(GFW_HANDLE_TYPE_SHADER, index);
+}
+
+gfw_handle_t gfw_create_shader(char *vertex_source, char *geometry_source, char *fragment_source)
+{
+	gfw_handle_t handle = GFW_HANDLE_NULL;
+	uint32_t index = 0;
+	if (!gfw_allocate_handle_index(GFW_HANDLE_TYPE_SHADER, &index)) {
+		goto done;
+	}
+	if (!gfw_init_shader(&gfw_handle_shaders[index], vertex_source, geometry_source, fragment_source)) {
+		gfw_release_handle_index(GFW_HANDLE_TYPE_SHADER, index);
+		goto done;
+	}
+	handle = gfw_commit_handle(GFW_HANDLE_TYPE_SHADER, index, gfw_handle_shaders[index].program_gl_id, 0);
+done:
+	return handle;
+}
+
+struct gfw_vertex_data *gfw_get_vertex_data(gfw_handle_t handle)
+{
+	uint32_t index = 0;
+	if (!gfw_get_handle_index(GFW_HANDLE_TYPE_VERTEX_DATA, handle, &index)) {
+		return NULL;
+	}
+	return &gfw_handle_vertex_data[index];
+}
+
+void gfw_destroy_vertex_data(gfw_handle_t handle)
+{
+	uint32_t index = 0;
+	if (!gfw_get_handle_index(GFW_HANDLE_TYPE_VERTEX_DATA, handle, &index)) {
+		gfw_report_stale_handle();
+		return;
+	}
+	gfw_free_vertex_data(&gfw_handle_vertex_data[index]);
+	gfw_retire_handle(GFW_HANDLE_TYPE_VERTEX_DATA, index);
+}
+
+gfw_handle_t gfw_create_vertex_data(size_t size, enum gfw_vertex_data_usage usage)
+{
+	gfw_handle_t handle = GFW_HANDLE_NULL;
+	uint32_t index = 0;
+	if (!gfw_allocate_handle_index(GFW_HANDLE_TYPE_VERTEX_DATA, &index)) {
+		goto done;
+	}
+	if (!gfw_init_vertex_data(&gfw_handle_vertex_data[index], size, usage)) {
+		gfw_release_handle_index(GFW_HANDLE_TYPE_VERTEX_DATA, index);
+		goto done;
+	}
+	handle = gfw_commit_handle(GFW_HANDLE_TYPE_VERTEX_DATA, index, gfw_handle_vertex_data[index].vbo_gl_id, size);
+done:
+	return handle;
+}
+
+struct gfw_texture *gfw_get_texture(gfw_handle_t handle)
+{
+	uint32_t index = 0;
+	if (!gfw_get_handle_index(GFW_HANDLE_TYPE_TEXTURE, handle, &index)) {
+		return NULL;
+	}
+	return &gfw_handle_textures[index];
+}
+
+void gfw_destroy_texture(gfw_handle_t handle)
+{
+	uint32_t index = 0;
+	if (!gfw_get_handle_index(GFW_HANDLE_TYPE_TEXTURE, handle, &index)) {
+		gfw_report_stale_handle();
+		return;
+	}
+	gfw_free_texture(&gfw_handle_textures[index]);
+	gfw_retire_handle(GFW_HANDLE_TYPE_TEXTURE, index);
+}
+
+gfw_handle_t gfw_create_texture(struct gfw_texture_descriptor descriptor)
+{
+	gfw_handle_t handle = GFW_HANDLE_NULL;
+	uint32_t index = 0;
+	if (!gfw_allocate_handle_index(GFW_HANDLE_TYPE_TEXTURE, &index)) {
+		goto done;
+	}
+	if (!gfw_init_texture(&gfw_handle_textures[index], descriptor)) {
+		gfw_release_handle_index(GFW_HANDLE_TYPE_TEXTURE, index);
+		goto done;
+	}
+	handle = gfw_commit_handle(GFW_HANDLE_TYPE_TEXTURE,
+		index,
+		gfw_handle_textures[index].texture_gl_id,
+		(uint64_t)descriptor.width * descriptor.height * gfw_get_texture_pixel_size(descriptor.pixel_format));
+done:
+	return handle;
+}
+
+/* Sweeps only touch the size array of the pool */
+uint64_t gfw_get_handles_size(enum gfw_handle_type type)
+{
+	struct gfw_handle_pool *pool = &gfw_handle_pools[type];
+	uint64_t size = 0;
+	uint32_t i = 0;
+	while (i < pool->capacity) {
+		size = size + pool->sizes[i];
+		i++;
+	}
+	return size;
+}
+
+uint32_t gfw_get_handles(enum gfw_handle_type type, gfw_handle_t *handles, uint32_t handles_capacity)
+{
+	struct gfw_handle_pool *pool = &gfw_handle_pools[type];
+	uint32_t count = 0;
+	uint32_t i = 0;
+	while (i < pool->capacity && count < handles_capacity) {
+		if (pool->alive[i]) {
+			handles[count] = gfw_make_handle(type, i);
+			count++;
+		}
+		i++;
+	}
+	return count;
+}
+
+uint32_t gfw_get_handles_count(enum gfw_handle_type type)
+{
+	return gfw_handle_pools[type].count;
+}
+
+bool gfw_is_handle_valid(gfw_handle_t handle)
+{
+	uint32_t index = 0;
+	gfw_handle_t type = handle >> GFW_HANDLE_TYPE_SHIFT;
+	return type < GFW_HANDLE_TYPES_COUNT && gfw_get_handle_index(type, handle, &index);
+}
+
+/* Vertex states and framebuffers go first, since they refer to vertex data and textures */
+void gfw_free_handles(void)
+{
+	struct gfw_handle_pool *pool = NULL;
+	uint32_t type = GFW_HANDLE_TYPES_COUNT;
+	uint32_t i = 0;
+	while (type > 0) {
+		type = type - 1;
+		pool = &gfw_handle_pools[type];
+		i = 0;
+		while (i < pool->capacity) {
+			if (pool->alive[i]) {
+				if (type == GFW_HANDLE_TYPE_VERTEX_STATE) {
+					gfw_free_vertex_state(&gfw_handle_vertex_states[i]);
+				} else if (type == GFW_HANDLE_TYPE_FRAMEBUFFER) {
+					gfw_free_framebuffer(&gfw_handle_framebuffers[i]);
+				} else if (type == GFW_HANDLE_TYPE_SHADER) {
+					gfw_free_shader(&gfw_handle_shaders[i]);
+				} else if (type == GFW_HANDLE_TYPE_VERTEX_DATA) {
+					gfw_free_vertex_data(&gfw_handle_vertex_data[i]);
+				} else {
+					gfw_free_texture(&gfw_handle_textures[i]);
+				}
+			}
+			i++;
+		}
+		free(pool->generations);
+		free(pool->next_free);
+		free(pool->alive);
+		free(pool->gl_ids);
+		free(pool->sizes);
+		memset(pool, 0, sizeof(*pool));
+		pool->first_free = GFW_HANDLE_NO_FREE;
+	}
+	free(gfw_handle_textures);
+	free(gfw_handle_vertex_data);
+	free(gfw_handle_shaders);
+	free(gfw_handle_framebuffers);
+	free(gfw_handle_vertex_states);
+	gfw_handle_textures = NULL;
+	gfw_handle_vertex_data = NULL;
+	gfw_handle_shaders = NULL;
+	gfw_handle_framebuffers = NULL;
+	gfw_handle_vertex_states = NULL;
+}
+
+/* Pools never grow, so pointers from gfw_get_* stay valid while the handle is */
+bool gfw_init_handles(uint32_t capacity)
+{
+	bool success = true;
+	struct gfw_handle_pool *pool = NULL;
+	uint32_t type = 0;
+	uint32_t i = 0;
+	if (capacity == 0 || capacity > GFW_HANDLE_INDEX_MASK + 1 || gfw_handle_textures) {
+		success = false;
+#ifdef GFW_PRINT_BACKEND_ERROR
+		printf("Error: invalid handle capacity or handles already initialized.\n");
+#endif
+		goto done;
+	}
+	gfw_handle_textures = calloc(capacity, sizeof(*gfw_handle_textures));
+	gfw_handle_vertex_data = calloc(capacity, sizeof(*gfw_handle_vertex_data));
+	gfw_handle_shaders = calloc(capacity, sizeof(*gfw_handle_shaders));
+	gfw_handle_framebuffers = calloc(capacity, sizeof(*gfw_handle_framebuffers));
+	gfw_handle_vertex_states = calloc(capacity, sizeof(*gfw_handle_vertex_states));
+	if (!gfw_handle_textures || !gfw_handle_vertex_data || !gfw_handle_shaders || !gfw_handle_framebuffers || !gfw_handle_vertex_states) {
+		success = false;
+		gfw_free_handles();
+		goto done;
+	}
+	while (type < GFW_HANDLE_TYPES_COUNT) {
+		pool = &gfw_handle_pools[type];
+		pool->generations = malloc(sizeof(*pool->generations) * capacity);
+		pool->next_free = malloc(sizeof(*pool->next_free) * capacity);
+		pool->alive = calloc(capacity, sizeof(*pool->alive));
+		pool->gl_ids = calloc(capacity, sizeof(*pool->gl_ids));
+		pool->sizes = calloc(capacity, sizeof(*pool->sizes));
+		pool->count = 0;
+		if (!pool->generations || !pool->next_free || !pool->alive || !pool->gl_ids || !pool->sizes) {
+			success = false;
+			gfw_free_handles();
+			goto done;
+		}
+		pool->capacity = capacity;
+		i = 0;
+		while (i < capacity) {
+			pool->generations[i] = 1;
+			pool->next_free[i] = i + 1 < capacity ? i + 1 : GFW_HANDLE_NO_FREE;
+			i++;
+		}
+		pool->first_free = 0;
+		type++;
+	}
+done:
+	return success;
+}
@@ -35,6 +35,7 @@ typedef GLuint gfw_uint_t;
 typedef GLhalf gfw_half_float_t;
 typedef GLfloat gfw_float_t;
 typedef GLdouble gfw_double_t;
+typedef uint64_t gfw_handle_t;
 
 /* Texture */
 enum gfw_texture_wrap {
@@ -66,6 +67,12 @@ struct gfw_texture_descriptor {
 	void *data;
 };
 
+enum gfw_image_access {
+	GFW_IMAGE_ACCESS_READ_ONLY = GL_READ_ONLY,
+	GFW_IMAGE_ACCESS_WRITE_ONLY = GL_WRITE_ONLY,
+	GFW_IMAGE_ACCESS_READ_WRITE = GL_READ_WRITE
+};
+
 struct gfw_texture {
 	gfw_uint_t texture_gl_id;
 	enum gfw_texture_pixel_format pixel_format;
@@ -92,6 +99,12 @@ enum gfw_vertex_data_usage {
 	GFW_VERTEX_DATA_USAGE_DYNAMIC = GL_DYNAMIC_DRAW
 };
 
+enum gfw_index_type {
+	GFW_INDEX_UBYTE = GL_UNSIGNED_BYTE,
+	GFW_INDEX_USHORT = GL_UNSIGNED_SHORT,
+	GFW_INDEX_UINT = GL_UNSIGNED_INT
+};
+
 enum gfw_attribute_type {
 	GFW_ATTRIBUTE_BYTE = GL_BYTE,
 	GFW_ATTRIBUTE_UBYTE = GL_UNSIGNED_BYTE,
@@ -111,6 +124,7 @@ struct gfw_attribute {
 	bool normalize;
 	size_t stride;
 	size_t offset;
+	uint32_t divisor;
 };
 
 struct gfw_vertex_data {
@@ -122,13 +136,213 @@ struct gfw_vertex_data {
 };
 
 /* Vertex State */
+#ifndef GFW_VERTEX_STATE_MAX_BINDINGS
+#define GFW_VERTEX_STATE_MAX_BINDINGS 4
+#endif
+#ifndef GFW_VERTEX_STATE_MAX_ATTRIBUTES
+#define GFW_VERTEX_STATE_MAX_ATTRIBUTES 16
+#endif
+
 struct gfw_vertex_state {
 	gfw_uint_t vao_gl_id;
+	gfw_uint_t index_vbo_gl_id;
+	gfw_uint_t binding_vbo_gl_ids[GFW_VERTEX_STATE_MAX_BINDINGS];
+	uint32_t binding_layout_hashes[GFW_VERTEX_STATE_MAX_BINDINGS];
+	uint32_t binding_location_masks[GFW_VERTEX_STATE_MAX_BINDINGS];
+	struct gfw_attribute binding_attributes[GFW_VERTEX_STATE_MAX_BINDINGS][GFW_VERTEX_STATE_MAX_ATTRIBUTES];
+	size_t binding_attributes_counts[GFW_VERTEX_STATE_MAX_BINDINGS];
+};
+
+/* Draw list */
+struct gfw_draw_command {
+	gfw_uint_t count;
+	gfw_uint_t instance_count;
+	gfw_uint_t first;
+	gfw_uint_t base_instance;
+};
+
+struct gfw_draw_list {
+	gfw_int_t *firsts;
+	GLsizei *counts;
+	GLvoid **offsets;
+	struct gfw_draw_command *commands;
+	size_t count;
+	size_t capacity;
+	bool instanced;
+};
+
+/* Program cache */
+struct gfw_program_cache_statistics {
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t stores;
 };
 
 /* Shader */
+enum gfw_shader_status {
+	GFW_SHADER_STATUS_PENDING,
+	GFW_SHADER_STATUS_READY,
+	GFW_SHADER_STATUS_FAILED
+};
+
+/* String literals of up to 32 characters hash to the same value as gfw_name_hash */
+#define GFW_NAME_HASH_STEP(name, i, hash) \
+	(((hash) ^ (uint32_t)(uint8_t)((i) < sizeof(name) - 1 ? (name)[(i) < sizeof(name) - 1 ? (i) : 0] : 0)) \
+		* ((i) < sizeof(name) - 1 ? 16777619u : 1u))
+#define GFW_NAME_HASH_4(name, i, hash) \
+	GFW_NAME_HASH_STEP(name, (i) + 3, GFW_NAME_HASH_STEP(name, (i) + 2, \
+		GFW_NAME_HASH_STEP(name, (i) + 1, GFW_NAME_HASH_STEP(name, (i), hash))))
+#define GFW_NAME_HASH_16(name, i, hash) \
+	GFW_NAME_HASH_4(name, (i) + 12, GFW_NAME_HASH_4(name, (i) + 8, \
+		GFW_NAME_HASH_4(name, (i) + 4, GFW_NAME_HASH_4(name, (i), hash))))
+#define GFW_NAME_HASH(name) \
+	(GFW_NAME_HASH_16(name, 16, GFW_NAME_HASH_16(name, 0, 2166136261u)) \
+		+ 0 * sizeof(char[sizeof("" name "") <= 33 ? 1 : -1]))
+
+enum gfw_shader_variable_kind {
+	GFW_SHADER_VARIABLE_NONE,
+	GFW_SHADER_VARIABLE_UNIFORM,
+	GFW_SHADER_VARIABLE_ATTRIBUTE,
+	GFW_SHADER_VARIABLE_BLOCK
+};
+
+struct gfw_shader_variable {
+	uint32_t hash;
+	char *name;
+	enum gfw_shader_variable_kind kind;
+	gfw_int_t location;
+	GLenum type;
+	gfw_int_t size;
+};
+
+struct gfw_shader_uniform {
+	gfw_int_t location;
+	GLenum type;
+	uint32_t size;
+	uint32_t element_size;
+	uint32_t offset;
+	uint32_t locations_offset;
+	uint32_t dirty_first;
+	uint32_t dirty_last;
+	bool transpose;
+	bool dirty;
+};
+
+struct gfw_uniform_statistics {
+	uint64_t skipped;
+	uint64_t deferred;
+	uint64_t issued;
+};
+
 struct gfw_shader {
 	gfw_uint_t program_gl_id;
+	gfw_uint_t vertex_shader_gl_id;
+	gfw_uint_t geometry_shader_gl_id;
+	gfw_uint_t fragment_shader_gl_id;
+	uint64_t program_hash;
+	enum gfw_shader_status status;
+	struct gfw_shader_variable *variables;
+	char *variable_names;
+	uint32_t variables_capacity;
+	uint32_t variables_count;
+	struct gfw_shader_uniform *uniforms;
+	uint32_t uniforms_count;
+	int32_t *uniform_slots;
+	uint32_t *uniform_slot_elements;
+	uint32_t uniform_slots_count;
+	gfw_int_t *uniform_locations;
+	uint32_t *dirty_uniforms;
+	uint32_t dirty_uniforms_count;
+	uint8_t *uniform_storage;
+};
+
+/* Shader stage */
+enum gfw_shader_stage_type {
+	GFW_SHADER_STAGE_VERTEX = GL_VERTEX_SHADER,
+	GFW_SHADER_STAGE_GEOMETRY = GL_GEOMETRY_SHADER,
+	GFW_SHADER_STAGE_FRAGMENT = GL_FRAGMENT_SHADER
+};
+
+struct gfw_shader_stage {
+	gfw_uint_t program_gl_id;
+	enum gfw_shader_stage_type type;
+};
+
+/* Compute */
+enum gfw_barrier_bits {
+	GFW_MEMORY_BARRIER_VERTEX_ATTRIBUTE = 1u << 0,
+	GFW_MEMORY_BARRIER_INDEX = 1u << 1,
+	GFW_MEMORY_BARRIER_UNIFORM = 1u << 2,
+	GFW_MEMORY_BARRIER_TEXTURE_FETCH = 1u << 3,
+	GFW_MEMORY_BARRIER_IMAGE = 1u << 4,
+	GFW_MEMORY_BARRIER_COMMAND = 1u << 5,
+	GFW_MEMORY_BARRIER_TEXTURE_UPDATE = 1u << 6,
+	GFW_MEMORY_BARRIER_BUFFER_UPDATE = 1u << 7,
+	GFW_MEMORY_BARRIER_FRAMEBUFFER = 1u << 8,
+	GFW_MEMORY_BARRIER_TRANSFORM_FEEDBACK = 1u << 9,
+	GFW_MEMORY_BARRIER_STORAGE = 1u << 10,
+	GFW_MEMORY_BARRIER_ALL = (1u << 11) - 1
+};
+
+/* Feedback */
+struct gfw_feedback {
+	gfw_uint_t feedback_gl_id;
+	gfw_uint_t query_gl_id;
+	size_t primitives_written;
+	bool query_pending;
+	bool discard;
+};
+
+/* Shader variants */
+#ifndef GFW_SHADER_VARIANTS_MAX_DEFINES
+#define GFW_SHADER_VARIANTS_MAX_DEFINES 64
+#endif
+
+struct gfw_shader_variant {
+	uint64_t key;
+	struct gfw_shader shader;
+};
+
+struct gfw_shader_variants {
+	char *vertex_source;
+	char *geometry_source;
+	char *fragment_source;
+	char *defines[GFW_SHADER_VARIANTS_MAX_DEFINES];
+	uint32_t defines_count;
+	struct gfw_shader_variant **variants;
+	uint32_t variants_capacity;
+	uint32_t variants_count;
+};
+
+/* Shader watcher */
+#ifndef GFW_SHADER_WATCHER_MAX_DIRECTORIES
+#define GFW_SHADER_WATCHER_MAX_DIRECTORIES 16
+#endif
+
+struct gfw_shader_watch {
+	struct gfw_shader *shader;
+	struct gfw_shader pending;
+	char *paths[3];
+	char *sources[3];
+	bool changed;
+	bool loaded;
+	bool reloading;
+};
+
+struct gfw_shader_watcher_loader;
+
+struct gfw_shader_watcher {
+	int inotify_fd;
+	int directory_descriptors[GFW_SHADER_WATCHER_MAX_DIRECTORIES];
+	char *directories[GFW_SHADER_WATCHER_MAX_DIRECTORIES];
+	uint32_t directories_count;
+	char *include_directory;
+	struct gfw_shader_watch *watches;
+	uint32_t watches_count;
+	uint32_t watches_capacity;
+	uint32_t reloads;
+	uint32_t failures;
+	struct gfw_shader_watcher_loader *loader;
 };
 
 /* Graphic states */
@@ -203,10 +417,292 @@ enum gfw_depth_test_function {
 	GFW_DEPTH_TEST_FUNCTION_ALWAYS = GL_ALWAYS
 };
 
+/* Pipeline state */
+struct gfw_pipeline_state_descriptor {
+	bool blend;
+	enum gfw_blend_equation blend_equation_rgb;
+	enum gfw_blend_equation blend_equation_alpha;
+	enum gfw_blend_factor blend_factor_source_rgb;
+	enum gfw_blend_factor blend_factor_destination_rgb;
+	enum gfw_blend_factor blend_factor_source_alpha;
+	enum gfw_blend_factor blend_factor_destination_alpha;
+	gfw_float_t blend_color[4];
+	bool color_logic_operation;
+	enum gfw_color_logic_operation color_logic_operation_mode;
+	bool cull_face;
+	enum gfw_cull_face_mode cull_face_mode;
+	enum gfw_cull_face_front front_face;
+	bool depth_clamp;
+	bool depth_test;
+	enum gfw_depth_test_function depth_test_function;
+	bool dither;
+	bool line_smooth;
+	uint32_t clip_distances;
+	gfw_float_t point_size;
+	gfw_float_t line_width;
+};
+
+struct gfw_pipeline_state {
+	struct gfw_pipeline_state_descriptor descriptor;
+	uint32_t hash;
+};
+
+/* Command bucket */
+#define GFW_COMMAND_KEY_LAYER_BITS 4
+#define GFW_COMMAND_KEY_PASS_BITS 4
+#define GFW_COMMAND_KEY_SHADER_BITS 12
+#define GFW_COMMAND_KEY_MATERIAL_BITS 16
+#define GFW_COMMAND_KEY_DEPTH_BITS 27
+
+struct gfw_command {
+	uint64_t key;
+	struct gfw_framebuffer *framebuffer;
+	struct gfw_shader *shader;
+	struct gfw_pipeline_state *pipeline_state;
+	struct gfw_texture *texture;
+	struct gfw_vertex_state *vertex_state;
+	enum gfw_primitive primitive;
+	bool indexed;
+	enum gfw_index_type index_type;
+	size_t first;
+	size_t count;
+	void (*prepare)(struct gfw_command *command, void *user_data);
+	void *user_data;
+};
+
+struct gfw_command_bucket_statistics {
+	uint32_t commands;
+	uint32_t unsorted_state_changes;
+	uint32_t state_changes;
+};
+
+struct gfw_command_bucket {
+	struct gfw_command *commands;
+	uint64_t *keys;
+	uint32_t *order;
+	uint64_t *sort_keys;
+	uint32_t *sort_order;
+	size_t count;
+	size_t capacity;
+	bool sorted;
+	struct gfw_command_bucket_statistics statistics;
+};
+
+/* Command list */
+struct gfw_command_list {
+	uint8_t *data;
+	size_t size;
+	size_t capacity;
+	uint32_t commands_count;
+};
+
+/* Debug */
+#ifndef GFW_DEBUG_MESSAGE_MAX_LENGTH
+#define GFW_DEBUG_MESSAGE_MAX_LENGTH 256
+#endif
+#ifndef GFW_DEBUG_MESSAGES_MAX
+#define GFW_DEBUG_MESSAGES_MAX 64
+#endif
+
+enum gfw_debug_severity {
+	GFW_DEBUG_SEVERITY_HIGH = GL_DEBUG_SEVERITY_HIGH,
+	GFW_DEBUG_SEVERITY_MEDIUM = GL_DEBUG_SEVERITY_MEDIUM,
+	GFW_DEBUG_SEVERITY_LOW = GL_DEBUG_SEVERITY_LOW,
+	GFW_DEBUG_SEVERITY_NOTIFICATION = GL_DEBUG_SEVERITY_NOTIFICATION
+};
+
+enum gfw_debug_object {
+	GFW_DEBUG_OBJECT_BUFFER = GL_BUFFER,
+	GFW_DEBUG_OBJECT_SHADER = GL_SHADER,
+	GFW_DEBUG_OBJECT_PROGRAM = GL_PROGRAM,
+	GFW_DEBUG_OBJECT_PROGRAM_PIPELINE = GL_PROGRAM_PIPELINE,
+	GFW_DEBUG_OBJECT_VERTEX_ARRAY = GL_VERTEX_ARRAY,
+	GFW_DEBUG_OBJECT_QUERY = GL_QUERY,
+	GFW_DEBUG_OBJECT_TRANSFORM_FEEDBACK = GL_TRANSFORM_FEEDBACK,
+	GFW_DEBUG_OBJECT_TEXTURE = GL_TEXTURE,
+	GFW_DEBUG_OBJECT_FRAMEBUFFER = GL_FRAMEBUFFER
+};
+
+struct gfw_debug_message {
+	GLenum source;
+	GLenum type;
+	gfw_uint_t id;
+	enum gfw_debug_severity severity;
+	char text[GFW_DEBUG_MESSAGE_MAX_LENGTH];
+};
+
+/* Timer */
+#ifndef GFW_TIMER_FRAMES
+#define GFW_TIMER_FRAMES 4
+#endif
+#ifndef GFW_TIMER_SCOPES_MAX
+#define GFW_TIMER_SCOPES_MAX 128
+#endif
+#ifndef GFW_TIMER_DEPTH_MAX
+#define GFW_TIMER_DEPTH_MAX 16
+#endif
+#ifndef GFW_TIMER_NAME_MAX_LENGTH
+#define GFW_TIMER_NAME_MAX_LENGTH 32
+#endif
+
+struct gfw_timer_scope {
+	char name[GFW_TIMER_NAME_MAX_LENGTH];
+	uint32_t parent;
+	uint32_t depth;
+	uint64_t begin;
+	uint64_t end;
+};
+
+struct gfw_timer_frame {
+	gfw_uint_t queries_gl_ids[2 * GFW_TIMER_SCOPES_MAX];
+	struct gfw_timer_scope scopes[GFW_TIMER_SCOPES_MAX];
+	uint32_t scopes_count;
+	uint32_t last_query;
+	uint64_t index;
+	bool pending;
+};
+
+struct gfw_timer {
+	struct gfw_timer_frame *frames;
+	struct gfw_timer_frame *resolved_frame;
+	uint32_t frame;
+	uint64_t frame_index;
+	uint32_t stack[GFW_TIMER_DEPTH_MAX];
+	uint32_t stack_count;
+	uint32_t ignored_count;
+	bool recording;
+	uint32_t dropped_frames;
+};
+
+/* Statistics */
+#ifndef GFW_STATISTICS_WINDOW
+#define GFW_STATISTICS_WINDOW 60
+#endif
+#ifndef GFW_STATISTICS_HISTOGRAM_BUCKETS
+#define GFW_STATISTICS_HISTOGRAM_BUCKETS 24
+#endif
+
+enum gfw_statistic {
+	GFW_STATISTIC_DRAWS,
+	GFW_STATISTIC_BINDS,
+	GFW_STATISTIC_STATE_CHANGES,
+	GFW_STATISTIC_UNIFORM_UPDATES,
+	GFW_STATISTIC_MAPS,
+	GFW_STATISTIC_UPLOAD_BYTES,
+	GFW_STATISTICS_COUNT
+};
+
+struct gfw_statistics {
+	uint64_t current[GFW_STATISTICS_COUNT];
+	uint64_t frame[GFW_STATISTICS_COUNT];
+	uint64_t history[GFW_STATISTICS_WINDOW][GFW_STATISTICS_COUNT];
+	double averages[GFW_STATISTICS_COUNT];
+	uint32_t histograms[GFW_STATISTICS_COUNT][GFW_STATISTICS_HISTOGRAM_BUCKETS];
+	uint32_t frames_count;
+};
+
+/* Trace */
+#define GFW_TRACE_MAGIC 0x57464754
+#define GFW_TRACE_VERSION 2
+
+enum gfw_trace_call {
+	GFW_TRACE_CALL_FRAME,
+	GFW_TRACE_CALL_STATE,
+	GFW_TRACE_CALL_INIT_TEXTURE,
+	GFW_TRACE_CALL_TEXTURE_PUT_SUBIMAGE,
+	GFW_TRACE_CALL_TEXTURE_ACTIVATE,
+	GFW_TRACE_CALL_TEXTURE_BIND,
+	GFW_TRACE_CALL_TEXTURE_UNBIND,
+	GFW_TRACE_CALL_FREE_TEXTURE,
+	GFW_TRACE_CALL_INIT_FRAMEBUFFER,
+	GFW_TRACE_CALL_FRAMEBUFFER_BIND,
+	GFW_TRACE_CALL_FRAMEBUFFER_UNBIND,
+	GFW_TRACE_CALL_FRAMEBUFFER_CLEAR_COLOR,
+	GFW_TRACE_CALL_FRAMEBUFFER_CLEAR_DEPTH,
+	GFW_TRACE_CALL_FRAMEBUFFER_CLEAR,
+	GFW_TRACE_CALL_FREE_FRAMEBUFFER,
+	GFW_TRACE_CALL_INIT_VERTEX_DATA,
+	GFW_TRACE_CALL_VERTEX_DATA_BIND,
+	GFW_TRACE_CALL_VERTEX_DATA_UNBIND,
+	GFW_TRACE_CALL_VERTEX_DATA_UPLOAD,
+	GFW_TRACE_CALL_FREE_VERTEX_DATA,
+	GFW_TRACE_CALL_INIT_VERTEX_STATE,
+	GFW_TRACE_CALL_VERTEX_STATE_SET_LAYOUT,
+	GFW_TRACE_CALL_VERTEX_STATE_SET_INDEX_DATA,
+	GFW_TRACE_CALL_VERTEX_STATE_BIND,
+	GFW_TRACE_CALL_VERTEX_STATE_UNBIND,
+	GFW_TRACE_CALL_VERTEX_STATE_DRAW_RANGE,
+	GFW_TRACE_CALL_VERTEX_STATE_DRAW_ELEMENTS,
+	GFW_TRACE_CALL_VERTEX_STATE_DRAW_INSTANCED,
+	GFW_TRACE_CALL_VERTEX_STATE_DRAW_ELEMENTS_INSTANCED,
+	GFW_TRACE_CALL_FREE_VERTEX_STATE,
+	GFW_TRACE_CALL_INIT_SHADER,
+	GFW_TRACE_CALL_SHADER_USE,
+	GFW_TRACE_CALL_SHADER_SET_UNIFORM,
+	GFW_TRACE_CALL_SHADER_DRAW_RANGE,
+	GFW_TRACE_CALL_FREE_SHADER,
+	GFW_TRACE_CALL_VERTEX_STATE_MULTI_DRAW,
+	GFW_TRACE_CALL_VERTEX_STATE_MULTI_DRAW_ELEMENTS,
+	GFW_TRACE_CALL_VERTEX_STATE_MULTI_DRAW_INDIRECT,
+	GFW_TRACE_CALL_DRAW_LIST_UPLOAD
+};
+
+union gfw_trace_argument {
+	uint64_t u;
+	int64_t i;
+	double f;
+};
+
+struct gfw_trace_header {
+	uint32_t magic;
+	uint32_t version;
+};
+
+struct gfw_trace_record {
+	uint32_t call;
+	uint32_t arguments_count;
+	uint64_t payload_size;
+};
+
+/* Frame */
+#ifndef GFW_FRAMES_MAX
+#define GFW_FRAMES_MAX 8
+#endif
+#ifndef GFW_FRAMES_IN_FLIGHT
+#define GFW_FRAMES_IN_FLIGHT 2
+#endif
+
+struct gfw_frame_statistics {
+	uint64_t frame_index;
+	uint64_t completed_frame_index;
+	uint32_t frames_in_flight;
+	uint32_t max_frames_in_flight;
+	uint64_t wait_time;
+	uint64_t total_wait_time;
+	uint64_t waited_frames;
+	size_t pending_deletions;
+};
+
+/* Handle */
+#ifndef GFW_HANDLE_INDEX_BITS
+#define GFW_HANDLE_INDEX_BITS 18
+#endif
+#define GFW_HANDLE_NULL 0
+
+enum gfw_handle_type {
+	GFW_HANDLE_TYPE_TEXTURE,
+	GFW_HANDLE_TYPE_VERTEX_DATA,
+	GFW_HANDLE_TYPE_SHADER,
+	GFW_HANDLE_TYPE_FRAMEBUFFER,
+	GFW_HANDLE_TYPE_VERTEX_STATE,
+	GFW_HANDLE_TYPES_COUNT
+};
+
 /* Texture */
 void gfw_texture_unbind(void);
 void gfw_texture_bind(struct gfw_texture *texture);
 void gfw_texture_activate(uint32_t index);
+bool gfw_texture_bind_image(struct gfw_texture *texture, uint32_t unit, enum gfw_image_access access);
 void gfw_texture_put_subimage(struct gfw_texture *texture, int32_t x, int32_t y, uint8_t *data, uint32_t width, uint32_t height);
 void gfw_free_texture(struct gfw_texture *texture);
 bool gfw_init_texture(struct gfw_texture *texture, struct gfw_texture_descriptor descriptor);
@@ -226,18 +722,58 @@ bool gfw_vertex_data_push(struct gfw_vertex_data *vertex_data, uint8_t *data, si
 void gfw_vertex_data_unmap(void);
 void gfw_vertex_data_map_range(struct gfw_vertex_data *vertex_data, bool read, bool write, size_t offset, size_t range);
 void gfw_vertex_data_map(struct gfw_vertex_data *vertex_data, bool read, bool write);
+void gfw_vertex_data_bind_storage(struct gfw_vertex_data *vertex_data, uint32_t index);
 void gfw_vertex_data_unbind(void);
 void gfw_vertex_data_bind(struct gfw_vertex_data *vertex_data);
 void gfw_free_vertex_data(struct gfw_vertex_data *vertex_data);
 bool gfw_init_vertex_data(struct gfw_vertex_data *vertex_data, size_t size, enum gfw_vertex_data_usage usage);
 
 /* Vertex state */
+void gfw_vertex_state_draw_elements_instanced(struct gfw_vertex_state *vertex_state,
+	enum gfw_primitive primitive,
+	enum gfw_index_type index_type,
+	size_t first,
+	size_t count,
+	size_t instance_count,
+	uint32_t base_instance);
+void gfw_vertex_state_draw_instanced(struct gfw_vertex_state *vertex_state,
+	enum gfw_primitive primitive,
+	size_t first,
+	size_t count,
+	size_t instance_count,
+	uint32_t base_instance);
+void gfw_vertex_state_draw_elements(struct gfw_vertex_state *vertex_state, enum gfw_primitive primitive, enum gfw_index_type index_type, size_t first, size_t count);
+void gfw_vertex_state_draw_range(struct gfw_vertex_state *vertex_state, enum gfw_primitive primitive, size_t first, size_t count);
+bool gfw_vertex_state_set_layout(struct gfw_vertex_state *vertex_state,
+	uint32_t binding,
+	struct gfw_vertex_data *vertex_data,
+	struct gfw_attribute *attributes,
+	size_t attributes_count);
+bool gfw_vertex_state_set_index_data(struct gfw_vertex_state *vertex_state, struct gfw_vertex_data *vertex_data);
 void gfw_vertex_state_unbind(void);
 void gfw_vertex_state_bind(struct gfw_vertex_state *vertex_state);
 void gfw_free_vertex_state(struct gfw_vertex_state *vertex_state);
 bool gfw_init_vertex_state(struct gfw_vertex_state *vertex_state);
 
+/* Draw list */
+void gfw_vertex_state_multi_draw_indirect(struct gfw_vertex_state *vertex_state,
+	enum gfw_primitive primitive,
+	struct gfw_vertex_data *indirect_data,
+	size_t offset,
+	size_t draw_count);
+void gfw_vertex_state_multi_draw_elements(struct gfw_vertex_state *vertex_state, enum gfw_primitive primitive, enum gfw_index_type index_type, struct gfw_draw_list *draw_list);
+void gfw_vertex_state_multi_draw(struct gfw_vertex_state *vertex_state, enum gfw_primitive primitive, struct gfw_draw_list *draw_list);
+bool gfw_draw_list_upload(struct gfw_draw_list *draw_list, struct gfw_vertex_data *indirect_data, size_t offset);
+bool gfw_draw_list_push_instanced(struct gfw_draw_list *draw_list, size_t first, size_t count, size_t instance_count, uint32_t base_instance);
+bool gfw_draw_list_push(struct gfw_draw_list *draw_list, size_t first, size_t count);
+void gfw_draw_list_clear(struct gfw_draw_list *draw_list);
+void gfw_free_draw_list(struct gfw_draw_list *draw_list);
+bool gfw_init_draw_list(struct gfw_draw_list *draw_list, size_t capacity);
+
 /* Shader */
+void gfw_reset_uniform_statistics(void);
+void gfw_get_uniform_statistics(struct gfw_uniform_statistics *statistics);
+void gfw_shader_flush_uniforms(struct gfw_shader *shader);
 void gfw_shader_set_uniform_mat4(gfw_int_t location, bool normalize, gfw_float_t *matrix);
 void gfw_shader_set_uniform_mat3(gfw_int_t location, bool normalize, gfw_float_t *matrix);
 void gfw_shader_set_uniform_float(gfw_int_t location, gfw_float_t f);
@@ -246,6 +782,11 @@ void gfw_shader_set_uniform_int(gfw_int_t location, gfw_int_t i);
 void gfw_shader_set_uniform_intv(gfw_int_t location, gfw_int_t *i, uint32_t count);
 void gfw_shader_set_uniform_uint(gfw_int_t location, gfw_uint_t i);
 void gfw_shader_set_uniform_uintv(gfw_int_t location, gfw_uint_t *i, uint32_t count);
+uint32_t gfw_name_hash(const char *name);
+struct gfw_shader_variable *gfw_shader_find_variable(struct gfw_shader *shader, enum gfw_shader_variable_kind kind, uint32_t hash);
+gfw_int_t gfw_shader_find_block_index(struct gfw_shader *shader, uint32_t hash);
+gfw_int_t gfw_shader_find_uniform_location(struct gfw_shader *shader, uint32_t hash);
+gfw_int_t gfw_shader_find_attribute_location(struct gfw_shader *shader, uint32_t hash);
 gfw_int_t gfw_shader_get_uniform_location(struct gfw_shader *shader, char *name);
 gfw_int_t gfw_shader_get_attribute_location(struct gfw_shader *shader, char *name);
 void gfw_shader_draw_range(struct gfw_attribute *attributes,
@@ -255,9 +796,75 @@ void gfw_shader_draw_range(struct gfw_attribute *attributes,
 	size_t count);
 void gfw_shader_use(struct gfw_shader *shader);
 void gfw_free_shader(struct gfw_shader *shader);
+void gfw_get_program_cache_statistics(struct gfw_program_cache_statistics *statistics);
+bool gfw_set_program_cache_directory(char *directory);
+enum gfw_shader_status gfw_shader_poll(struct gfw_shader *shader);
+bool gfw_init_shader_async(struct gfw_shader *shader, char *vertex_source, char *geometry_source, char *fragment_source);
+bool gfw_init_shader_with_feedback(struct gfw_shader *shader,
+	char *vertex_source,
+	char *geometry_source,
+	char *fragment_source,
+	char **varyings,
+	size_t varyings_count,
+	bool interleaved);
 bool gfw_init_shader(struct gfw_shader *shader, char *vertex_source, char *geometry_source, char *fragment_source);
 
+/* Shader stage */
+void gfw_shader_stage_set_uniform_mat4(struct gfw_shader_stage *stage, gfw_int_t location, bool normalize, gfw_float_t *matrix);
+void gfw_shader_stage_set_uniform_mat3(struct gfw_shader_stage *stage, gfw_int_t location, bool normalize, gfw_float_t *matrix);
+void gfw_shader_stage_set_uniform_float(struct gfw_shader_stage *stage, gfw_int_t location, gfw_float_t f);
+void gfw_shader_stage_set_uniform_floatv(struct gfw_shader_stage *stage, gfw_int_t location, gfw_float_t *f, uint32_t count);
+void gfw_shader_stage_set_uniform_int(struct gfw_shader_stage *stage, gfw_int_t location, gfw_int_t i);
+void gfw_shader_stage_set_uniform_intv(struct gfw_shader_stage *stage, gfw_int_t location, gfw_int_t *i, uint32_t count);
+void gfw_shader_stage_set_uniform_uint(struct gfw_shader_stage *stage, gfw_int_t location, gfw_uint_t i);
+void gfw_shader_stage_set_uniform_uintv(struct gfw_shader_stage *stage, gfw_int_t location, gfw_uint_t *i, uint32_t count);
+gfw_int_t gfw_shader_stage_get_uniform_location(struct gfw_shader_stage *stage, char *name);
+bool gfw_shader_stages_use(struct gfw_shader_stage *vertex_stage, struct gfw_shader_stage *geometry_stage, struct gfw_shader_stage *fragment_stage);
+void gfw_free_shader_pipelines(void);
+void gfw_free_shader_stage(struct gfw_shader_stage *stage);
+bool gfw_init_shader_stage(struct gfw_shader_stage *stage, enum gfw_shader_stage_type type, char *source);
+
+/* Compute */
+void gfw_memory_barrier(enum gfw_barrier_bits barriers);
+void gfw_compute_dispatch_indirect(struct gfw_vertex_data *indirect_data, size_t offset);
+void gfw_compute_dispatch(uint32_t x, uint32_t y, uint32_t z);
+bool gfw_init_compute_shader(struct gfw_shader *shader, char *compute_source);
+
+/* Feedback */
+void gfw_feedback_draw(struct gfw_feedback *feedback, struct gfw_vertex_state *vertex_state, enum gfw_primitive primitive);
+bool gfw_feedback_poll(struct gfw_feedback *feedback, size_t *primitives_written);
+void gfw_feedback_end(struct gfw_feedback *feedback);
+void gfw_feedback_begin(struct gfw_feedback *feedback, enum gfw_primitive primitive, bool discard);
+bool gfw_feedback_set_vertex_data(struct gfw_feedback *feedback, uint32_t index, struct gfw_vertex_data *vertex_data);
+void gfw_free_feedback(struct gfw_feedback *feedback);
+bool gfw_init_feedback(struct gfw_feedback *feedback, struct gfw_vertex_data *vertex_data);
+
+/* Shader variants */
+char *gfw_shader_preprocess(char *source, char *include_directory);
+char *gfw_shader_load(char *path, char *include_directory);
+size_t gfw_shader_variants_update(struct gfw_shader_variants *variants);
+bool gfw_shader_variants_precompile(struct gfw_shader_variants *variants, uint64_t *keys, size_t keys_count);
+struct gfw_shader *gfw_shader_variants_get(struct gfw_shader_variants *variants, uint64_t key);
+void gfw_free_shader_variants(struct gfw_shader_variants *variants);
+bool gfw_init_shader_variants(struct gfw_shader_variants *variants,
+	char *vertex_source,
+	char *geometry_source,
+	char *fragment_source,
+	char *include_directory,
+	char **defines,
+	size_t defines_count);
+
+/* Shader watcher */
+/* Without KHR_parallel_shader_compile, the poll that picks up a reload waits for the driver to link it */
+size_t gfw_shader_watcher_poll(struct gfw_shader_watcher *watcher);
+bool gfw_shader_watcher_add(struct gfw_shader_watcher *watcher, struct gfw_shader *shader, char *vertex_path, char *geometry_path, char *fragment_path);
+void gfw_free_shader_watcher(struct gfw_shader_watcher *watcher);
+bool gfw_init_shader_watcher(struct gfw_shader_watcher *watcher, char *include_directory);
+
 /* Graphic state */
+void gfw_flush_state(void);
+void gfw_invalidate_state(void);
+void gfw_resync_state(void);
 void gfw_set_viewport(int32_t x, int32_t y, uint32_t width, uint32_t height);
 void gfw_enable_blend(void);
 void gfw_disable_blend(void);
@@ -275,6 +882,8 @@ void gfw_enable_dither(void);
 void gfw_disable_dither(void);
 void gfw_enable_line_smooth(void);
 void gfw_disable_line_smooth(void);
+void gfw_enable_rasterizer_discard(void);
+void gfw_disable_rasterizer_discard(void);
 void gfw_set_blend_equation(enum gfw_blend_equation blend_equation_rgb, enum gfw_blend_equation blend_equation_alpha);
 void gfw_set_blend_function(enum gfw_blend_factor blend_factor_source, enum gfw_blend_factor blend_factor_destination);
 void gfw_set_blend_function_separate(enum gfw_blend_factor blend_factor_source_rgb, enum gfw_blend_factor blend_factor_destination_rgb, enum gfw_blend_factor blend_factor_source_alpha, enum gfw_blend_factor blend_factor_destination_alpha);
@@ -287,4 +896,105 @@ void gfw_set_depth_range(float near, float far);
 void gfw_set_point_size(float size);
 void gfw_set_line_width(float width);
 
+/* Pipeline state */
+void gfw_pipeline_state_apply(struct gfw_pipeline_state *pipeline_state);
+struct gfw_pipeline_state *gfw_get_pipeline_state(struct gfw_pipeline_state_descriptor descriptor);
+void gfw_get_default_pipeline_state_descriptor(struct gfw_pipeline_state_descriptor *descriptor);
+void gfw_free_pipeline_states(void);
+
+/* Command bucket */
+uint64_t gfw_command_key(uint32_t layer, uint32_t pass, bool translucent, uint32_t shader, uint32_t material, uint32_t depth);
+void gfw_command_bucket_submit(struct gfw_command_bucket *command_bucket);
+void gfw_command_bucket_sort(struct gfw_command_bucket *command_bucket);
+bool gfw_command_bucket_push(struct gfw_command_bucket *command_bucket, struct gfw_command *command);
+void gfw_command_bucket_clear(struct gfw_command_bucket *command_bucket);
+void gfw_free_command_bucket(struct gfw_command_bucket *command_bucket);
+bool gfw_init_command_bucket(struct gfw_command_bucket *command_bucket, size_t capacity);
+
+/* Command list */
+void gfw_submit_command_lists(struct gfw_command_list **command_lists, size_t command_lists_count);
+void gfw_command_list_submit(struct gfw_command_list *command_list);
+bool gfw_command_list_clear(struct gfw_command_list *command_list, bool color, bool depth);
+bool gfw_command_list_clear_color(struct gfw_command_list *command_list, gfw_float_t r, gfw_float_t g, gfw_float_t b, gfw_float_t a);
+bool gfw_command_list_draw_elements(struct gfw_command_list *command_list,
+	struct gfw_vertex_state *vertex_state,
+	enum gfw_primitive primitive,
+	enum gfw_index_type index_type,
+	size_t first,
+	size_t count);
+bool gfw_command_list_draw_range(struct gfw_command_list *command_list, struct gfw_vertex_state *vertex_state, enum gfw_primitive primitive, size_t first, size_t count);
+bool gfw_command_list_set_uniform_mat4(struct gfw_command_list *command_list, gfw_int_t location, bool normalize, gfw_float_t *matrix);
+bool gfw_command_list_set_uniform_floatv(struct gfw_command_list *command_list, gfw_int_t location, gfw_float_t *f, uint32_t count);
+bool gfw_command_list_set_uniform_intv(struct gfw_command_list *command_list, gfw_int_t location, gfw_int_t *i, uint32_t count);
+bool gfw_command_list_set_uniform_uintv(struct gfw_command_list *command_list, gfw_int_t location, gfw_uint_t *i, uint32_t count);
+bool gfw_command_list_set_viewport(struct gfw_command_list *command_list, int32_t x, int32_t y, uint32_t width, uint32_t height);
+bool gfw_command_list_apply_pipeline_state(struct gfw_command_list *command_list, struct gfw_pipeline_state *pipeline_state);
+bool gfw_command_list_bind_texture(struct gfw_command_list *command_list, uint32_t index, struct gfw_texture *texture);
+bool gfw_command_list_use_shader(struct gfw_command_list *command_list, struct gfw_shader *shader);
+bool gfw_command_list_bind_framebuffer(struct gfw_command_list *command_list, struct gfw_framebuffer *framebuffer);
+void gfw_command_list_reset(struct gfw_command_list *command_list);
+void gfw_free_command_list(struct gfw_command_list *command_list);
+bool gfw_init_command_list(struct gfw_command_list *command_list, size_t capacity);
+
+/* Debug */
+void gfw_set_debug_label(enum gfw_debug_object object, gfw_uint_t object_gl_id, char *label);
+void gfw_pop_debug_group(void);
+void gfw_push_debug_group(char *name);
+size_t gfw_debug_poll(struct gfw_debug_message *messages, size_t messages_capacity, uint32_t *dropped);
+void gfw_free_debug_output(void);
+bool gfw_init_debug_output(void);
+
+/* Timer */
+bool gfw_timer_write_trace(struct gfw_timer *timer, char *path);
+struct gfw_timer_frame *gfw_timer_get_frame(struct gfw_timer *timer);
+void gfw_timer_end(struct gfw_timer *timer);
+void gfw_timer_begin(struct gfw_timer *timer, char *name);
+void gfw_timer_end_frame(struct gfw_timer *timer);
+void gfw_timer_begin_frame(struct gfw_timer *timer);
+void gfw_free_timer(struct gfw_timer *timer);
+bool gfw_init_timer(struct gfw_timer *timer);
+
+/* Statistics */
+void gfw_statistics_end_frame(void);
+void gfw_reset_statistics(void);
+void gfw_get_statistics(struct gfw_statistics *statistics);
+
+/* Trace */
+void gfw_trace_frame(void);
+void gfw_free_trace(void);
+bool gfw_init_trace(char *path);
+
+/* Frame */
+void gfw_get_frame_statistics(struct gfw_frame_statistics *statistics);
+bool gfw_is_frame_complete(uint64_t frame_index);
+uint64_t gfw_get_completed_frame_index(void);
+uint64_t gfw_get_frame_index(void);
+void gfw_end_frame(void);
+void gfw_begin_frame(void);
+bool gfw_set_max_frames_in_flight(uint32_t count);
+void gfw_free_frames(void);
+
+/* Handle */
+struct gfw_vertex_state *gfw_get_vertex_state(gfw_handle_t handle);
+void gfw_destroy_vertex_state(gfw_handle_t handle);
+gfw_handle_t gfw_create_vertex_state(void);
+struct gfw_framebuffer *gfw_get_framebuffer(gfw_handle_t handle);
+void gfw_destroy_framebuffer(gfw_handle_t handle);
+gfw_handle_t gfw_create_framebuffer(gfw_handle_t texture);
+struct gfw_shader *gfw_get_shader(gfw_handle_t handle);
+void gfw_destroy_shader(gfw_handle_t handle);
+gfw_handle_t gfw_create_shader(char *vertex_source, char *geometry_source, char *fragment_source);
+struct gfw_vertex_data *gfw_get_vertex_data(gfw_handle_t handle);
+void gfw_destroy_vertex_data(gfw_handle_t handle);
+gfw_handle_t gfw_create_vertex_data(size_t size, enum gfw_vertex_data_usage usage);
+struct gfw_texture *gfw_get_texture(gfw_handle_t handle);
+void gfw_destroy_texture(gfw_handle_t handle);
+gfw_handle_t gfw_create_texture(struct gfw_texture_descriptor descriptor);
+uint64_t gfw_get_handles_size(enum gfw_handle_type type);
+uint32_t gfw_get_handles(enum gfw_handle_type type, gfw_handle_t *handles, uint32_t handles_capacity);
+uint32_t gfw_get_handles_count(enum gfw_handle_type type);
+bool gfw_is_handle_valid(gfw_handle_t handle);
+void gfw_free_handles(void);
+bool gfw_init_handles(uint32_t capacity);
+
 #endif